@@ -0,0 +1,14 @@
+//
+//  dyn_vector.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "dyn_vector.h"
+
+// As in vector.cpp, instantiate every member for the supported scalar types.
+template class DynVector<double>;
+template class DynVector<float>;
+template class DynVector<int32_t>;
@@ -0,0 +1,18 @@
+//
+//  matrix.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "matrix.h"
+
+// As in vector.cpp, instantiate every member for the common shapes.
+template class Matrix<2, 2, double>;
+template class Matrix<3, 3, double>;
+template class Matrix<4, 4, double>;
+template class Matrix<4, 4, float>;
+template class Matrix<3, 4, double>;
+template class Matrix<4, 4, int32_t>;
+template class Matrix<4, 4, half>;
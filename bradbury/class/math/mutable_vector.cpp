@@ -0,0 +1,26 @@
+//
+//  mutable_vector.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "mutable_vector.h"
+
+// As in vector.cpp, instantiate every member for the supported scalar types.
+template class MutableVector<2, double>;
+template class MutableVector<3, double>;
+template class MutableVector<4, double>;
+template class MutableVector<2, float>;
+template class MutableVector<3, float>;
+template class MutableVector<4, float>;
+template class MutableVector<2, int32_t>;
+template class MutableVector<3, int32_t>;
+template class MutableVector<4, int32_t>;
+template class MutableVector<2, half>;
+template class MutableVector<3, half>;
+template class MutableVector<4, half>;
+template class MutableVector<2, mixed>;
+template class MutableVector<3, mixed>;
+template class MutableVector<4, mixed>;
@@ -0,0 +1,25 @@
+//
+//  parallel.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "parallel.h"
+
+namespace parallel {
+    static std::atomic<size_t> configured(0);
+
+    size_t threads() {
+        size_t count = configured;
+        if(count == 0) {
+            count = std::thread::hardware_concurrency();
+        }
+        return count == 0 ? 1 : count;
+    }
+
+    void setThreads(size_t count) {
+        configured = count;
+    }
+}
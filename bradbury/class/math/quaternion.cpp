@@ -0,0 +1,80 @@
+//
+//  quaternion.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "quaternion.h"
+
+#include <stdexcept>
+#include <string>
+
+#include "parallel.h"
+
+// Items per chunk of work. A rotation costs a few times what a point
+// transform does, so chunks are smaller than transformPoints()'s.
+static const size_t grain = 1 << 14;
+
+static void checkSize(size_t expected, size_t actual) {
+    if(expected != actual) {
+        throw std::length_error("Cannot combine quaternion batches of size " + std::to_string(expected) + " and " + std::to_string(actual));
+    }
+}
+
+template<class T>
+void rotate(const Quaternion<T> &q, std::type_identity_t<std::span<const Vector<3, T>>> in, std::type_identity_t<std::span<Vector<3, T>>> out) {
+    checkSize(in.size(), out.size());
+    parallel::forChunks(in.size(), grain, [&](size_t, size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) {
+            out[i] = q.rotate(in[i]);
+        }
+    });
+}
+
+template<class T>
+void rotate(std::span<const Quaternion<T>> q, std::type_identity_t<std::span<const Vector<3, T>>> in, std::type_identity_t<std::span<Vector<3, T>>> out) {
+    checkSize(q.size(), in.size());
+    checkSize(q.size(), out.size());
+    parallel::forChunks(q.size(), grain, [&](size_t, size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) {
+            out[i] = q[i].rotate(in[i]);
+        }
+    });
+}
+
+template<class T>
+void slerp(std::type_identity_t<std::span<const Quaternion<T>>> a, std::type_identity_t<std::span<const Quaternion<T>>> b, T t, std::type_identity_t<std::span<Quaternion<T>>> out) {
+    checkSize(a.size(), b.size());
+    checkSize(a.size(), out.size());
+    parallel::forChunks(a.size(), grain, [&](size_t, size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) {
+            out[i] = a[i].slerp(b[i], t);
+        }
+    });
+}
+
+template<class T>
+void nlerp(std::type_identity_t<std::span<const Quaternion<T>>> a, std::type_identity_t<std::span<const Quaternion<T>>> b, T t, std::type_identity_t<std::span<Quaternion<T>>> out) {
+    checkSize(a.size(), b.size());
+    checkSize(a.size(), out.size());
+    parallel::forChunks(a.size(), grain, [&](size_t, size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) {
+            out[i] = a[i].nlerp(b[i], t);
+        }
+    });
+}
+
+// As in vector.cpp, instantiate every member for both precisions.
+template class Quaternion<double>;
+template class Quaternion<float>;
+
+template void rotate<double>(const Quaternion<double> &, std::span<const Vector<3, double>>, std::span<Vector<3, double>>);
+template void rotate<float>(const Quaternion<float> &, std::span<const Vector<3, float>>, std::span<Vector<3, float>>);
+template void rotate<double>(std::span<const Quaternion<double>>, std::span<const Vector<3, double>>, std::span<Vector<3, double>>);
+template void rotate<float>(std::span<const Quaternion<float>>, std::span<const Vector<3, float>>, std::span<Vector<3, float>>);
+template void slerp<double>(std::span<const Quaternion<double>>, std::span<const Quaternion<double>>, double, std::span<Quaternion<double>>);
+template void slerp<float>(std::span<const Quaternion<float>>, std::span<const Quaternion<float>>, float, std::span<Quaternion<float>>);
+template void nlerp<double>(std::span<const Quaternion<double>>, std::span<const Quaternion<double>>, double, std::span<Quaternion<double>>);
+template void nlerp<float>(std::span<const Quaternion<float>>, std::span<const Quaternion<float>>, float, std::span<Quaternion<float>>);
@@ -0,0 +1,26 @@
+//
+//  reduce.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "reduce.h"
+
+// As in vector.cpp, instantiate the reductions for the common point types.
+template Vector<3, double> sum<3, double, alignof(double)>(std::span<const Vector<3, double>>);
+template Vector<3, float> sum<3, float, alignof(float)>(std::span<const Vector<3, float>>);
+template Vector<2, double> sum<2, double, alignof(double)>(std::span<const Vector<2, double>>);
+template Vector<3, double> weightedSum<3, double, alignof(double)>(std::span<const Vector<3, double>>, std::span<const double>);
+template Vector<3, float> weightedSum<3, float, alignof(float)>(std::span<const Vector<3, float>>, std::span<const float>);
+template Vector<3, double> mean<3, double, alignof(double)>(std::span<const Vector<3, double>>);
+template Vector<3, float> mean<3, float, alignof(float)>(std::span<const Vector<3, float>>);
+template Vector<3, double> minimum<3, double, alignof(double)>(std::span<const Vector<3, double>>);
+template Vector<3, double> maximum<3, double, alignof(double)>(std::span<const Vector<3, double>>);
+template Bounds<3, double> bounds<3, double, alignof(double)>(std::span<const Vector<3, double>>);
+template Bounds<3, float> bounds<3, float, alignof(float)>(std::span<const Vector<3, float>>);
+template Bounds<2, double> bounds<2, double, alignof(double)>(std::span<const Vector<2, double>>);
+template Vector<3, double> sum<3, mixed, alignof(mixed)>(std::span<const Vector<3, mixed>>);
+template Vector<3, double> mean<3, mixed, alignof(mixed)>(std::span<const Vector<3, mixed>>);
+template Bounds<3, mixed> bounds<3, mixed, alignof(mixed)>(std::span<const Vector<3, mixed>>);
@@ -0,0 +1,453 @@
+//
+//  simd.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "simd.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BRADBURY_SIMD_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace simd {
+    // Scalar fallback: the shared kernels over one-lane "registers".
+    namespace scalar {
+        #define BRADBURY_TARGET
+
+        template<class T>
+        struct Ops {
+            typedef T reg;
+            static const size_t lanes = 1;
+
+            static inline reg load(const T *p) { return *p; }
+            static inline void store(T *p, reg r) { *p = r; }
+            static inline reg loadTail(const T *p, size_t) { return *p; }
+            static inline void storeTail(T *p, reg r, size_t) { *p = r; }
+            static inline reg widen(const float *p) { return *p; }
+            static inline reg widenTail(const float *p, size_t) { return *p; }
+            static inline reg set1(T d) { return d; }
+            static inline reg zero() { return 0; }
+            static inline reg add(reg a, reg b) { return a + b; }
+            static inline reg sub(reg a, reg b) { return a - b; }
+            static inline reg mul(reg a, reg b) { return a * b; }
+            static inline reg div(reg a, reg b) { return a / b; }
+            static inline reg sqrt(reg a) { return std::sqrt(a); }
+            static inline reg rsqrt(reg a) { return 1 / std::sqrt(a); }
+            static inline reg fmadd(reg a, reg b, reg c) { return a * b + c; }
+            static inline T sum(reg r) { return r; }
+
+            static inline void cross(const T *a, const T *b, T *out) {
+                T x = a[1] * b[2] - a[2] * b[1];
+                T y = a[2] * b[0] - a[0] * b[2];
+                T z = a[0] * b[1] - a[1] * b[0];
+                out[0] = x;
+                out[1] = y;
+                out[2] = z;
+            }
+        };
+
+        #include "simd_kernels.inc"
+        #undef BRADBURY_TARGET
+    }
+
+#ifdef BRADBURY_SIMD_X86
+    // Each instruction set gets its own copy of the kernels, compiled for that
+    // target only. None of them are called unless CPUID says they are safe.
+
+    // SSE2: two doubles or four floats. Partial float registers go through a
+    // small stack buffer.
+    namespace sse2 {
+        #define BRADBURY_TARGET __attribute__((target("sse2")))
+
+        // Cross product of the first three float lanes, shared by every level:
+        // a x b = (a * b.yzx - a.yzx * b).yzx
+        BRADBURY_TARGET static inline void crossps(const float *a, const float *b, float *out) {
+            float buffer[4] = {a[0], a[1], a[2], 0};
+            __m128 va = _mm_loadu_ps(buffer);
+            buffer[0] = b[0]; buffer[1] = b[1]; buffer[2] = b[2];
+            __m128 vb = _mm_loadu_ps(buffer);
+            __m128 ayzx = _mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 0, 2, 1));
+            __m128 byzx = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 0, 2, 1));
+            __m128 c = _mm_sub_ps(_mm_mul_ps(va, byzx), _mm_mul_ps(ayzx, vb));
+            _mm_storeu_ps(buffer, _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1)));
+            out[0] = buffer[0];
+            out[1] = buffer[1];
+            out[2] = buffer[2];
+        }
+
+        template<class T>
+        struct Ops;
+
+        template<>
+        struct Ops<double> {
+            typedef __m128d reg;
+            static const size_t lanes = 2;
+
+            BRADBURY_TARGET static inline reg load(const double *p) { return _mm_loadu_pd(p); }
+            BRADBURY_TARGET static inline void store(double *p, reg r) { _mm_storeu_pd(p, r); }
+            // The only possible tail is a single double.
+            BRADBURY_TARGET static inline reg loadTail(const double *p, size_t) { return _mm_load_sd(p); }
+            BRADBURY_TARGET static inline void storeTail(double *p, reg r, size_t) { _mm_store_sd(p, r); }
+            BRADBURY_TARGET static inline reg widen(const float *p) {
+                return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+            }
+            BRADBURY_TARGET static inline reg widenTail(const float *p, size_t) { return _mm_cvtps_pd(_mm_load_ss(p)); }
+            BRADBURY_TARGET static inline reg set1(double d) { return _mm_set1_pd(d); }
+            BRADBURY_TARGET static inline reg zero() { return _mm_setzero_pd(); }
+            BRADBURY_TARGET static inline reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+            BRADBURY_TARGET static inline reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+            BRADBURY_TARGET static inline reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+            BRADBURY_TARGET static inline reg div(reg a, reg b) { return _mm_div_pd(a, b); }
+            BRADBURY_TARGET static inline reg sqrt(reg a) { return _mm_sqrt_pd(a); }
+            // There is no double estimate before AVX-512; estimate in float.
+            BRADBURY_TARGET static inline reg rsqrt(reg a) { return _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(a))); }
+            BRADBURY_TARGET static inline reg fmadd(reg a, reg b, reg c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+            BRADBURY_TARGET static inline double sum(reg r) {
+                return _mm_cvtsd_f64(_mm_add_sd(r, _mm_unpackhi_pd(r, r)));
+            }
+
+            BRADBURY_TARGET static inline void cross(const double *a, const double *b, double *out) {
+                // (x, y) = (a1, a2) * (b2, b0) - (a2, a0) * (b1, b2)
+                __m128d a12 = _mm_loadu_pd(a + 1);
+                __m128d b12 = _mm_loadu_pd(b + 1);
+                __m128d a20 = _mm_shuffle_pd(a12, _mm_load_sd(a), 1);
+                __m128d b20 = _mm_shuffle_pd(b12, _mm_load_sd(b), 1);
+                __m128d xy = _mm_sub_pd(_mm_mul_pd(a12, b20), _mm_mul_pd(a20, b12));
+                double z = a[0] * b[1] - a[1] * b[0];
+                _mm_storeu_pd(out, xy);
+                out[2] = z;
+            }
+        };
+
+        template<>
+        struct Ops<float> {
+            typedef __m128 reg;
+            static const size_t lanes = 4;
+
+            BRADBURY_TARGET static inline reg load(const float *p) { return _mm_loadu_ps(p); }
+            BRADBURY_TARGET static inline void store(float *p, reg r) { _mm_storeu_ps(p, r); }
+            BRADBURY_TARGET static inline reg loadTail(const float *p, size_t n) {
+                float buffer[4] = {0, 0, 0, 0};
+                std::memcpy(buffer, p, n * sizeof(float));
+                return _mm_loadu_ps(buffer);
+            }
+            BRADBURY_TARGET static inline void storeTail(float *p, reg r, size_t n) {
+                float buffer[4];
+                _mm_storeu_ps(buffer, r);
+                std::memcpy(p, buffer, n * sizeof(float));
+            }
+            BRADBURY_TARGET static inline reg set1(float d) { return _mm_set1_ps(d); }
+            BRADBURY_TARGET static inline reg zero() { return _mm_setzero_ps(); }
+            BRADBURY_TARGET static inline reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+            BRADBURY_TARGET static inline reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+            BRADBURY_TARGET static inline reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+            BRADBURY_TARGET static inline reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+            BRADBURY_TARGET static inline reg sqrt(reg a) { return _mm_sqrt_ps(a); }
+            BRADBURY_TARGET static inline reg rsqrt(reg a) { return _mm_rsqrt_ps(a); }
+            BRADBURY_TARGET static inline reg fmadd(reg a, reg b, reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+            BRADBURY_TARGET static inline float sum(reg r) {
+                __m128 h = _mm_add_ps(r, _mm_movehl_ps(r, r));
+                return _mm_cvtss_f32(_mm_add_ss(h, _mm_shuffle_ps(h, h, 1)));
+            }
+
+            BRADBURY_TARGET static inline void cross(const float *a, const float *b, float *out) {
+                crossps(a, b, out);
+            }
+        };
+
+        #include "simd_kernels.inc"
+        #undef BRADBURY_TARGET
+    }
+
+    // AVX2: four doubles or eight floats. Tails are padded with masked loads,
+    // so a Vector<3> or Vector<4> is a single register.
+    namespace avx2 {
+        #define BRADBURY_TARGET __attribute__((target("avx2,fma")))
+
+        // A sliding window over this table yields a mask of `n` ones.
+        static const int masks[16] = {-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+
+        template<class T>
+        struct Ops;
+
+        template<>
+        struct Ops<double> {
+            typedef __m256d reg;
+            static const size_t lanes = 4;
+
+            BRADBURY_TARGET static inline __m256i tail(size_t n) {
+                return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(masks + 8 - 2 * n));
+            }
+
+            BRADBURY_TARGET static inline reg load(const double *p) { return _mm256_loadu_pd(p); }
+            BRADBURY_TARGET static inline void store(double *p, reg r) { _mm256_storeu_pd(p, r); }
+            BRADBURY_TARGET static inline reg loadTail(const double *p, size_t n) { return _mm256_maskload_pd(p, tail(n)); }
+            BRADBURY_TARGET static inline void storeTail(double *p, reg r, size_t n) { _mm256_maskstore_pd(p, tail(n), r); }
+            BRADBURY_TARGET static inline reg widen(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+            BRADBURY_TARGET static inline reg widenTail(const float *p, size_t n) {
+                return _mm256_cvtps_pd(_mm_maskload_ps(p, _mm_loadu_si128(reinterpret_cast<const __m128i *>(masks + 8 - n))));
+            }
+            BRADBURY_TARGET static inline reg set1(double d) { return _mm256_set1_pd(d); }
+            BRADBURY_TARGET static inline reg zero() { return _mm256_setzero_pd(); }
+            BRADBURY_TARGET static inline reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+            BRADBURY_TARGET static inline reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+            BRADBURY_TARGET static inline reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+            BRADBURY_TARGET static inline reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+            BRADBURY_TARGET static inline reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+            BRADBURY_TARGET static inline reg rsqrt(reg a) { return _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(a))); }
+            BRADBURY_TARGET static inline reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+            BRADBURY_TARGET static inline double sum(reg r) {
+                __m128d h = _mm_add_pd(_mm256_castpd256_pd128(r), _mm256_extractf128_pd(r, 1));
+                return _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+            }
+
+            BRADBURY_TARGET static inline void cross(const double *a, const double *b, double *out) {
+                reg va = loadTail(a, 3);
+                reg vb = loadTail(b, 3);
+                // yzx and zxy rotations of the first three lanes.
+                reg a120 = _mm256_permute4x64_pd(va, _MM_SHUFFLE(3, 0, 2, 1));
+                reg b120 = _mm256_permute4x64_pd(vb, _MM_SHUFFLE(3, 0, 2, 1));
+                reg a201 = _mm256_permute4x64_pd(va, _MM_SHUFFLE(3, 1, 0, 2));
+                reg b201 = _mm256_permute4x64_pd(vb, _MM_SHUFFLE(3, 1, 0, 2));
+                storeTail(out, _mm256_fmsub_pd(a120, b201, _mm256_mul_pd(a201, b120)), 3);
+            }
+        };
+
+        template<>
+        struct Ops<float> {
+            typedef __m256 reg;
+            static const size_t lanes = 8;
+
+            BRADBURY_TARGET static inline __m256i tail(size_t n) {
+                return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(masks + 8 - n));
+            }
+
+            BRADBURY_TARGET static inline reg load(const float *p) { return _mm256_loadu_ps(p); }
+            BRADBURY_TARGET static inline void store(float *p, reg r) { _mm256_storeu_ps(p, r); }
+            BRADBURY_TARGET static inline reg loadTail(const float *p, size_t n) { return _mm256_maskload_ps(p, tail(n)); }
+            BRADBURY_TARGET static inline void storeTail(float *p, reg r, size_t n) { _mm256_maskstore_ps(p, tail(n), r); }
+            BRADBURY_TARGET static inline reg set1(float d) { return _mm256_set1_ps(d); }
+            BRADBURY_TARGET static inline reg zero() { return _mm256_setzero_ps(); }
+            BRADBURY_TARGET static inline reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+            BRADBURY_TARGET static inline reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+            BRADBURY_TARGET static inline reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+            BRADBURY_TARGET static inline reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+            BRADBURY_TARGET static inline reg sqrt(reg a) { return _mm256_sqrt_ps(a); }
+            BRADBURY_TARGET static inline reg rsqrt(reg a) { return _mm256_rsqrt_ps(a); }
+            BRADBURY_TARGET static inline reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+            BRADBURY_TARGET static inline float sum(reg r) {
+                __m128 q = _mm_add_ps(_mm256_castps256_ps128(r), _mm256_extractf128_ps(r, 1));
+                __m128 h = _mm_add_ps(q, _mm_movehl_ps(q, q));
+                return _mm_cvtss_f32(_mm_add_ss(h, _mm_shuffle_ps(h, h, 1)));
+            }
+
+            BRADBURY_TARGET static inline void cross(const float *a, const float *b, float *out) {
+                sse2::crossps(a, b, out);
+            }
+        };
+
+        #include "simd_kernels.inc"
+        #undef BRADBURY_TARGET
+    }
+
+    // AVX-512: eight doubles or sixteen floats, with native mask registers for
+    // the tail.
+    namespace avx512 {
+        #define BRADBURY_TARGET __attribute__((target("avx512f")))
+
+        template<class T>
+        struct Ops;
+
+        template<>
+        struct Ops<double> {
+            typedef __m512d reg;
+            static const size_t lanes = 8;
+
+            BRADBURY_TARGET static inline __mmask8 tail(size_t n) {
+                return static_cast<__mmask8>((1u << n) - 1);
+            }
+
+            BRADBURY_TARGET static inline reg load(const double *p) { return _mm512_loadu_pd(p); }
+            BRADBURY_TARGET static inline void store(double *p, reg r) { _mm512_storeu_pd(p, r); }
+            BRADBURY_TARGET static inline reg loadTail(const double *p, size_t n) { return _mm512_maskz_loadu_pd(tail(n), p); }
+            BRADBURY_TARGET static inline void storeTail(double *p, reg r, size_t n) { _mm512_mask_storeu_pd(p, tail(n), r); }
+            BRADBURY_TARGET static inline reg widen(const float *p) { return _mm512_cvtps_pd(_mm256_loadu_ps(p)); }
+            // A masked 256-bit load needs AVX-512VL; take the low half of a
+            // masked 512-bit one.
+            BRADBURY_TARGET static inline reg widenTail(const float *p, size_t n) {
+                return _mm512_cvtps_pd(_mm512_castps512_ps256(_mm512_maskz_loadu_ps(static_cast<__mmask16>((1u << n) - 1), p)));
+            }
+            BRADBURY_TARGET static inline reg set1(double d) { return _mm512_set1_pd(d); }
+            BRADBURY_TARGET static inline reg zero() { return _mm512_setzero_pd(); }
+            BRADBURY_TARGET static inline reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+            BRADBURY_TARGET static inline reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+            BRADBURY_TARGET static inline reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+            BRADBURY_TARGET static inline reg div(reg a, reg b) { return _mm512_div_pd(a, b); }
+            BRADBURY_TARGET static inline reg sqrt(reg a) { return _mm512_sqrt_pd(a); }
+            // Good to 14 bits rather than 12.
+            BRADBURY_TARGET static inline reg rsqrt(reg a) { return _mm512_rsqrt14_pd(a); }
+            BRADBURY_TARGET static inline reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_pd(a, b, c); }
+            BRADBURY_TARGET static inline double sum(reg r) {
+                __m256d q = _mm256_add_pd(_mm512_castpd512_pd256(r), _mm512_extractf64x4_pd(r, 1));
+                __m128d h = _mm_add_pd(_mm256_castpd256_pd128(q), _mm256_extractf128_pd(q, 1));
+                return _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+            }
+
+            // AVX-512 gains nothing over AVX2 for three components.
+            BRADBURY_TARGET static inline void cross(const double *a, const double *b, double *out) {
+                avx2::Ops<double>::cross(a, b, out);
+            }
+        };
+
+        template<>
+        struct Ops<float> {
+            typedef __m512 reg;
+            static const size_t lanes = 16;
+
+            BRADBURY_TARGET static inline __mmask16 tail(size_t n) {
+                return static_cast<__mmask16>((1u << n) - 1);
+            }
+
+            BRADBURY_TARGET static inline reg load(const float *p) { return _mm512_loadu_ps(p); }
+            BRADBURY_TARGET static inline void store(float *p, reg r) { _mm512_storeu_ps(p, r); }
+            BRADBURY_TARGET static inline reg loadTail(const float *p, size_t n) { return _mm512_maskz_loadu_ps(tail(n), p); }
+            BRADBURY_TARGET static inline void storeTail(float *p, reg r, size_t n) { _mm512_mask_storeu_ps(p, tail(n), r); }
+            BRADBURY_TARGET static inline reg set1(float d) { return _mm512_set1_ps(d); }
+            BRADBURY_TARGET static inline reg zero() { return _mm512_setzero_ps(); }
+            BRADBURY_TARGET static inline reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+            BRADBURY_TARGET static inline reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+            BRADBURY_TARGET static inline reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+            BRADBURY_TARGET static inline reg div(reg a, reg b) { return _mm512_div_ps(a, b); }
+            BRADBURY_TARGET static inline reg sqrt(reg a) { return _mm512_sqrt_ps(a); }
+            BRADBURY_TARGET static inline reg rsqrt(reg a) { return _mm512_rsqrt14_ps(a); }
+            BRADBURY_TARGET static inline reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_ps(a, b, c); }
+            BRADBURY_TARGET static inline float sum(reg r) {
+                __m256 o = _mm256_add_ps(_mm512_castps512_ps256(r), _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(r), 1)));
+                __m128 q = _mm_add_ps(_mm256_castps256_ps128(o), _mm256_extractf128_ps(o, 1));
+                __m128 h = _mm_add_ps(q, _mm_movehl_ps(q, q));
+                return _mm_cvtss_f32(_mm_add_ss(h, _mm_shuffle_ps(h, h, 1)));
+            }
+
+            BRADBURY_TARGET static inline void cross(const float *a, const float *b, float *out) {
+                sse2::crossps(a, b, out);
+            }
+        };
+
+        #include "simd_kernels.inc"
+        #undef BRADBURY_TARGET
+    }
+
+    // CPUID leaf 1 / leaf 7 feature bits, plus XGETBV to make sure the OS
+    // saves the wider registers across context switches.
+    static unsigned long long xcr0() {
+        unsigned int eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<unsigned long long>(edx) << 32) | eax;
+    }
+
+    static Level probe() {
+        unsigned int eax, ebx, ecx, edx;
+        if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            return Level::scalar;
+        }
+
+        bool sse2 = edx & bit_SSE2;
+        bool osxsave = ecx & bit_OSXSAVE;
+        bool fma = ecx & bit_FMA;
+        bool avx = ecx & bit_AVX;
+        if(!sse2) {
+            return Level::scalar;
+        }
+        if(!osxsave || !avx) {
+            return Level::sse2;
+        }
+
+        unsigned long long xcr = xcr0();
+        bool ymm = (xcr & 0x6) == 0x6;
+        bool zmm = (xcr & 0xe6) == 0xe6;
+
+        if(!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            return Level::sse2;
+        }
+        bool avx2 = ebx & bit_AVX2;
+        bool avx512f = ebx & bit_AVX512F;
+
+        if(avx512f && zmm && fma) {
+            return Level::avx512;
+        }
+        if(avx2 && ymm && fma) {
+            return Level::avx2;
+        }
+        return Level::sse2;
+    }
+#else
+    static Level probe() {
+        return Level::scalar;
+    }
+#endif
+
+    Level detected() {
+        static const Level level = probe();
+        return level;
+    }
+
+    template<class T>
+    const Kernels<T> &kernels(Level level) {
+        static const Kernels<T> scalarKernels = scalar::table<T>(Level::scalar);
+#ifdef BRADBURY_SIMD_X86
+        static const Kernels<T> sse2Kernels = sse2::table<T>(Level::sse2);
+        static const Kernels<T> avx2Kernels = avx2::table<T>(Level::avx2);
+        static const Kernels<T> avx512Kernels = avx512::table<T>(Level::avx512);
+#endif
+
+        if(level > detected()) {
+            level = detected();
+        }
+
+        switch(level) {
+#ifdef BRADBURY_SIMD_X86
+            case Level::avx512:
+                return avx512Kernels;
+            case Level::avx2:
+                return avx2Kernels;
+            case Level::sse2:
+                return sse2Kernels;
+#endif
+            default:
+                return scalarKernels;
+        }
+    }
+
+    template<class T>
+    const Kernels<T> &kernels() {
+        static const Kernels<T> &active = kernels<T>(detected());
+        return active;
+    }
+
+    template const Kernels<double> &kernels<double>(Level level);
+    template const Kernels<float> &kernels<float>(Level level);
+    template const Kernels<double> &kernels<double>();
+    template const Kernels<float> &kernels<float>();
+
+    const char *name(Level level) {
+        switch(level) {
+            case Level::scalar:
+                return "scalar";
+            case Level::sse2:
+                return "sse2";
+            case Level::avx2:
+                return "avx2";
+            case Level::avx512:
+                return "avx512";
+        }
+        return "unknown";
+    }
+}
@@ -0,0 +1,14 @@
+//
+//  sparse_vector.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "sparse_vector.h"
+
+// As in vector.cpp, instantiate every member for the supported scalar types.
+template class SparseVector<double>;
+template class SparseVector<float>;
+template class SparseVector<int32_t>;
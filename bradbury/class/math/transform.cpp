@@ -0,0 +1,135 @@
+//
+//  transform.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "transform.h"
+
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "parallel.h"
+
+#if defined(__x86_64__)
+#define BRADBURY_STREAMING_STORES 1
+#include <immintrin.h>
+#endif
+
+// Points per chunk of work: large enough to amortize handing out chunks,
+// small enough to balance the load across threads.
+static const size_t grain = 1 << 16;
+
+// One scalar, optionally written around the cache. movnti needs no alignment,
+// so it suits three-component points as well as four.
+template<bool stream, class T>
+static inline void store(T *p, T value) {
+#ifdef BRADBURY_STREAMING_STORES
+    if constexpr(stream) {
+        if constexpr(sizeof(T) == 8) {
+            _mm_stream_si64(reinterpret_cast<long long *>(p), std::bit_cast<long long>(value));
+        } else {
+            _mm_stream_si32(reinterpret_cast<int *>(p), std::bit_cast<int>(value));
+        }
+        return;
+    }
+#endif
+    *p = value;
+}
+
+// Points [begin, end) of D components each. The matrix is copied into locals
+// so the compiler keeps it in registers, and all inputs of a point are read
+// before any output is written, so `in` and `out` may be the same buffer.
+template<size_t D, bool projective, bool stream, class T>
+static void transformRange(const T *m, const T *in, T *out, size_t begin, size_t end) {
+    const T m00 = m[0], m01 = m[1], m02 = m[2], m03 = m[3];
+    const T m10 = m[4], m11 = m[5], m12 = m[6], m13 = m[7];
+    const T m20 = m[8], m21 = m[9], m22 = m[10], m23 = m[11];
+    const T m30 = m[12], m31 = m[13], m32 = m[14], m33 = m[15];
+
+    for(size_t i = begin; i < end; i++) {
+        const T *p = in + i * D;
+        T x = p[0], y = p[1], z = p[2], w = 1;
+        if constexpr(D == 4) {
+            w = p[3];
+        }
+
+        T rx = m00 * x + m01 * y + m02 * z + m03 * w;
+        T ry = m10 * x + m11 * y + m12 * z + m13 * w;
+        T rz = m20 * x + m21 * y + m22 * z + m23 * w;
+
+        T *q = out + i * D;
+        if constexpr(D == 4) {
+            T rw = m30 * x + m31 * y + m32 * z + m33 * w;
+            store<stream>(q, rx);
+            store<stream>(q + 1, ry);
+            store<stream>(q + 2, rz);
+            store<stream>(q + 3, rw);
+        } else if constexpr(projective) {
+            T inverse = 1 / (m30 * x + m31 * y + m32 * z + m33);
+            store<stream>(q, rx * inverse);
+            store<stream>(q + 1, ry * inverse);
+            store<stream>(q + 2, rz * inverse);
+        } else {
+            store<stream>(q, rx);
+            store<stream>(q + 1, ry);
+            store<stream>(q + 2, rz);
+        }
+    }
+
+#ifdef BRADBURY_STREAMING_STORES
+    // Non-temporal stores are weakly ordered; make them visible before the
+    // chunk counts as done.
+    if constexpr(stream) {
+        _mm_sfence();
+    }
+#endif
+}
+
+template<size_t D, bool projective, class T>
+static void transformAll(const T *m, const T *in, T *out, size_t n) {
+    bool stream = n * D * sizeof(T) > BRADBURY_STREAMING_THRESHOLD;
+    parallel::forChunks(n, grain, [&](size_t, size_t begin, size_t end) {
+        if(stream) {
+            transformRange<D, projective, true>(m, in, out, begin, end);
+        } else {
+            transformRange<D, projective, false>(m, in, out, begin, end);
+        }
+    });
+}
+
+template<class V>
+static void checkLengths(std::span<const V> in, std::span<V> out) {
+    if(in.size() != out.size()) {
+        throw std::length_error("Cannot transform " + std::to_string(in.size()) + " points into " + std::to_string(out.size()));
+    }
+}
+
+template<class T>
+void transformPoints(const Matrix<4, 4, T> &m, std::type_identity_t<std::span<const Vector<3, T>>> in, std::type_identity_t<std::span<Vector<3, T>>> out) {
+    checkLengths(in, out);
+
+    bool affine = m(3, 0) == 0 && m(3, 1) == 0 && m(3, 2) == 0 && m(3, 3) == 1;
+    const T *source = components(in).data();
+    T *destination = components(out).data();
+    if(affine) {
+        transformAll<3, false>(m.data(), source, destination, in.size());
+    } else {
+        transformAll<3, true>(m.data(), source, destination, in.size());
+    }
+}
+
+template<class T>
+void transformPoints(const Matrix<4, 4, T> &m, std::type_identity_t<std::span<const Vector<4, T>>> in, std::type_identity_t<std::span<Vector<4, T>>> out) {
+    checkLengths(in, out);
+    transformAll<4, false>(m.data(), components(in).data(), components(out).data(), in.size());
+}
+
+template void transformPoints<float>(const Matrix<4, 4, float> &m, std::span<const Vector<3, float>> in, std::span<Vector<3, float>> out);
+template void transformPoints<double>(const Matrix<4, 4, double> &m, std::span<const Vector<3, double>> in, std::span<Vector<3, double>> out);
+template void transformPoints<float>(const Matrix<4, 4, float> &m, std::span<const Vector<4, float>> in, std::span<Vector<4, float>> out);
+template void transformPoints<double>(const Matrix<4, 4, double> &m, std::span<const Vector<4, double>> in, std::span<Vector<4, double>> out);
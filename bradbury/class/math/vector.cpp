@@ -6,4 +6,41 @@
 //  Copyright (c) 2014 citelao. All rights reserved.
 //
 
-#include "vector.h"
\ No newline at end of file
+#include "vector.h"
+
+// Instantiate every member for the supported scalar types, so a change that
+// breaks one of them fails here rather than in whichever file uses it first.
+template class Vector<2, double>;
+template class Vector<3, double>;
+template class Vector<4, double>;
+template class Vector<2, float>;
+template class Vector<3, float>;
+template class Vector<4, float>;
+template class Vector<2, int32_t>;
+template class Vector<3, int32_t>;
+template class Vector<4, int32_t>;
+template class Vector<2, half>;
+template class Vector<3, half>;
+template class Vector<4, half>;
+template class Vector<2, mixed>;
+template class Vector<3, mixed>;
+template class Vector<4, mixed>;
+template class Vector<3, float, 16>;
+template class Vector<4, float, 16>;
+template class Vector<4, double, 32>;
+
+// The layout guarantees: nothing but the components, and aligned Vectors only
+// padded up to their alignment.
+static_assert(std::is_standard_layout<Vector<3>>::value, "vectors are standard layout");
+static_assert(std::is_trivially_copyable<Vector<3>>::value, "vectors can be copied with memcpy");
+static_assert(sizeof(Vector<2>) == 2 * sizeof(double), "vectors are packed");
+static_assert(sizeof(Vector<3>) == 3 * sizeof(double), "vectors are packed");
+static_assert(sizeof(Vector<4>) == 4 * sizeof(double), "vectors are packed");
+static_assert(sizeof(Vector<3, float>) == 3 * sizeof(float), "vectors are packed");
+static_assert(sizeof(Vector<3, int32_t>) == 3 * sizeof(int32_t), "vectors are packed");
+static_assert(sizeof(Vector<3, half>) == 3 * sizeof(half), "vectors are packed");
+static_assert(sizeof(Vector<3, mixed>) == 3 * sizeof(float), "vectors are packed");
+static_assert(std::is_standard_layout<Vector<3, float, 16>>::value, "aligned vectors are standard layout");
+static_assert(alignof(Vector<3, float, 16>) == 16 && sizeof(Vector<3, float, 16>) == 16, "aligned vectors are padded to their alignment");
+static_assert(alignof(Vector<4, double, 32>) == 32 && sizeof(Vector<4, double, 32>) == 32, "aligned vectors are padded to their alignment");
+static_assert(PackedVector<Vector<4, float, 16>> && !PackedVector<Vector<3, float, 16>>, "only unpadded vectors are packed");
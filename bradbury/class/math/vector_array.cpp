@@ -0,0 +1,20 @@
+//
+//  vector_array.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "vector_array.h"
+
+// As in vector.cpp, instantiate every member for the supported scalar types.
+template class VectorArray<2, double>;
+template class VectorArray<3, double>;
+template class VectorArray<4, double>;
+template class VectorArray<3, float>;
+template class VectorArray<3, int32_t>;
+template class VectorArray<3, half>;
+template class VectorArrayElement<3, double, false>;
+template class VectorArrayElement<3, double, true>;
+template class VectorArrayElement<3, half, false>;
@@ -0,0 +1,19 @@
+//
+//  vector_packet.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "vector_packet.h"
+
+// As in vector.cpp, instantiate every member for the common shapes.
+template class VectorPacket<3, 4, double>;
+template class VectorPacket<3, 8, float>;
+template class VectorPacket<3, 16, float>;
+template class VectorPacket<4, 8, float>;
+template class VectorPacket<2, 8, int32_t>;
+template class VectorPacket<1, 8, float>;
+template class PacketMask<8>;
+template class PacketMask<64>;
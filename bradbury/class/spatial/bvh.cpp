@@ -0,0 +1,302 @@
+//
+//  bvh.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "parallel.h"
+#include "reduce.h"
+
+namespace {
+    // Nodes with more primitives than this are binned in parallel chunks;
+    // smaller ones are split whole, in parallel with each other.
+    const size_t bvhGrain = reductionGrain;
+
+    // The boxes and centroids of a run of primitives.
+    template<class T>
+    struct Extent {
+        AABB<T> bounds;
+        AABB<T> centroids;
+        uint32_t count = 0;
+
+        Extent merge(const Extent &e) const {
+            return Extent{bounds.merge(e.bounds), centroids.merge(e.centroids), count + e.count};
+        };
+    };
+
+    template<class T>
+    using Bins = std::array<Extent<T>, BRADBURY_BVH_BINS>;
+
+    // A node still to be split: node `node` over primitives [begin, end).
+    template<class T>
+    struct Task {
+        uint32_t node;
+        uint32_t begin;
+        uint32_t end;
+        uint32_t depth;
+        Extent<T> extent;
+    };
+
+    // How a task was split: children over [begin, middle) and [middle, end),
+    // or a leaf when middle == end.
+    template<class T>
+    struct Split {
+        uint32_t middle;
+        Extent<T> left;
+        Extent<T> right;
+    };
+
+    // A primitive as the builder sorts it: with its box and centroid, so that
+    // splitting reads memory in order rather than through the indices.
+    template<class T>
+    struct Primitive {
+        AABB<T> box;
+        Vector<3, T> centroid;
+        uint32_t index;
+    };
+
+    // Whether a box's corners are finite and in order. Empty, infinite and
+    // NaN boxes have no centroid to bin.
+    template<class T>
+    bool bounded(const AABB<T> &box) {
+        for(size_t c = 0; c < 3; c++) {
+            T lower = box.lower().data()[c], upper = box.upper().data()[c];
+            if(!(std::isfinite(lower) && std::isfinite(upper) && lower <= upper)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<class T>
+    class Builder {
+    public:
+        static const size_t sahDepth = 64;
+
+        explicit Builder(std::span<const AABB<T>> boxes) : _primitives(boxes.size()) {
+            parallel::forChunks(boxes.size(), bvhGrain, [&](size_t, size_t begin, size_t end) {
+                for(size_t i = begin; i < end; i++) {
+                    if(!bounded(boxes[i])) {
+                        throw std::invalid_argument("Cannot build a hierarchy over box " + std::to_string(i) + ", which is empty or not finite");
+                    }
+                    _primitives[i] = Primitive<T>{boxes[i], boxes[i].center(), static_cast<uint32_t>(i)};
+                }
+            });
+        };
+
+        // The primitives, in leaf order once every task is split.
+        std::span<const Primitive<T>> primitives() const {
+            return _primitives;
+        };
+
+        // The extent of primitives [begin, end).
+        Extent<T> extent(uint32_t begin, uint32_t end) const {
+            return reduce<Extent<T>>(begin, end, [&](size_t first, size_t last) {
+                Extent<T> e;
+                for(size_t k = first; k < last; k++) {
+                    e.bounds = e.bounds.merge(_primitives[k].box);
+                    e.centroids = e.centroids.merge(_primitives[k].centroid);
+                }
+                e.count = static_cast<uint32_t>(last - first);
+                return e;
+            }, [](const Extent<T> &a, const Extent<T> &b) {
+                return a.merge(b);
+            });
+        };
+
+        Split<T> split(const Task<T> &task) {
+            size_t count = task.end - task.begin;
+            if(count <= BRADBURY_BVH_LEAF) {
+                return {task.end, {}, {}};
+            }
+
+            Vector<3, T> lower = task.extent.centroids.lower();
+            Vector<3, T> size = task.extent.centroids.extent();
+            size_t axis = size.x() >= size.y() && size.x() >= size.z() ? 0 : (size.y() >= size.z() ? 1 : 2);
+            if(size.data()[axis] <= 0) {
+                // Every centroid in one place: no plane separates them.
+                return halves(task, task.begin + static_cast<uint32_t>(count / 2));
+            }
+            if(task.depth >= sahDepth) {
+                return halves(task, median(task, axis));
+            }
+
+            // Bin along the longest axis of the centroids, then sweep for the
+            // cheapest boundary. The bins also carry each side's extent, so
+            // the children need no pass of their own. Small nodes use fewer
+            // bins: the sweep would cost more than the primitives.
+            size_t used = std::min(count, static_cast<size_t>(BRADBURY_BVH_BINS));
+            T scale = used / size.data()[axis];
+            if(!std::isfinite(scale)) {
+                // Centroids too close together to tell apart in T.
+                return halves(task, median(task, axis));
+            }
+            Bins<T> bins = reduce<Bins<T>>(task.begin, task.end, [&](size_t begin, size_t end) {
+                Bins<T> b;
+                for(size_t k = begin; k < end; k++) {
+                    const Primitive<T> &p = _primitives[k];
+                    Extent<T> &bin = b[binOf(p.centroid, lower, scale, axis, used)];
+                    bin.bounds = bin.bounds.merge(p.box);
+                    bin.centroids = bin.centroids.merge(p.centroid);
+                    bin.count++;
+                }
+                return b;
+            }, [&](const Bins<T> &a, const Bins<T> &b) {
+                Bins<T> merged;
+                for(size_t j = 0; j < used; j++) {
+                    merged[j] = a[j].merge(b[j]);
+                }
+                return merged;
+            });
+
+            // right[j]: bins [j, BINS) on the right.
+            std::array<Extent<T>, BRADBURY_BVH_BINS> right;
+            right[used - 1] = bins[used - 1];
+            for(size_t j = used - 2; j > 0; j--) {
+                right[j] = bins[j].merge(right[j + 1]);
+            }
+
+            T bestCost = std::numeric_limits<T>::infinity();
+            size_t bestBin = 0;
+            Extent<T> left, bestLeft;
+            for(size_t j = 1; j < used; j++) {
+                left = left.merge(bins[j - 1]);
+                T cost = left.bounds.surfacearea() * left.count + right[j].bounds.surfacearea() * right[j].count;
+                if(left.count > 0 && right[j].count > 0 && cost < bestCost) {
+                    bestCost = cost;
+                    bestBin = j;
+                    bestLeft = left;
+                }
+            }
+
+            if(bestBin == 0) {
+                return halves(task, median(task, axis));
+            }
+
+            auto middle = std::partition(_primitives.begin() + task.begin, _primitives.begin() + task.end, [&](const Primitive<T> &p) {
+                return binOf(p.centroid, lower, scale, axis, used) < bestBin;
+            });
+            return {static_cast<uint32_t>(middle - _primitives.begin()), bestLeft, right[bestBin]};
+        };
+
+    private:
+        // split() reorders only its own task's run, so tasks may be split
+        // side by side.
+        std::vector<Primitive<T>> _primitives;
+
+        // scale is finite (split() gives up on binning before it is not), so
+        // offset is in [0, bins] and never NaN.
+        static size_t binOf(const Vector<3, T> &centroid, const Vector<3, T> &lower, T scale, size_t axis, size_t bins) {
+            T offset = (centroid.data()[axis] - lower.data()[axis]) * scale;
+            return std::min(static_cast<size_t>(offset), bins - 1);
+        };
+
+        // Splits the task in half by centroid along `axis`.
+        uint32_t median(const Task<T> &task, size_t axis) {
+            uint32_t middle = task.begin + (task.end - task.begin) / 2;
+            std::nth_element(_primitives.begin() + task.begin, _primitives.begin() + middle, _primitives.begin() + task.end, [&](const Primitive<T> &a, const Primitive<T> &b) {
+                return a.centroid.data()[axis] < b.centroid.data()[axis];
+            });
+            return middle;
+        };
+
+        // A split at `middle` that did not come from bins, so it measures
+        // both sides.
+        Split<T> halves(const Task<T> &task, uint32_t middle) {
+            return {middle, extent(task.begin, middle), extent(middle, task.end)};
+        };
+
+        // f over primitives [begin, end), in parallel chunks folded in order
+        // for large runs; see reduction::chunked().
+        template<class R, class F, class M>
+        R reduce(uint32_t begin, uint32_t end, F f, M merge) const {
+            size_t count = end - begin;
+            if(count <= bvhGrain) {
+                return f(begin, end);
+            }
+            return reduction::chunked<R>(count, [&](size_t first, size_t last) {
+                return f(begin + first, begin + last);
+            }, merge);
+        };
+    };
+}
+
+template<class T>
+BVH<T>::BVH(std::span<const AABB<T>> boxes) {
+    static_assert(BVH<T>::sahDepth == Builder<T>::sahDepth, "the builder and the traversal agree on the depth limit");
+    if(boxes.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Cannot build a hierarchy of " + std::to_string(boxes.size()) + " boxes");
+    }
+    if(boxes.empty()) {
+        return;
+    }
+
+    Builder<T> builder(boxes);
+
+    uint32_t count = static_cast<uint32_t>(boxes.size());
+    _nodes.push_back(Node{AABB<T>(), 0, 0});
+    std::vector<Task<T>> level = {Task<T>{0, 0, count, 0, builder.extent(0, count)}};
+    while(!level.empty()) {
+        std::vector<Split<T>> splits(level.size());
+
+        // Large nodes one at a time, each across every thread; then the rest
+        // side by side.
+        for(size_t t = 0; t < level.size(); t++) {
+            if(level[t].end - level[t].begin > bvhGrain) {
+                splits[t] = builder.split(level[t]);
+            }
+        }
+        parallel::forChunks(level.size(), 16, [&](size_t, size_t begin, size_t end) {
+            for(size_t t = begin; t < end; t++) {
+                if(level[t].end - level[t].begin <= bvhGrain) {
+                    splits[t] = builder.split(level[t]);
+                }
+            }
+        });
+
+        std::vector<Task<T>> next;
+        for(size_t t = 0; t < level.size(); t++) {
+            const Task<T> &task = level[t];
+            Node &node = _nodes[task.node];
+            node.bounds = task.extent.bounds;
+            if(splits[t].middle == task.end) {
+                node.start = task.begin;
+                node.count = task.end - task.begin;
+                continue;
+            }
+
+            uint32_t left = static_cast<uint32_t>(_nodes.size());
+            node.start = left;
+            node.count = 0;
+            _nodes.push_back(Node{AABB<T>(), 0, 0});
+            _nodes.push_back(Node{AABB<T>(), 0, 0});
+            next.push_back(Task<T>{left, task.begin, splits[t].middle, task.depth + 1, splits[t].left});
+            next.push_back(Task<T>{left + 1, splits[t].middle, task.end, task.depth + 1, splits[t].right});
+        }
+        level = std::move(next);
+    }
+
+    std::span<const Primitive<T>> primitives = builder.primitives();
+    _indices.resize(boxes.size());
+    _boxes.resize(boxes.size());
+    parallel::forChunks(boxes.size(), bvhGrain, [&](size_t, size_t begin, size_t end) {
+        for(size_t k = begin; k < end; k++) {
+            _indices[k] = primitives[k].index;
+            _boxes[k] = primitives[k].box;
+        }
+    });
+}
+
+// As in vector.cpp, instantiate every member for the supported scalar types.
+template class BVH<double>;
+template class BVH<float>;
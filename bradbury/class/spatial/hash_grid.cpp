@@ -0,0 +1,236 @@
+//
+//  hash_grid.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "hash_grid.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+template<size_t D, class T>
+HashGrid<D, T>::HashGrid(T cellSize) : _cellSize(cellSize), _inverse(1 / cellSize) {
+    if(!(cellSize > 0)) {
+        throw std::invalid_argument("Cannot make a grid of cell size " + std::to_string(cellSize));
+    }
+}
+
+template<size_t D, class T>
+typename HashGrid<D, T>::Key HashGrid<D, T>::key(const Vector<D, T> &position) const {
+    Key key;
+    for(size_t a = 0; a < D; a++) {
+        key[a] = static_cast<int32_t>(std::floor(position.data()[a] * _inverse));
+    }
+    return key;
+}
+
+template<size_t D, class T>
+uint32_t HashGrid<D, T>::insert(const Vector<D, T> &position) {
+    uint32_t id;
+    if(_free.empty()) {
+        id = static_cast<uint32_t>(_objects.size());
+        _objects.push_back(Object{position, none, 0});
+    } else {
+        id = _free.back();
+        _free.pop_back();
+        _objects[id].position = position;
+    }
+    place(id, findOrAdd(key(position)));
+    return id;
+}
+
+template<size_t D, class T>
+void HashGrid<D, T>::move(uint32_t id, const Vector<D, T> &position) {
+    check(id);
+    Object &object = _objects[id];
+    object.position = position;
+    Key to = key(position);
+    if(to == _cells[object.cell].key) {
+        return;
+    }
+
+    // Out of the old cell first: rebuilding the table may drop it.
+    remove(id);
+    place(id, findOrAdd(to));
+}
+
+template<size_t D, class T>
+void HashGrid<D, T>::move(std::span<const Vector<D, T>> positions) {
+    for(size_t i = 0; i < positions.size(); i++) {
+        move(static_cast<uint32_t>(i), positions[i]);
+    }
+}
+
+template<size_t D, class T>
+void HashGrid<D, T>::erase(uint32_t id) {
+    check(id);
+    remove(id);
+    _objects[id].cell = none;
+    _free.push_back(id);
+}
+
+template<size_t D, class T>
+const Vector<D, T> &HashGrid<D, T>::position(uint32_t id) const {
+    check(id);
+    return _objects[id].position;
+}
+
+template<size_t D, class T>
+size_t HashGrid<D, T>::hash(const Key &key) {
+    uint64_t h = 0;
+    for(size_t a = 0; a < D; a++) {
+        h = (h ^ static_cast<uint32_t>(key[a])) * 0x9e3779b97f4a7c15ull;
+    }
+    return static_cast<size_t>(h ^ (h >> 32));
+}
+
+template<size_t D, class T>
+typename HashGrid<D, T>::Key HashGrid<D, T>::shift(const Key &key, const Key &offset) {
+    // Wraps rather than overflowing at the edge of the supported range.
+    Key shifted;
+    for(size_t a = 0; a < D; a++) {
+        shifted[a] = static_cast<int32_t>(static_cast<uint32_t>(key[a]) + static_cast<uint32_t>(offset[a]));
+    }
+    return shifted;
+}
+
+template<size_t D, class T>
+const std::vector<typename HashGrid<D, T>::Key> &HashGrid<D, T>::neighbourhood() {
+    static const std::vector<Key> offsets = [] {
+        std::vector<Key> all;
+        for(size_t n = 0; n < (D == 2 ? 9 : 27); n++) {
+            Key offset;
+            size_t rest = n;
+            for(size_t a = 0; a < D; a++) {
+                offset[a] = static_cast<int32_t>(rest % 3) - 1;
+                rest /= 3;
+            }
+            all.push_back(offset);
+        }
+        return all;
+    }();
+    return offsets;
+}
+
+template<size_t D, class T>
+const std::vector<typename HashGrid<D, T>::Key> &HashGrid<D, T>::forward() {
+    // Those whose first nonzero component is positive.
+    static const std::vector<Key> offsets = [] {
+        std::vector<Key> half;
+        for(const Key &offset : neighbourhood()) {
+            for(size_t a = 0; a < D; a++) {
+                if(offset[a] != 0) {
+                    if(offset[a] > 0) {
+                        half.push_back(offset);
+                    }
+                    break;
+                }
+            }
+        }
+        return half;
+    }();
+    return offsets;
+}
+
+template<size_t D, class T>
+uint32_t HashGrid<D, T>::find(const Key &key) const {
+    if(_table.empty()) {
+        return none;
+    }
+
+    size_t mask = _table.size() - 1;
+    for(size_t i = hash(key) & mask; _table[i] != none; i = (i + 1) & mask) {
+        if(_cells[_table[i]].key == key) {
+            return _table[i];
+        }
+    }
+    return none;
+}
+
+template<size_t D, class T>
+uint32_t HashGrid<D, T>::findOrAdd(const Key &key) {
+    uint32_t cell = find(key);
+    if(cell != none) {
+        return cell;
+    }
+
+    if((_cells.size() + 1) * 2 > _table.size()) {
+        rebuild();
+    }
+    cell = static_cast<uint32_t>(_cells.size());
+    _cells.push_back(Cell{key, {}});
+
+    size_t mask = _table.size() - 1;
+    size_t i = hash(key) & mask;
+    while(_table[i] != none) {
+        i = (i + 1) & mask;
+    }
+    _table[i] = cell;
+    return cell;
+}
+
+template<size_t D, class T>
+void HashGrid<D, T>::rebuild() {
+    // Drop the empty cells, renumbering the rest, and leave room for as many
+    // again before the next rebuild.
+    std::vector<Cell> kept;
+    for(Cell &cell : _cells) {
+        if(cell.objects.empty()) {
+            continue;
+        }
+        for(uint32_t id : cell.objects) {
+            _objects[id].cell = static_cast<uint32_t>(kept.size());
+        }
+        kept.push_back(std::move(cell));
+    }
+    _cells = std::move(kept);
+
+    size_t capacity = 16;
+    while(capacity < 4 * (_cells.size() + 1)) {
+        capacity *= 2;
+    }
+    _table.assign(capacity, none);
+    size_t mask = capacity - 1;
+    for(size_t c = 0; c < _cells.size(); c++) {
+        size_t i = hash(_cells[c].key) & mask;
+        while(_table[i] != none) {
+            i = (i + 1) & mask;
+        }
+        _table[i] = static_cast<uint32_t>(c);
+    }
+}
+
+template<size_t D, class T>
+void HashGrid<D, T>::place(uint32_t id, uint32_t cell) {
+    std::vector<uint32_t> &objects = _cells[cell].objects;
+    _objects[id].cell = cell;
+    _objects[id].slot = static_cast<uint32_t>(objects.size());
+    objects.push_back(id);
+}
+
+template<size_t D, class T>
+void HashGrid<D, T>::remove(uint32_t id) {
+    const Object &object = _objects[id];
+    std::vector<uint32_t> &objects = _cells[object.cell].objects;
+    uint32_t last = objects.back();
+    objects[object.slot] = last;
+    _objects[last].slot = object.slot;
+    objects.pop_back();
+}
+
+template<size_t D, class T>
+void HashGrid<D, T>::check(uint32_t id) const {
+    if(id >= _objects.size() || _objects[id].cell == none) {
+        throw std::out_of_range("no object " + std::to_string(id));
+    }
+}
+
+// As in vector.cpp, instantiate every member for the supported scalar types.
+template class HashGrid<2, double>;
+template class HashGrid<3, double>;
+template class HashGrid<2, float>;
+template class HashGrid<3, float>;
@@ -0,0 +1,15 @@
+//
+//  kd_tree.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "kd_tree.h"
+
+// As in vector.cpp, instantiate every member for the supported scalar types.
+template class KDTree<2, double>;
+template class KDTree<3, double>;
+template class KDTree<2, float>;
+template class KDTree<3, float>;
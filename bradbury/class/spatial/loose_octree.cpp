@@ -0,0 +1,223 @@
+//
+//  loose_octree.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "loose_octree.h"
+
+#include <stdexcept>
+#include <string>
+
+template<class T>
+LooseOctree<T>::LooseOctree(const AABB<T> &world) {
+    if(world.empty()) {
+        throw std::invalid_argument("Cannot make an octree over an empty world");
+    }
+
+    Vector<3, T> extent = world.extent();
+    T side = std::max(std::max(extent.x(), extent.y()), extent.z());
+    _nodes.push_back(Node{world.center(), side / 2, 0, none, none, none, 0, 0});
+}
+
+template<class T>
+uint32_t LooseOctree<T>::insert(const AABB<T> &box) {
+    uint32_t id;
+    if(_free.empty()) {
+        id = static_cast<uint32_t>(_objects.size());
+        _objects.push_back(Object{box, none, none, none});
+    } else {
+        id = _free.back();
+        _free.pop_back();
+        _objects[id].box = box;
+    }
+
+    uint32_t node = descend(0, box);
+    link(id, node);
+    adjust(node, 1);
+    return id;
+}
+
+template<class T>
+void LooseOctree<T>::update(uint32_t id, const AABB<T> &box) {
+    check(id);
+    _objects[id].box = box;
+    uint32_t from = _objects[id].node;
+    if(loose(_nodes[from]).contains(box)) {
+        return;
+    }
+
+    // Nothing is pooled until the object is in place, so `start` stays valid.
+    uint32_t start = from;
+    while(start != 0 && !loose(_nodes[start]).contains(box)) {
+        start = _nodes[start].parent;
+    }
+    unlink(id);
+    adjust(from, -1);
+    uint32_t to = descend(start, box);
+    link(id, to);
+    adjust(to, 1);
+    prune(from);
+}
+
+template<class T>
+void LooseOctree<T>::erase(uint32_t id) {
+    check(id);
+    uint32_t from = _objects[id].node;
+    unlink(id);
+    adjust(from, -1);
+    prune(from);
+    _objects[id].node = none;
+    _free.push_back(id);
+}
+
+template<class T>
+const AABB<T> &LooseOctree<T>::bounds(uint32_t id) const {
+    check(id);
+    return _objects[id].box;
+}
+
+template<class T>
+uint32_t LooseOctree<T>::node(uint32_t id) const {
+    check(id);
+    return _objects[id].node;
+}
+
+template<class T>
+uint32_t LooseOctree<T>::octant(uint32_t node, const AABB<T> &box) const {
+    const Node &parent = _nodes[node];
+    if(parent.depth == BRADBURY_OCTREE_DEPTH) {
+        return none;
+    }
+
+    Vector<3, T> center = box.center();
+    uint32_t octant = (center.x() >= parent.center.x() ? 1 : 0) | (center.y() >= parent.center.y() ? 2 : 0) | (center.z() >= parent.center.z() ? 4 : 0);
+
+    // The child's loose bounds, whether or not it has been made.
+    T half = parent.half / 2;
+    Vector<3, T> childCenter(parent.center.x() + (octant & 1 ? half : -half),
+                             parent.center.y() + (octant & 2 ? half : -half),
+                             parent.center.z() + (octant & 4 ? half : -half));
+    if(!AABB<T>::around(childCenter, half * T(BRADBURY_OCTREE_LOOSENESS)).contains(box)) {
+        return none;
+    }
+    return octant;
+}
+
+template<class T>
+uint32_t LooseOctree<T>::descend(uint32_t node, const AABB<T> &box) {
+    while(true) {
+        uint32_t child = octant(node, box);
+        if(child == none) {
+            return node;
+        }
+        if(_nodes[node].children == none) {
+            if(_nodes[node].own < BRADBURY_OCTREE_CAPACITY) {
+                return node;
+            }
+            split(node);
+        }
+        node = _nodes[node].children + child;
+    }
+}
+
+template<class T>
+void LooseOctree<T>::split(uint32_t node) {
+    uint32_t children = allocate(node);
+    _nodes[node].children = children;
+
+    // Down a level, for those objects that fit; the node's count is unchanged.
+    uint32_t id = _nodes[node].first;
+    while(id != none) {
+        uint32_t next = _objects[id].next;
+        uint32_t child = octant(node, _objects[id].box);
+        if(child != none) {
+            unlink(id);
+            link(id, children + child);
+            _nodes[children + child].count++;
+        }
+        id = next;
+    }
+}
+
+template<class T>
+uint32_t LooseOctree<T>::allocate(uint32_t parent) {
+    uint32_t block;
+    if(_freeBlocks.empty()) {
+        block = static_cast<uint32_t>(_nodes.size());
+        _nodes.resize(_nodes.size() + 8);
+    } else {
+        block = _freeBlocks.back();
+        _freeBlocks.pop_back();
+    }
+
+    const Node &p = _nodes[parent];
+    T half = p.half / 2;
+    for(uint32_t octant = 0; octant < 8; octant++) {
+        Vector<3, T> center(p.center.x() + (octant & 1 ? half : -half),
+                            p.center.y() + (octant & 2 ? half : -half),
+                            p.center.z() + (octant & 4 ? half : -half));
+        _nodes[block + octant] = Node{center, half, p.depth + 1, parent, none, none, 0, 0};
+    }
+    return block;
+}
+
+template<class T>
+void LooseOctree<T>::link(uint32_t id, uint32_t node) {
+    Object &object = _objects[id];
+    object.node = node;
+    object.previous = none;
+    object.next = _nodes[node].first;
+    if(object.next != none) {
+        _objects[object.next].previous = id;
+    }
+    _nodes[node].first = id;
+    _nodes[node].own++;
+}
+
+template<class T>
+void LooseOctree<T>::unlink(uint32_t id) {
+    const Object &object = _objects[id];
+    if(object.previous != none) {
+        _objects[object.previous].next = object.next;
+    } else {
+        _nodes[object.node].first = object.next;
+    }
+    if(object.next != none) {
+        _objects[object.next].previous = object.previous;
+    }
+    _nodes[object.node].own--;
+}
+
+template<class T>
+void LooseOctree<T>::adjust(uint32_t node, int delta) {
+    for(; node != none; node = _nodes[node].parent) {
+        _nodes[node].count += delta;
+    }
+}
+
+template<class T>
+void LooseOctree<T>::prune(uint32_t node) {
+    // Walking up, a node's children empty no later than it does, so each
+    // pooled block is already free of children of its own.
+    for(; node != none; node = _nodes[node].parent) {
+        Node &n = _nodes[node];
+        if(n.count == 0 && n.children != none) {
+            _freeBlocks.push_back(n.children);
+            n.children = none;
+        }
+    }
+}
+
+template<class T>
+void LooseOctree<T>::check(uint32_t id) const {
+    if(id >= _objects.size() || _objects[id].node == none) {
+        throw std::out_of_range("no object " + std::to_string(id));
+    }
+}
+
+// As in vector.cpp, instantiate every member for the supported scalar types.
+template class LooseOctree<double>;
+template class LooseOctree<float>;
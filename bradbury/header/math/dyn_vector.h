@@ -0,0 +1,372 @@
+//
+//  dyn_vector.h
+//  bradbury
+//
+//  A vector whose dimension is only known at runtime, for data that would
+//  otherwise need a switch over Vector<D> instantiations.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_dyn_vector_h
+#define bradbury_dyn_vector_h
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mutable_vector.h"
+#include "simd.h"
+#include "vector.h"
+
+// Components up to this many are stored inside the DynVector itself; only
+// longer vectors allocate.
+#ifndef BRADBURY_DYN_VECTOR_INLINE
+#define BRADBURY_DYN_VECTOR_INLINE 8
+#endif
+
+// The operations of Vector, on a dimension chosen at runtime. Like Vector it
+// is immutable and every operation returns a new DynVector; unlike Vector the
+// operations are evaluated eagerly, and combining vectors of different
+// dimensions throws std::length_error.
+//
+// Up to BRADBURY_DYN_VECTOR_INLINE components live in a buffer inside the
+// object, so the 2-, 3- and 4-dimensional vectors of a mixed workload never
+// touch the heap. Whole-vector operations on more than BRADBURY_UNROLL_LIMIT
+// components run on the same SIMD kernels as Vector's; shorter ones, like
+// Vector's, are plain loops.
+//
+// A Vector<D> converts implicitly; converting back is explicit and checks the
+// dimension: `Vector<3> v = static_cast<Vector<3>>(dyn)`.
+template<class T = double>
+class DynVector {
+public:
+    typedef T scalar_type;
+    typedef typename ScalarTraits<T>::compute_type value_type;
+    typedef typename std::conditional<std::is_floating_point<value_type>::value, value_type, double>::type real_type;
+
+    static constexpr size_t inlineCapacity = BRADBURY_DYN_VECTOR_INLINE;
+
+    // Default constructor: no components.
+    DynVector() : _size(0), _components(_inline) {};
+
+    // Default value constructor
+    template <class U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+    DynVector(size_t dimension, U r) : DynVector(allocate(dimension)) {
+        std::fill(_components, _components + _size, static_cast<T>(r));
+    };
+    explicit DynVector(size_t dimension) : DynVector(dimension, 0) {};
+
+    // List & vector constructors
+    template <class U>
+    DynVector(std::initializer_list<U> components) : DynVector(allocate(components.size())) {
+        std::transform(components.begin(), components.end(), _components, [](U u) { return static_cast<T>(u); });
+    };
+    template <class U>
+    DynVector(std::vector<U> const &components) : DynVector(allocate(components.size())) {
+        std::transform(components.begin(), components.end(), _components, [](U u) { return static_cast<T>(u); });
+    };
+    explicit DynVector(std::span<const T> components) : DynVector(allocate(components.size())) {
+        std::copy(components.begin(), components.end(), _components);
+    };
+
+    // Vector conversions
+    template <size_t D, size_t A>
+    DynVector(Vector<D, T, A> const &vector) : DynVector(std::span<const T>(vector.data(), D)) {};
+    template <size_t D, size_t A>
+    explicit operator Vector<D, T, A>() const {
+        checkDimension(D);
+        MutableVector<D, T, A> vector;
+        std::copy(_components, _components + D, vector.data());
+        return vector;
+    };
+
+    // Copy and move constructors
+    DynVector(DynVector const &vector) : DynVector(std::span<const T>(vector._components, vector._size)) {};
+    DynVector(DynVector &&vector) noexcept : _size(vector._size), _components(_inline) {
+        if(vector.inlined()) {
+            std::copy(vector._components, vector._components + _size, _inline);
+        } else {
+            _components = vector._components;
+        }
+        vector._size = 0;
+        vector._components = vector._inline;
+    };
+    DynVector &operator=(DynVector const &vector) {
+        if(this != &vector) {
+            *this = DynVector(vector);
+        }
+        return *this;
+    };
+    DynVector &operator=(DynVector &&vector) noexcept {
+        if(this != &vector) {
+            release();
+            _size = vector._size;
+            _components = _inline;
+            if(vector.inlined()) {
+                std::copy(vector._components, vector._components + _size, _inline);
+            } else {
+                _components = vector._components;
+            }
+            vector._size = 0;
+            vector._components = vector._inline;
+        }
+        return *this;
+    };
+    ~DynVector() {
+        release();
+    };
+
+    // Access operators
+    const T operator[](size_t i) const {
+#if BRADBURY_CHECKED_ACCESS
+        if(i >= _size) [[unlikely]] {
+            throw std::out_of_range("no " + std::to_string(i) + " component for dimension " + std::to_string(_size));
+        }
+#endif
+
+        return _components[i];
+    };
+    value_type evaluate(size_t i) const {
+        return static_cast<value_type>(_components[i]);
+    };
+
+    // The components as a contiguous array.
+    const T *data() const {
+        return _components;
+    };
+
+    size_t dimension() const {
+        return _size;
+    };
+    // Whether the components are stored inside the object rather than on the
+    // heap.
+    bool inlined() const {
+        return _components == _inline;
+    };
+
+    bool operator==(const DynVector &nv) const {
+        if(_size != nv._size) {
+            return false;
+        }
+        for(size_t i = 0; i < _size; i++) {
+            value_type diff = nv.evaluate(i) - evaluate(i);
+            if(diff > Vector<1, T>::tolerance || -diff > Vector<1, T>::tolerance) {
+                return false;
+            }
+        }
+        return true;
+    };
+    bool operator!=(const DynVector &nv) const {
+        return !this->operator==(nv);
+    };
+
+    // vector-vector operations
+    DynVector operator+(const DynVector &nv) const {
+        checkDimension(nv._size);
+        DynVector result = allocate(_size);
+        if constexpr(simd::supported<T>) {
+            if(_size > BRADBURY_UNROLL_LIMIT) {
+                simd::kernels<T>().add(_components, nv._components, result._components, _size);
+                return result;
+            }
+        }
+        for(size_t i = 0; i < _size; i++) {
+            result._components[i] = static_cast<T>(evaluate(i) + nv.evaluate(i));
+        }
+        return result;
+    };
+    DynVector operator-(const DynVector &nv) const {
+        checkDimension(nv._size);
+        DynVector result = allocate(_size);
+        if constexpr(simd::supported<T>) {
+            if(_size > BRADBURY_UNROLL_LIMIT) {
+                simd::kernels<T>().subtract(_components, nv._components, result._components, _size);
+                return result;
+            }
+        }
+        for(size_t i = 0; i < _size; i++) {
+            result._components[i] = static_cast<T>(evaluate(i) - nv.evaluate(i));
+        }
+        return result;
+    };
+    DynVector operator-() const {
+        DynVector result = allocate(_size);
+        if constexpr(simd::supported<T>) {
+            if(_size > BRADBURY_UNROLL_LIMIT) {
+                simd::kernels<T>().negate(_components, result._components, _size);
+                return result;
+            }
+        }
+        for(size_t i = 0; i < _size; i++) {
+            result._components[i] = static_cast<T>(-evaluate(i));
+        }
+        return result;
+    };
+
+    value_type dot(const DynVector &nv) const {
+        checkDimension(nv._size);
+        if constexpr(simd::supported<T>) {
+            if(_size > BRADBURY_UNROLL_LIMIT) {
+                return simd::kernels<T>().dot(_components, nv._components, _size);
+            }
+        }
+
+        value_type result = 0;
+        for(size_t i = 0; i < _size; i++) {
+            result += evaluate(i) * nv.evaluate(i);
+        }
+        return result;
+    };
+    DynVector cross(const DynVector &nv) const {
+        if(_size != 3 || nv._size != 3) {
+            throw std::length_error("Cannot take the cross product of dimensions " + std::to_string(_size) + " and " + std::to_string(nv._size));
+        }
+
+        return DynVector(static_cast<Vector<3, T>>(*this).cross(static_cast<Vector<3, T>>(nv)));
+    };
+
+    // vector-number operations
+    template <class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+    DynVector operator*(S d) const {
+        DynVector result = allocate(_size);
+        if constexpr(simd::supported<T>) {
+            if(_size > BRADBURY_UNROLL_LIMIT) {
+                simd::kernels<T>().scale(_components, static_cast<T>(d), result._components, _size);
+                return result;
+            }
+        }
+        for(size_t i = 0; i < _size; i++) {
+            result._components[i] = static_cast<T>(evaluate(i) * d);
+        }
+        return result;
+    };
+    template <class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+    DynVector operator/(S d) const {
+        if constexpr(std::is_floating_point<value_type>::value) {
+            return *this * (1 / static_cast<value_type>(d));
+        }
+
+        DynVector result = allocate(_size);
+        for(size_t i = 0; i < _size; i++) {
+            result._components[i] = static_cast<T>(evaluate(i) / d);
+        }
+        return result;
+    };
+
+    // reductions
+    value_type squaredmagnitude() const {
+        return dot(*this);
+    };
+    real_type magnitude() const {
+        return std::sqrt(static_cast<real_type>(squaredmagnitude()));
+    };
+    value_type squareddistance(const DynVector &nv) const {
+        checkDimension(nv._size);
+        if constexpr(simd::supported<T>) {
+            if(_size > BRADBURY_UNROLL_LIMIT) {
+                return simd::kernels<T>().squaredDistance(_components, nv._components, _size);
+            }
+        }
+
+        value_type result = 0;
+        for(size_t i = 0; i < _size; i++) {
+            value_type diff = evaluate(i) - nv.evaluate(i);
+            result += diff * diff;
+        }
+        return result;
+    };
+    real_type distance(const DynVector &nv) const {
+        return std::sqrt(static_cast<real_type>(squareddistance(nv)));
+    };
+
+    // A unit vector in the same direction, as Vector::normalize(). The zero
+    // vector is returned unchanged.
+    DynVector normalize() const requires std::is_floating_point<value_type>::value {
+        value_type length = magnitude();
+        if(length == 0) {
+            return *this;
+        }
+
+        return *this * (1 / length);
+    };
+    // As Vector::fastnormalize().
+    DynVector fastnormalize() const requires std::is_floating_point<value_type>::value {
+        value_type squared = squaredmagnitude();
+        if(squared == 0) {
+            return *this;
+        }
+
+        return *this * simd::approximateInverseSqrt(squared);
+    };
+
+    T mincomponent() const {
+        checkNotEmpty();
+        return *std::min_element(_components, _components + _size);
+    };
+    T maxcomponent() const {
+        checkNotEmpty();
+        return *std::max_element(_components, _components + _size);
+    };
+
+    // Linear interpolation: this vector at t = 0, nv at t = 1.
+    template <class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+    DynVector lerp(const DynVector &nv, S t) const {
+        checkDimension(nv._size);
+        DynVector result = allocate(_size);
+        for(size_t i = 0; i < _size; i++) {
+            result._components[i] = static_cast<T>(evaluate(i) * (1 - t) + nv.evaluate(i) * t);
+        }
+        return result;
+    };
+
+private:
+    size_t _size;
+    T *_components;
+    T _inline[inlineCapacity];
+
+    // A vector of the given dimension with uninitialized components.
+    static DynVector allocate(size_t dimension) {
+        DynVector vector;
+        vector._size = dimension;
+        if(dimension > inlineCapacity) {
+            vector._components = new T[dimension];
+        }
+        return vector;
+    };
+    void release() {
+        if(!inlined()) {
+            delete[] _components;
+        }
+    };
+
+    void checkDimension(size_t dimension) const {
+        if(dimension != _size) {
+            throw std::length_error("Cannot combine vectors of dimension " + std::to_string(_size) + " and " + std::to_string(dimension));
+        }
+    };
+    void checkNotEmpty() const {
+        if(_size == 0) {
+            throw std::length_error("Cannot find a component of a vector of dimension 0");
+        }
+    };
+};
+
+template<class T>
+typename DynVector<T>::value_type operator*(const DynVector<T> &l, const DynVector<T> &r) {
+    return l.dot(r);
+};
+
+template<class T, class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+DynVector<T> operator*(S d, const DynVector<T> &v) {
+    return v * d;
+};
+
+#endif // bradbury_dyn_vector_h
@@ -0,0 +1,99 @@
+//
+//  half.h
+//  bradbury
+//
+//  A 16-bit IEEE 754 floating point number, for storage only. Values convert
+//  to float for any arithmetic and round back (to nearest, ties to even) when
+//  stored.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_half_h
+#define bradbury_half_h
+
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+
+class half {
+public:
+    constexpr half() = default;
+
+    template <class T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+    constexpr explicit half(T value) : _bits(fromFloat(static_cast<float>(value))) {};
+
+    constexpr operator float() const {
+        return toFloat(_bits);
+    };
+
+    constexpr uint16_t bits() const {
+        return _bits;
+    };
+    static constexpr half fromBits(uint16_t bits) {
+        half h;
+        h._bits = bits;
+        return h;
+    };
+
+private:
+    uint16_t _bits;
+
+    static constexpr uint16_t fromFloat(float value) {
+        uint32_t f = std::bit_cast<uint32_t>(value);
+        uint32_t sign = (f >> 16) & 0x8000;
+        uint32_t magnitude = f & 0x7fffffff;
+
+        // NaN stays NaN (quiet), infinity and overflow become infinity.
+        if(magnitude > 0x7f800000) {
+            return static_cast<uint16_t>(sign | 0x7e00);
+        }
+        if(magnitude >= 0x477ff000) {
+            return static_cast<uint16_t>(sign | 0x7c00);
+        }
+
+        // Too small for a subnormal half: signed zero.
+        if(magnitude < 0x33000001) {
+            return static_cast<uint16_t>(sign);
+        }
+
+        uint32_t exponent = magnitude >> 23;
+        uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+
+        // Normal halves keep 10 of the 23 mantissa bits; subnormals lose more.
+        uint32_t shift = exponent < 113 ? 126 - exponent : 13;
+        uint32_t rounded = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if(remainder > halfway || (remainder == halfway && (rounded & 1))) {
+            rounded++;
+        }
+
+        if(exponent < 113) {
+            return static_cast<uint16_t>(sign | rounded);
+        }
+
+        // Carrying out of the mantissa correctly bumps the exponent.
+        return static_cast<uint16_t>(sign | (((exponent - 112) << 10) + (rounded - 0x400)));
+    };
+
+    static constexpr float toFloat(uint16_t h) {
+        uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+        uint32_t exponent = (h >> 10) & 0x1f;
+        uint32_t mantissa = h & 0x3ff;
+
+        if(exponent == 0x1f) {
+            return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+        }
+        if(exponent == 0) {
+            // Subnormal (or zero): mantissa * 2^-24, exact in float.
+            float value = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+            return sign ? -value : value;
+        }
+
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    };
+};
+
+#endif // bradbury_half_h
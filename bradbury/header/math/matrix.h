@@ -0,0 +1,303 @@
+//
+//  matrix.h
+//  bradbury
+//
+//  An immutable R x C matrix of doubles (or any other scalar type), with
+//  matrix-vector and matrix-matrix products and the usual transform builders.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_matrix_h
+#define bradbury_matrix_h
+
+#include <cmath>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "mutable_vector.h"
+#include "simd.h"
+#include "vector.h"
+
+// Products are blocked into tiles of this many rows and columns once any
+// dimension grows past the unroll limit, so each tile of both operands stays
+// in cache while it is used.
+#ifndef BRADBURY_MATRIX_BLOCK
+#define BRADBURY_MATRIX_BLOCK 64
+#endif
+
+// Elements are stored inline, row-major, like a Vector's components: a
+// Matrix never allocates, so large ones belong on the heap.
+//
+// Vectors are columns: `m * v` transforms v, and `a * b` applies b first. The
+// 4x4 builders follow the OpenGL conventions (translation in the last column,
+// right-handed, clip space from -1 to 1).
+//
+// Products pick their algorithm by size. Small matrices are plain unrolled
+// loops; 4x4 products of floats or doubles run on the multiply4x4 SIMD kernel;
+// anything with a dimension past the unroll limit is cache-blocked, with the
+// innermost loop an axpy kernel along a row of the result.
+template<size_t R, size_t C, class T = double>
+class Matrix {
+    template<size_t, size_t, class>
+    friend class Matrix;
+
+public:
+    typedef T scalar_type;
+    typedef typename ScalarTraits<T>::compute_type value_type;
+
+    // Default constructor: the zero matrix.
+    constexpr Matrix() : Matrix(0) {};
+
+    // Default value constructor
+    template <class U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+    constexpr explicit Matrix(U r) {
+        for(size_t i = 0; i < R * C; i++) {
+            _elements[i] = static_cast<T>(r);
+        }
+    };
+
+    // List constructor, row by row.
+    template <class U>
+    constexpr Matrix(std::initializer_list<U> elements) {
+        if(elements.size() != R * C) {
+            throw std::length_error("Cannot initalize matrix of size " + std::to_string(elements.size()) + " for dimensions " + std::to_string(R) + "x" + std::to_string(C));
+        }
+
+        size_t i = 0;
+        for(U u : elements) {
+            _elements[i++] = static_cast<T>(u);
+        }
+    };
+
+    constexpr Matrix(Matrix const &matrix) = default;
+    constexpr Matrix &operator=(Matrix const &matrix) = default;
+
+    static constexpr Matrix identity() requires (R == C) {
+        Matrix m;
+        for(size_t i = 0; i < R; i++) {
+            m._elements[i * C + i] = static_cast<T>(1);
+        }
+        return m;
+    };
+
+    // Access operators
+    constexpr const T operator()(size_t row, size_t column) const {
+        return _elements[row * C + column];
+    };
+    constexpr Vector<C, T> row(size_t i) const {
+        MutableVector<C, T> v;
+        for(size_t j = 0; j < C; j++) {
+            v[j] = _elements[i * C + j];
+        }
+        return v;
+    };
+    constexpr Vector<R, T> column(size_t j) const {
+        MutableVector<R, T> v;
+        for(size_t i = 0; i < R; i++) {
+            v[i] = _elements[i * C + j];
+        }
+        return v;
+    };
+
+    // The elements as a contiguous row-major array.
+    constexpr const T *data() const {
+        return _elements;
+    };
+
+    constexpr size_t rows() const {
+        return R;
+    };
+    constexpr size_t columns() const {
+        return C;
+    };
+
+    constexpr bool operator==(const Matrix &m) const {
+        for(size_t i = 0; i < R * C; i++) {
+            value_type diff = static_cast<value_type>(m._elements[i]) - static_cast<value_type>(_elements[i]);
+            if(diff > Vector<C, T>::tolerance || -diff > Vector<C, T>::tolerance) {
+                return false;
+            }
+        }
+        return true;
+    };
+    constexpr bool operator!=(const Matrix &m) const {
+        return !this->operator==(m);
+    };
+
+    constexpr Matrix<C, R, T> transpose() const {
+        Matrix<C, R, T> t;
+        for(size_t i = 0; i < R; i++) {
+            for(size_t j = 0; j < C; j++) {
+                t._elements[j * R + i] = _elements[i * C + j];
+            }
+        }
+        return t;
+    };
+
+    // matrix-matrix operations
+    constexpr Matrix operator+(const Matrix &m) const {
+        Matrix result;
+        for(size_t i = 0; i < R * C; i++) {
+            result._elements[i] = static_cast<T>(static_cast<value_type>(_elements[i]) + static_cast<value_type>(m._elements[i]));
+        }
+        return result;
+    };
+    constexpr Matrix operator-(const Matrix &m) const {
+        Matrix result;
+        for(size_t i = 0; i < R * C; i++) {
+            result._elements[i] = static_cast<T>(static_cast<value_type>(_elements[i]) - static_cast<value_type>(m._elements[i]));
+        }
+        return result;
+    };
+    template <size_t K>
+    constexpr Matrix<R, K, T> operator*(const Matrix<C, K, T> &m) const {
+        Matrix<R, K, T> result;
+        if constexpr(simd::supported<T> && R == 4 && C == 4 && K == 4) {
+            if(!std::is_constant_evaluated()) {
+                simd::kernels<T>().multiply4x4(_elements, m._elements, result._elements);
+                return result;
+            }
+        }
+        if constexpr(R > BRADBURY_UNROLL_LIMIT || C > BRADBURY_UNROLL_LIMIT || K > BRADBURY_UNROLL_LIMIT) {
+            if(!std::is_constant_evaluated()) {
+                multiplyBlocked(m, result);
+                return result;
+            }
+        }
+
+        for(size_t i = 0; i < R; i++) {
+            for(size_t j = 0; j < K; j++) {
+                value_type sum = 0;
+                unroll<C>([&](size_t k) {
+                    sum += static_cast<value_type>(_elements[i * C + k]) * static_cast<value_type>(m._elements[k * K + j]);
+                });
+                result._elements[i * K + j] = static_cast<T>(sum);
+            }
+        }
+        return result;
+    };
+
+    // matrix-vector operations
+    template <size_t A>
+    constexpr Vector<R, T> operator*(const Vector<C, T, A> &v) const {
+        MutableVector<R, T> result;
+        for(size_t i = 0; i < R; i++) {
+            value_type sum = 0;
+            unroll<C>([&](size_t k) {
+                sum += static_cast<value_type>(_elements[i * C + k]) * v.evaluate(k);
+            });
+            result[i] = static_cast<T>(sum);
+        }
+        return result;
+    };
+
+    // matrix-number operations
+    template <class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+    constexpr Matrix operator*(S d) const {
+        Matrix result;
+        for(size_t i = 0; i < R * C; i++) {
+            result._elements[i] = static_cast<T>(static_cast<value_type>(_elements[i]) * d);
+        }
+        return result;
+    };
+
+    // 4x4 transform builders
+    static constexpr Matrix translation(const Vector<3, T> &offset) requires (R == 4 && C == 4) {
+        Matrix m = identity();
+        m._elements[3] = offset.x();
+        m._elements[7] = offset.y();
+        m._elements[11] = offset.z();
+        return m;
+    };
+    static constexpr Matrix scaling(const Vector<3, T> &factors) requires (R == 4 && C == 4) {
+        Matrix m = identity();
+        m._elements[0] = factors.x();
+        m._elements[5] = factors.y();
+        m._elements[10] = factors.z();
+        return m;
+    };
+    // A counter-clockwise rotation of `angle` radians about `axis`, looking
+    // down the axis towards the origin. The axis need not be normalized.
+    static Matrix rotation(const Vector<3, T> &axis, value_type angle) requires (R == 4 && C == 4 && std::is_floating_point<value_type>::value) {
+        Vector<3, T> u = axis.normalize();
+        value_type c = std::cos(angle);
+        value_type s = std::sin(angle);
+        value_type t = 1 - c;
+        value_type x = u.x(), y = u.y(), z = u.z();
+
+        return Matrix({t * x * x + c,     t * x * y - s * z, t * x * z + s * y, value_type(0),
+                       t * x * y + s * z, t * y * y + c,     t * y * z - s * x, value_type(0),
+                       t * x * z - s * y, t * y * z + s * x, t * z * z + c,     value_type(0),
+                       value_type(0),     value_type(0),     value_type(0),     value_type(1)});
+    };
+    // A perspective projection with a vertical field of view of `fovy`
+    // radians, looking down -z.
+    static Matrix perspective(value_type fovy, value_type aspect, value_type near, value_type far) requires (R == 4 && C == 4 && std::is_floating_point<value_type>::value) {
+        value_type f = 1 / std::tan(fovy / 2);
+
+        return Matrix({f / aspect,    value_type(0), value_type(0),                 value_type(0),
+                       value_type(0), f,             value_type(0),                 value_type(0),
+                       value_type(0), value_type(0), (far + near) / (near - far),   2 * far * near / (near - far),
+                       value_type(0), value_type(0), value_type(-1),                value_type(0)});
+    };
+    static constexpr Matrix orthographic(value_type left, value_type right, value_type bottom, value_type top, value_type near, value_type far) requires (R == 4 && C == 4 && std::is_floating_point<value_type>::value) {
+        return Matrix({2 / (right - left), value_type(0),      value_type(0),     -(right + left) / (right - left),
+                       value_type(0),      2 / (top - bottom), value_type(0),     -(top + bottom) / (top - bottom),
+                       value_type(0),      value_type(0),      -2 / (far - near), -(far + near) / (far - near),
+                       value_type(0),      value_type(0),      value_type(0),     value_type(1)});
+    };
+
+    // A point (w = 1) and a direction (w = 0) through a 4x4 transform.
+    // Points are divided by the resulting w, so projections work too.
+    constexpr Vector<3, T> transformPoint(const Vector<3, T> &p) const requires (R == 4 && C == 4) {
+        Vector<4, T> h = *this * Vector<4, T>(p.x(), p.y(), p.z(), T(1));
+        return Vector<3, T>(h.x(), h.y(), h.z()) / static_cast<value_type>(h.t());
+    };
+    constexpr Vector<3, T> transformDirection(const Vector<3, T> &d) const requires (R == 4 && C == 4) {
+        Vector<4, T> h = *this * Vector<4, T>(d.x(), d.y(), d.z(), T(0));
+        return Vector<3, T>(h.x(), h.y(), h.z());
+    };
+
+private:
+    T _elements[R * C];
+
+    // result += this * m, tile by tile. result starts at zero.
+    template <size_t K>
+    void multiplyBlocked(const Matrix<C, K, T> &m, Matrix<R, K, T> &result) const {
+        constexpr size_t block = BRADBURY_MATRIX_BLOCK;
+        for(size_t i0 = 0; i0 < R; i0 += block) {
+            for(size_t k0 = 0; k0 < C; k0 += block) {
+                for(size_t j0 = 0; j0 < K; j0 += block) {
+                    size_t iEnd = i0 + block < R ? i0 + block : R;
+                    size_t kEnd = k0 + block < C ? k0 + block : C;
+                    size_t width = j0 + block < K ? block : K - j0;
+                    for(size_t i = i0; i < iEnd; i++) {
+                        T *out = result._elements + i * K + j0;
+                        for(size_t k = k0; k < kEnd; k++) {
+                            const T *in = m._elements + k * K + j0;
+                            if constexpr(simd::supported<T>) {
+                                simd::kernels<T>().axpy(_elements[i * C + k], in, out, out, width);
+                            } else {
+                                value_type a = static_cast<value_type>(_elements[i * C + k]);
+                                for(size_t j = 0; j < width; j++) {
+                                    out[j] = static_cast<T>(a * static_cast<value_type>(in[j]) + static_cast<value_type>(out[j]));
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    };
+};
+
+template<size_t R, size_t C, class T, class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+constexpr Matrix<R, C, T> operator*(S d, const Matrix<R, C, T> &m) {
+    return m * d;
+};
+
+#endif // bradbury_matrix_h
@@ -0,0 +1,36 @@
+//
+//  mixed.h
+//  bradbury
+//
+//  A float for storage whose sums are taken in double: the component type of
+//  mixed-precision vectors. Arithmetic on single components happens in float;
+//  dot products, magnitudes and reductions accumulate in double.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_mixed_h
+#define bradbury_mixed_h
+
+#include <type_traits>
+
+class mixed {
+public:
+    constexpr mixed() = default;
+
+    template <class T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+    constexpr explicit mixed(T value) : _value(static_cast<float>(value)) {};
+
+    constexpr operator float() const {
+        return _value;
+    };
+
+private:
+    float _value;
+};
+
+// Arrays of mixed are arrays of float, which is how the kernels read them.
+static_assert(sizeof(mixed) == sizeof(float) && std::is_standard_layout<mixed>::value, "mixed is a bare float");
+
+#endif // bradbury_mixed_h
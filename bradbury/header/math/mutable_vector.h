@@ -0,0 +1,106 @@
+//
+//  mutable_vector.h
+//  bradbury
+//
+//  A Vector that can be changed in place, for accumulating sums and building
+//  up components in tight loops.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_mutable_vector_h
+#define bradbury_mutable_vector_h
+
+#include <utility>
+
+#include "vector.h"
+
+// A MutableVector is a Vector, so it can be passed anywhere a `const Vector &`
+// is expected without a copy, and it takes part in expressions like any other
+// Vector. On top of that it has compound assignment and writable components.
+//
+// Compound assignment evaluates `v + e` (or -, *, /) into v's own storage, in
+// one pass and without a temporary. The left operand is always the plain
+// Vector, so `v += w` and `v *= d` reach the same SIMD kernels as `v + w`.
+// On an rvalue the operators return an rvalue, so a chain like
+// `Vector<3> v = MutableVector<3>(a) += b;` never names an intermediate.
+template<size_t D, class T = double, size_t A = alignof(T)>
+class MutableVector : public Vector<D, T, A> {
+public:
+    typedef Vector<D, T, A> vector_type;
+    typedef typename vector_type::value_type value_type;
+
+    using vector_type::vector_type;
+    using vector_type::operator=;
+    using vector_type::operator[];
+    using vector_type::data;
+
+    constexpr MutableVector() = default;
+    constexpr MutableVector(vector_type const &vector) : vector_type(vector) {};
+
+    // Writable access
+    constexpr T &operator[](int i) {
+#if BRADBURY_CHECKED_ACCESS
+        if(static_cast<size_t>(i) >= D) [[unlikely]] {
+            vector_type::outOfRange(i);
+        }
+#endif
+
+        return this->_components[i];
+    };
+    constexpr T *data() {
+        return this->_components;
+    };
+
+    // Builder-style setter: `MutableVector<3>().set(0, 1).set(2, 5)`.
+    constexpr MutableVector &set(int i, T value) & {
+        (*this)[i] = value;
+        return *this;
+    };
+    constexpr MutableVector &&set(int i, T value) && {
+        return std::move(set(i, value));
+    };
+
+    // vector-vector compound assignment
+    template <class E>
+    constexpr MutableVector &operator+=(VectorExpression<D, E> const &expression) & {
+        vector_type::operator=(this->self() + expression.self());
+        return *this;
+    };
+    template <class E>
+    constexpr MutableVector &&operator+=(VectorExpression<D, E> const &expression) && {
+        return std::move(*this += expression);
+    };
+    template <class E>
+    constexpr MutableVector &operator-=(VectorExpression<D, E> const &expression) & {
+        vector_type::operator=(this->self() - expression.self());
+        return *this;
+    };
+    template <class E>
+    constexpr MutableVector &&operator-=(VectorExpression<D, E> const &expression) && {
+        return std::move(*this -= expression);
+    };
+
+    // vector-number compound assignment
+    template <class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+    constexpr MutableVector &operator*=(S d) & {
+        vector_type::operator=(this->self() * d);
+        return *this;
+    };
+    template <class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+    constexpr MutableVector &&operator*=(S d) && {
+        return std::move(*this *= d);
+    };
+    template <class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+    constexpr MutableVector &operator/=(S d) & {
+        vector_type::operator=(this->self() / d);
+        return *this;
+    };
+    template <class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+    constexpr MutableVector &&operator/=(S d) && {
+        return std::move(*this /= d);
+    };
+};
+
+#endif // bradbury_mutable_vector_h
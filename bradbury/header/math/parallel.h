@@ -0,0 +1,86 @@
+//
+//  parallel.h
+//  bradbury
+//
+//  Splits bulk kernels across cores. Work is cut into fixed-size chunks that
+//  depend only on the problem size, never on the number of threads, so a
+//  kernel that combines per-chunk results in chunk order gives the same answer
+//  on any machine.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_parallel_h
+#define bradbury_parallel_h
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+    // The most threads a kernel may use, counting the calling thread. Defaults
+    // to the hardware's concurrency; 0 restores the default.
+    size_t threads();
+    void setThreads(size_t count);
+
+    // The number of chunks [0, n) splits into.
+    inline size_t chunks(size_t n, size_t grain) {
+        return (n + grain - 1) / grain;
+    }
+
+    // Calls f(chunk, begin, end) for every chunk of `grain` items in [0, n)
+    // (the last may be shorter), spread over up to threads() threads. Chunks
+    // run in no particular order and each exactly once. The calling thread
+    // does its share, and a single chunk never starts a thread. The first
+    // exception thrown by f stops further chunks and is rethrown here.
+    template<class F>
+    void forChunks(size_t n, size_t grain, F f) {
+        size_t count = chunks(n, grain);
+        size_t workers = std::min(threads(), count);
+
+        if(workers <= 1) {
+            for(size_t c = 0; c < count; c++) {
+                f(c, c * grain, std::min(n, (c + 1) * grain));
+            }
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        std::exception_ptr error;
+        std::mutex errorLock;
+        auto work = [&]() {
+            try {
+                for(size_t c = next++; c < count; c = next++) {
+                    f(c, c * grain, std::min(n, (c + 1) * grain));
+                }
+            } catch(...) {
+                std::lock_guard<std::mutex> lock(errorLock);
+                if(!error) {
+                    error = std::current_exception();
+                }
+                next = count;
+            }
+        };
+
+        std::vector<std::thread> helpers;
+        helpers.reserve(workers - 1);
+        for(size_t i = 1; i < workers; i++) {
+            helpers.emplace_back(work);
+        }
+        work();
+        for(std::thread &helper : helpers) {
+            helper.join();
+        }
+
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+#endif // bradbury_parallel_h
@@ -0,0 +1,204 @@
+//
+//  quaternion.h
+//  bradbury
+//
+//  Rotations as unit quaternions, with conversions to and from rotation
+//  matrices and batched rotation and interpolation over arrays.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_quaternion_h
+#define bradbury_quaternion_h
+
+#include <cmath>
+#include <span>
+#include <type_traits>
+
+#include "matrix.h"
+#include "vector.h"
+
+// x i + y j + z k + w, stored in that order so a Quaternion has the same
+// layout as the Vector<4> it converts to and from. Like Vector it is an
+// immutable value; the operations return new quaternions.
+//
+// Rotations are unit quaternions: axisAngle(), fromMatrix() and normalize()
+// produce them, and rotate() and matrix() assume them. Products compose
+// rotations like matrices do, so `(a * b).rotate(v)` rotates by b first.
+template<class T = double>
+class Quaternion {
+    static_assert(std::is_floating_point<T>::value, "quaternions hold floats or doubles");
+
+public:
+    typedef T scalar_type;
+    typedef T value_type;
+
+    // Default constructor: the identity rotation.
+    constexpr Quaternion() : Quaternion(0, 0, 0, 1) {};
+    constexpr Quaternion(T x, T y, T z, T w) : _x(x), _y(y), _z(z), _w(w) {};
+    constexpr explicit Quaternion(const Vector<4, T> &v) : Quaternion(v.x(), v.y(), v.z(), v.t()) {};
+
+    static constexpr Quaternion identity() {
+        return Quaternion();
+    };
+    // A counter-clockwise rotation of `angle` radians about `axis`, as in
+    // Matrix::rotation(). The axis need not be normalized.
+    static Quaternion axisAngle(const Vector<3, T> &axis, T angle) {
+        Vector<3, T> u = axis.normalize();
+        T s = std::sin(angle / 2);
+        return Quaternion(u.x() * s, u.y() * s, u.z() * s, std::cos(angle / 2));
+    };
+    // The rotation a proper orthonormal matrix performs. Each case divides by
+    // the largest of the four possible pivots, so this stays accurate for
+    // every angle.
+    static Quaternion fromMatrix(const Matrix<3, 3, T> &m) {
+        T trace = m(0, 0) + m(1, 1) + m(2, 2);
+        if(trace > 0) {
+            T s = std::sqrt(trace + 1) * 2;
+            return Quaternion((m(2, 1) - m(1, 2)) / s, (m(0, 2) - m(2, 0)) / s, (m(1, 0) - m(0, 1)) / s, s / 4);
+        }
+        if(m(0, 0) > m(1, 1) && m(0, 0) > m(2, 2)) {
+            T s = std::sqrt(1 + m(0, 0) - m(1, 1) - m(2, 2)) * 2;
+            return Quaternion(s / 4, (m(0, 1) + m(1, 0)) / s, (m(0, 2) + m(2, 0)) / s, (m(2, 1) - m(1, 2)) / s);
+        }
+        if(m(1, 1) > m(2, 2)) {
+            T s = std::sqrt(1 + m(1, 1) - m(0, 0) - m(2, 2)) * 2;
+            return Quaternion((m(0, 1) + m(1, 0)) / s, s / 4, (m(1, 2) + m(2, 1)) / s, (m(0, 2) - m(2, 0)) / s);
+        }
+        T s = std::sqrt(1 + m(2, 2) - m(0, 0) - m(1, 1)) * 2;
+        return Quaternion((m(0, 2) + m(2, 0)) / s, (m(1, 2) + m(2, 1)) / s, s / 4, (m(1, 0) - m(0, 1)) / s);
+    };
+
+    // Access operators
+    constexpr T x() const {
+        return _x;
+    };
+    constexpr T y() const {
+        return _y;
+    };
+    constexpr T z() const {
+        return _z;
+    };
+    constexpr T w() const {
+        return _w;
+    };
+    constexpr Vector<4, T> vector() const {
+        return Vector<4, T>(_x, _y, _z, _w);
+    };
+
+    constexpr bool operator==(const Quaternion &q) const {
+        return vector() == q.vector();
+    };
+    constexpr bool operator!=(const Quaternion &q) const {
+        return !this->operator==(q);
+    };
+
+    // The Hamilton product.
+    constexpr Quaternion operator*(const Quaternion &q) const {
+        return Quaternion(_w * q._x + _x * q._w + _y * q._z - _z * q._y,
+                          _w * q._y - _x * q._z + _y * q._w + _z * q._x,
+                          _w * q._z + _x * q._y - _y * q._x + _z * q._w,
+                          _w * q._w - _x * q._x - _y * q._y - _z * q._z);
+    };
+    constexpr Quaternion operator-() const {
+        return Quaternion(-_x, -_y, -_z, -_w);
+    };
+
+    // The inverse of a unit quaternion.
+    constexpr Quaternion conjugate() const {
+        return Quaternion(-_x, -_y, -_z, _w);
+    };
+    constexpr T dot(const Quaternion &q) const {
+        return _x * q._x + _y * q._y + _z * q._z + _w * q._w;
+    };
+    constexpr T squaredmagnitude() const {
+        return dot(*this);
+    };
+    T magnitude() const {
+        return std::sqrt(squaredmagnitude());
+    };
+    // Quaternions drift off unit length as rotations are composed; this brings
+    // them back. The zero quaternion is returned unchanged.
+    Quaternion normalize() const {
+        T length = magnitude();
+        if(length == 0) {
+            return *this;
+        }
+        T inverse = 1 / length;
+        return Quaternion(_x * inverse, _y * inverse, _z * inverse, _w * inverse);
+    };
+
+    // v + 2w (u x v) + 2 u x (u x v), for u the vector part: two cross products
+    // rather than two quaternion products.
+    constexpr Vector<3, T> rotate(const Vector<3, T> &v) const {
+        T tx = 2 * (_y * v.z() - _z * v.y());
+        T ty = 2 * (_z * v.x() - _x * v.z());
+        T tz = 2 * (_x * v.y() - _y * v.x());
+        return Vector<3, T>(v.x() + _w * tx + (_y * tz - _z * ty),
+                            v.y() + _w * ty + (_z * tx - _x * tz),
+                            v.z() + _w * tz + (_x * ty - _y * tx));
+    };
+
+    constexpr Matrix<3, 3, T> matrix() const {
+        T xx = _x * _x, yy = _y * _y, zz = _z * _z;
+        T xy = _x * _y, xz = _x * _z, yz = _y * _z;
+        T wx = _w * _x, wy = _w * _y, wz = _w * _z;
+        return Matrix<3, 3, T>({1 - 2 * (yy + zz), 2 * (xy - wz),     2 * (xz + wy),
+                                2 * (xy + wz),     1 - 2 * (xx + zz), 2 * (yz - wx),
+                                2 * (xz - wy),     2 * (yz + wx),     1 - 2 * (xx + yy)});
+    };
+
+    // Interpolation from this rotation (t = 0) to q (t = 1), along the shorter
+    // way round. nlerp is a normalized straight line: cheaper, and close to
+    // slerp for nearby rotations, but not at constant angular speed.
+    Quaternion nlerp(const Quaternion &q, T t) const {
+        T sign = dot(q) < 0 ? -1 : 1;
+        T a = 1 - t;
+        T b = t * sign;
+        return Quaternion(_x * a + q._x * b, _y * a + q._y * b, _z * a + q._z * b, _w * a + q._w * b).normalize();
+    };
+    Quaternion slerp(const Quaternion &q, T t) const {
+        T cosine = dot(q);
+        T sign = 1;
+        if(cosine < 0) {
+            cosine = -cosine;
+            sign = -1;
+        }
+
+        // Nearly parallel: the sine below vanishes, and nlerp is as accurate.
+        if(cosine > T(0.9995)) {
+            return nlerp(q, t);
+        }
+
+        T angle = std::acos(cosine);
+        T sine = std::sin(angle);
+        T a = std::sin((1 - t) * angle) / sine;
+        T b = std::sin(t * angle) / sine * sign;
+        return Quaternion(_x * a + q._x * b, _y * a + q._y * b, _z * a + q._z * b, _w * a + q._w * b);
+    };
+
+private:
+    T _x, _y, _z, _w;
+};
+
+// Batched operations over float or double arrays, split across threads like
+// transformPoints(). `out` is provided by the caller, must be as long as the
+// inputs (std::length_error otherwise) and may be one of them. T is deduced
+// from the quaternion or the interpolation parameter; pass it explicitly to
+// rotate by a whole span of quaternions.
+
+// out[i] = q.rotate(in[i]): one rotation applied to many vectors.
+template<class T>
+void rotate(const Quaternion<T> &q, std::type_identity_t<std::span<const Vector<3, T>>> in, std::type_identity_t<std::span<Vector<3, T>>> out);
+// out[i] = q[i].rotate(in[i]): one rotation per vector.
+template<class T>
+void rotate(std::span<const Quaternion<T>> q, std::type_identity_t<std::span<const Vector<3, T>>> in, std::type_identity_t<std::span<Vector<3, T>>> out);
+
+// out[i] = a[i].slerp(b[i], t), and the same for nlerp.
+template<class T>
+void slerp(std::type_identity_t<std::span<const Quaternion<T>>> a, std::type_identity_t<std::span<const Quaternion<T>>> b, T t, std::type_identity_t<std::span<Quaternion<T>>> out);
+template<class T>
+void nlerp(std::type_identity_t<std::span<const Quaternion<T>>> a, std::type_identity_t<std::span<const Quaternion<T>>> b, T t, std::type_identity_t<std::span<Quaternion<T>>> out);
+
+#endif // bradbury_quaternion_h
@@ -0,0 +1,258 @@
+//
+//  reduce.h
+//  bradbury
+//
+//  Sums, centroids and bounds of whole spans of Vectors, split across cores
+//  and reproducible to the bit whatever the number of threads.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_reduce_h
+#define bradbury_reduce_h
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mutable_vector.h"
+#include "parallel.h"
+#include "vector.h"
+
+// Every reduction has the same fixed shape. Points are cut into chunks of
+// reductionGrain (see parallel.h); within a chunk, `reductionLanes` running
+// results take consecutive points in turn, so the inner loop is a fixed-length
+// run over contiguous scalars that the compiler vectorizes, and the lanes are
+// folded pairwise at the end. Chunk results are then folded pairwise in chunk
+// order. Nothing depends on which thread ran which chunk, so a float sum comes
+// out the same with one thread or sixty-four; and pairwise folding keeps its
+// rounding error growing with the log of the point count, not the count.
+//
+// Sums and means accumulate in the Vector's accumulate_type, so half points
+// are summed in float and mixed points in double.
+static const size_t reductionGrain = 1 << 14;
+static const size_t reductionLanes = 4;
+
+// The smallest and largest value of each component.
+template<size_t D, class T = double>
+struct Bounds {
+    Vector<D, T> lower;
+    Vector<D, T> upper;
+};
+
+namespace reduction {
+    // f(begin, end) for every chunk of n points, folded pairwise in chunk
+    // order by merge. n must not be zero.
+    template<class R, class F, class M>
+    R chunked(size_t n, F f, M merge) {
+        std::vector<R> partials(parallel::chunks(n, reductionGrain));
+        parallel::forChunks(n, reductionGrain, [&](size_t chunk, size_t begin, size_t end) {
+            partials[chunk] = f(begin, end);
+        });
+
+        for(size_t stride = 1; stride < partials.size(); stride *= 2) {
+            for(size_t i = 0; i + stride < partials.size(); i += 2 * stride) {
+                partials[i] = merge(partials[i], partials[i + stride]);
+            }
+        }
+        return partials[0];
+    };
+
+    // Running results are `reductionLanes` Vectors side by side, as one flat
+    // array of slots: slot l * D + c holds component c of lane l.
+    template<size_t D, class V>
+    struct Slots {
+        V slots[reductionLanes * D];
+
+        V &operator[](size_t j) {
+            return slots[j];
+        };
+        V const &operator[](size_t j) const {
+            return slots[j];
+        };
+    };
+
+    // Calls step(state, slot, i, value) for every component of points
+    // [begin, end), value converted to V, and returns the final state. Lane l
+    // takes every reductionLanes-th point from begin + l, and the remainder
+    // goes to lane 0. The state is a local copy so it stays in registers.
+    template<class V, size_t D, class T, size_t A, class S, class F>
+    S lanes(std::span<const Vector<D, T, A>> points, size_t begin, size_t end, S state, F step) {
+        // Over-aligned Vectors are padded; stride over the padding. Packed ones
+        // make each step below a plain run over contiguous scalars.
+        constexpr size_t stride = sizeof(Vector<D, T, A>) / sizeof(T);
+        const T *scalars = points.data()->data();
+
+        size_t i = begin;
+        for(; i + reductionLanes <= end; i += reductionLanes) {
+            const T *p = scalars + i * stride;
+            unroll<reductionLanes * D>([&](size_t j) {
+                if constexpr(stride == D) {
+                    step(state, j, i + j / D, static_cast<V>(p[j]));
+                } else {
+                    step(state, j, i + j / D, static_cast<V>(p[j / D * stride + j % D]));
+                }
+            });
+        }
+        for(; i < end; i++) {
+            for(size_t c = 0; c < D; c++) {
+                step(state, c, i, static_cast<V>(scalars[i * stride + c]));
+            }
+        }
+        return state;
+    };
+
+    template<size_t D, class V, class F>
+    Vector<D, V> fold(Slots<D, V> const &slots, F f) {
+        static_assert(reductionLanes == 4, "lanes fold as (0, 1), (2, 3)");
+        MutableVector<D, V> result;
+        for(size_t c = 0; c < D; c++) {
+            result[c] = f(f(slots[c], slots[D + c]), f(slots[2 * D + c], slots[3 * D + c]));
+        }
+        return result;
+    };
+
+    template<class V>
+    V add(V a, V b) {
+        return a + b;
+    };
+    template<class V>
+    V lesser(V a, V b) {
+        return b < a ? b : a;
+    };
+    template<class V>
+    V greater(V a, V b) {
+        return a < b ? b : a;
+    };
+
+    // Every lane starts at point `begin`, which is already the answer for it.
+    template<class V, size_t D, class T, size_t A>
+    Slots<D, V> seed(std::span<const Vector<D, T, A>> points, size_t begin) {
+        Slots<D, V> slots;
+        const T *first = points[begin].data();
+        for(size_t j = 0; j < reductionLanes * D; j++) {
+            slots[j] = static_cast<V>(first[j % D]);
+        }
+        return slots;
+    };
+
+    // The component-wise result of f over all points, for f lesser or greater.
+    template<size_t D, class T, size_t A, class F>
+    Vector<D, T> extreme(std::span<const Vector<D, T, A>> points, F f) {
+        typedef typename Vector<D, T, A>::value_type V;
+        Vector<D, V> found = chunked<Vector<D, V>>(points.size(), [&](size_t begin, size_t end) {
+            Slots<D, V> slots = lanes<V>(points, begin, end, seed<V>(points, begin), [f](Slots<D, V> &s, size_t j, size_t, V v) {
+                s[j] = f(s[j], v);
+            });
+            return fold<D>(slots, f);
+        }, [&](Vector<D, V> const &a, Vector<D, V> const &b) {
+            MutableVector<D, V> result;
+            for(size_t c = 0; c < D; c++) {
+                result[c] = f(a[c], b[c]);
+            }
+            return Vector<D, V>(result);
+        });
+        return found;
+    };
+
+    template<size_t D, class T, size_t A>
+    void checkNotEmpty(std::span<const Vector<D, T, A>> points, const char *operation) {
+        if(points.empty()) {
+            throw std::length_error(std::string("Cannot find the ") + operation + " of 0 vectors");
+        }
+    };
+}
+
+// The component-wise sum. Zero for no points.
+template<size_t D, class T, size_t A>
+Vector<D, typename Vector<D, T, A>::accumulate_type> sum(std::span<const Vector<D, T, A>> points) {
+    typedef typename Vector<D, T, A>::accumulate_type V;
+    if(points.empty()) {
+        return Vector<D, V>();
+    }
+
+    return reduction::chunked<Vector<D, V>>(points.size(), [&](size_t begin, size_t end) {
+        reduction::Slots<D, V> slots = reduction::lanes<V>(points, begin, end, reduction::Slots<D, V>{}, [](reduction::Slots<D, V> &s, size_t j, size_t, V v) {
+            s[j] += v;
+        });
+        return reduction::fold<D>(slots, reduction::add<V>);
+    }, [](Vector<D, V> const &a, Vector<D, V> const &b) {
+        return Vector<D, V>(a + b);
+    });
+};
+
+// sum(w[i] * points[i]). There must be one weight per point
+// (std::length_error otherwise).
+template<size_t D, class T, size_t A>
+Vector<D, typename Vector<D, T, A>::accumulate_type> weightedSum(std::span<const Vector<D, T, A>> points, std::type_identity_t<std::span<const typename Vector<D, T, A>::accumulate_type>> weights) {
+    typedef typename Vector<D, T, A>::accumulate_type V;
+    if(weights.size() != points.size()) {
+        throw std::length_error("Cannot weight " + std::to_string(points.size()) + " vectors by " + std::to_string(weights.size()) + " weights");
+    }
+    if(points.empty()) {
+        return Vector<D, V>();
+    }
+
+    return reduction::chunked<Vector<D, V>>(points.size(), [&](size_t begin, size_t end) {
+        const V *w = weights.data();
+        reduction::Slots<D, V> slots = reduction::lanes<V>(points, begin, end, reduction::Slots<D, V>{}, [w](reduction::Slots<D, V> &s, size_t j, size_t i, V v) {
+            s[j] += w[i] * v;
+        });
+        return reduction::fold<D>(slots, reduction::add<V>);
+    }, [](Vector<D, V> const &a, Vector<D, V> const &b) {
+        return Vector<D, V>(a + b);
+    });
+};
+
+// The centroid: sum(points) / points.size(). Throws std::length_error for no
+// points.
+template<size_t D, class T, size_t A>
+Vector<D, typename Vector<D, T, A>::real_type> mean(std::span<const Vector<D, T, A>> points) {
+    typedef typename Vector<D, T, A>::real_type R;
+    reduction::checkNotEmpty(points, "mean");
+    return Vector<D, R>(sum(points)) / static_cast<R>(points.size());
+};
+
+// The smallest and largest of each component, separately or in one pass.
+// Throw std::length_error for no points.
+template<size_t D, class T, size_t A>
+Vector<D, T> minimum(std::span<const Vector<D, T, A>> points) {
+    reduction::checkNotEmpty(points, "minimum");
+    return reduction::extreme(points, reduction::lesser<typename Vector<D, T, A>::value_type>);
+};
+template<size_t D, class T, size_t A>
+Vector<D, T> maximum(std::span<const Vector<D, T, A>> points) {
+    reduction::checkNotEmpty(points, "maximum");
+    return reduction::extreme(points, reduction::greater<typename Vector<D, T, A>::value_type>);
+};
+
+template<size_t D, class T, size_t A>
+Bounds<D, T> bounds(std::span<const Vector<D, T, A>> points) {
+    typedef typename Vector<D, T, A>::value_type V;
+    reduction::checkNotEmpty(points, "bounds");
+
+    Bounds<D, V> found = reduction::chunked<Bounds<D, V>>(points.size(), [&](size_t begin, size_t end) {
+        typedef std::pair<reduction::Slots<D, V>, reduction::Slots<D, V>> Extremes;
+        reduction::Slots<D, V> first = reduction::seed<V>(points, begin);
+        Extremes found = reduction::lanes<V>(points, begin, end, Extremes(first, first), [](Extremes &s, size_t j, size_t, V v) {
+            s.first[j] = reduction::lesser(s.first[j], v);
+            s.second[j] = reduction::greater(s.second[j], v);
+        });
+        return Bounds<D, V>{reduction::fold<D>(found.first, reduction::lesser<V>), reduction::fold<D>(found.second, reduction::greater<V>)};
+    }, [](Bounds<D, V> const &a, Bounds<D, V> const &b) {
+        MutableVector<D, V> lower, upper;
+        for(size_t c = 0; c < D; c++) {
+            lower[c] = reduction::lesser(a.lower[c], b.lower[c]);
+            upper[c] = reduction::greater(a.upper[c], b.upper[c]);
+        }
+        return Bounds<D, V>{lower, upper};
+    });
+    return Bounds<D, T>{found.lower, found.upper};
+};
+
+#endif // bradbury_reduce_h
@@ -0,0 +1,120 @@
+//
+//  simd.h
+//  bradbury
+//
+//  Runtime-dispatched SIMD kernels over contiguous runs of floats or doubles.
+//  The best instruction set the CPU supports (SSE2, AVX2 or AVX-512) is
+//  detected with CPUID the first time the kernels are requested and used from
+//  then on.
+//
+//  Every kernel pads short runs (the 2, 3 and 4 components of small Vectors)
+//  out to a single register and walks longer runs in register-sized chunks.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_simd_h
+#define bradbury_simd_h
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#endif
+
+namespace simd {
+    enum class Level {
+        scalar,
+        sse2,
+        avx2,
+        avx512
+    };
+
+    template<class T>
+    struct Kernels {
+        Level level;
+
+        // out = a + b, out = a - b, out = -a, out = a * d. `out` may alias `a`
+        // or `b`.
+        void (*add)(const T *a, const T *b, T *out, size_t n);
+        void (*subtract)(const T *a, const T *b, T *out, size_t n);
+        void (*negate)(const T *a, T *out, size_t n);
+        void (*scale)(const T *a, T d, T *out, size_t n);
+        
+        // Element-wise out = a * b, out = a * b + c, out = d * x + y and
+        // out = 1 / sqrt(a). `out` may alias any input.
+        void (*multiply)(const T *a, const T *b, T *out, size_t n);
+        void (*multiplyAdd)(const T *a, const T *b, const T *c, T *out, size_t n);
+        void (*axpy)(T d, const T *x, const T *y, T *out, size_t n);
+        void (*inverseSqrt)(const T *a, T *out, size_t n);
+        // out = 1 / sqrt(a) to within approximationError: a hardware estimate
+        // and one Newton step, several times faster than inverseSqrt. Inputs
+        // must be positive and normal; doubles must also be within float's
+        // range, since most levels estimate in float. Zeros give infinity or
+        // NaN.
+        void (*approximateInverseSqrt)(const T *a, T *out, size_t n);
+
+        // sum(a * b) and sum((a - b)^2). Long runs are summed pairwise, so
+        // they stay accurate at thousands of elements.
+        T (*dot)(const T *a, const T *b, size_t n);
+        T (*squaredDistance)(const T *a, const T *b, size_t n);
+        // The same, summed in double whatever T: floats are widened as they
+        // are loaded, so a float run costs float's bandwidth but keeps
+        // double's accuracy. For doubles these are dot and squaredDistance.
+        double (*widenedDot)(const T *a, const T *b, size_t n);
+        double (*widenedSquaredDistance)(const T *a, const T *b, size_t n);
+
+        // Three components only. `out` may alias `a` or `b`.
+        void (*cross)(const T *a, const T *b, T *out);
+        
+        // out = a * b for row-major 4x4 matrices. `out` may alias `a` or `b`.
+        void (*multiply4x4)(const T *a, const T *b, T *out);
+    };
+
+    // Kernels exist for float and double only; other scalar types use plain
+    // loops.
+    template<class T>
+    constexpr bool supported = std::is_same<T, double>::value || std::is_same<T, float>::value;
+
+    // The largest relative error of the approximate inverse square roots, on
+    // every level: about 2^-21, where one Newton step leaves the 12-bit
+    // hardware estimate.
+    constexpr double approximationError = 5e-7;
+
+    // One approximate inverse square root; see
+    // Kernels::approximateInverseSqrt. Anything the estimate cannot take
+    // (zero, denormals, infinity and doubles outside float's range) takes the
+    // exact path instead.
+    template<class T>
+    inline T approximateInverseSqrt(T x) {
+#if defined(__SSE__) || defined(__x86_64__)
+        if(!(x >= std::numeric_limits<float>::min() && x <= std::numeric_limits<float>::max())) [[unlikely]] {
+            return 1 / std::sqrt(x);
+        }
+        T y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(static_cast<float>(x))));
+        return y * (T(1.5) - T(0.5) * x * y * y);
+#else
+        return 1 / std::sqrt(x);
+#endif
+    }
+
+    // The best level this CPU and OS support.
+    Level detected();
+
+    // Kernels for the detected level, chosen once.
+    template<class T>
+    const Kernels<T> &kernels();
+
+    // Kernels for a specific level, for testing and benchmarking. Levels above
+    // detected() fall back to the detected level.
+    template<class T>
+    const Kernels<T> &kernels(Level level);
+
+    const char *name(Level level);
+}
+
+#endif // bradbury_simd_h
@@ -0,0 +1,386 @@
+//
+//  sparse_vector.h
+//  bradbury
+//
+//  Very high-dimensional vectors that are mostly zero, stored as their
+//  nonzero components only.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_sparse_vector_h
+#define bradbury_sparse_vector_h
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "dyn_vector.h"
+#include "mutable_vector.h"
+#include "vector.h"
+
+// When one operand of a sparse-sparse product has this many times more
+// nonzeros than the other, the short one's indices are galloped through the
+// long one rather than merged with it.
+#ifndef BRADBURY_SPARSE_GALLOP_RATIO
+#define BRADBURY_SPARSE_GALLOP_RATIO 16
+#endif
+
+// A vector of `dimension()` components of which only the nonzeros are
+// stored, in compressed form: ascending 32-bit indices and their values, side
+// by side. Products and norms cost O(nonzeros) rather than O(dimension).
+//
+// Like Vector it is immutable. Operations with a dense Vector or DynVector
+// take the sparse vector's dimension to be theirs, and combining vectors of
+// different dimensions throws std::length_error.
+template<class T = double>
+class SparseVector {
+public:
+    typedef T scalar_type;
+    typedef typename ScalarTraits<T>::compute_type value_type;
+    typedef typename std::conditional<std::is_floating_point<value_type>::value, value_type, double>::type real_type;
+    typedef uint32_t index_type;
+
+    // Default constructor: the zero vector.
+    explicit SparseVector(size_t dimension = 0) : _dimension(dimension) {
+        checkIndexable(dimension);
+    };
+
+    // From separate index and value lists, in any order. Repeated indices are
+    // summed and zeros dropped. Throws std::length_error if the lists differ
+    // in length and std::out_of_range for an index past the dimension.
+    SparseVector(size_t dimension, std::span<const size_t> indices, std::span<const T> values) : _dimension(dimension) {
+        checkIndexable(dimension);
+        if(indices.size() != values.size()) {
+            throw std::length_error("Cannot initalize sparse vector from " + std::to_string(indices.size()) + " indices and " + std::to_string(values.size()) + " values");
+        }
+
+        std::vector<size_t> order(indices.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return indices[a] < indices[b];
+        });
+
+        _indices.reserve(order.size());
+        _values.reserve(order.size());
+        for(size_t k = 0; k < order.size(); k++) {
+            size_t index = indices[order[k]];
+            if(index >= dimension) {
+                throw std::out_of_range("no " + std::to_string(index) + " component for dimension " + std::to_string(dimension));
+            }
+
+            value_type sum = static_cast<value_type>(values[order[k]]);
+            while(k + 1 < order.size() && indices[order[k + 1]] == index) {
+                sum += static_cast<value_type>(values[order[++k]]);
+            }
+            push(index, static_cast<T>(sum));
+        }
+    };
+
+    // From dense components, keeping the nonzeros.
+    explicit SparseVector(std::span<const T> dense) : _dimension(dense.size()) {
+        checkIndexable(dense.size());
+        for(size_t i = 0; i < dense.size(); i++) {
+            push(i, dense[i]);
+        }
+    };
+    explicit SparseVector(DynVector<T> const &dense) : SparseVector(std::span<const T>(dense.data(), dense.dimension())) {};
+    template <size_t D, size_t A>
+    explicit SparseVector(Vector<D, T, A> const &dense) : SparseVector(std::span<const T>(dense.data(), D)) {};
+
+    // Dense conversions
+    DynVector<T> dense() const {
+        std::vector<T> components(_dimension, T(0));
+        scatter(components.data());
+        return DynVector<T>(std::span<const T>(components));
+    };
+    template <size_t D, size_t A>
+    explicit operator Vector<D, T, A>() const {
+        checkDimension(D);
+        MutableVector<D, T, A> vector;
+        scatter(vector.data());
+        return vector;
+    };
+
+    // Access operators
+    // Component i, zero or not; a binary search over the nonzeros.
+    const T operator[](size_t i) const {
+#if BRADBURY_CHECKED_ACCESS
+        if(i >= _dimension) [[unlikely]] {
+            throw std::out_of_range("no " + std::to_string(i) + " component for dimension " + std::to_string(_dimension));
+        }
+#endif
+
+        auto found = std::lower_bound(_indices.begin(), _indices.end(), i);
+        if(found == _indices.end() || *found != i) {
+            return T(0);
+        }
+        return _values[found - _indices.begin()];
+    };
+
+    size_t dimension() const {
+        return _dimension;
+    };
+    size_t nonzeros() const {
+        return _indices.size();
+    };
+    // The compressed storage: ascending indices and their nonzero values.
+    std::span<const index_type> indices() const {
+        return _indices;
+    };
+    std::span<const T> values() const {
+        return _values;
+    };
+
+    bool operator==(const SparseVector &nv) const {
+        if(_dimension != nv._dimension) {
+            return false;
+        }
+        bool equal = true;
+        merge(nv, [&](size_t, value_type a, value_type b) {
+            value_type diff = a - b;
+            if(diff > Vector<1, T>::tolerance || -diff > Vector<1, T>::tolerance) {
+                equal = false;
+            }
+        });
+        return equal;
+    };
+    bool operator!=(const SparseVector &nv) const {
+        return !this->operator==(nv);
+    };
+
+    // vector-vector operations
+    SparseVector operator+(const SparseVector &nv) const {
+        return combine(nv, 1);
+    };
+    SparseVector operator-(const SparseVector &nv) const {
+        return combine(nv, -1);
+    };
+    SparseVector operator-() const {
+        return *this * -1;
+    };
+
+    // The sparse-sparse product. Similar nonzero counts are merged in one pass
+    // over both; otherwise each index of the shorter is galloped to in the
+    // longer, for O(n log(m / n)) rather than O(n + m).
+    value_type dot(const SparseVector &nv) const {
+        checkDimension(nv._dimension);
+        const SparseVector &shorter = nonzeros() <= nv.nonzeros() ? *this : nv;
+        const SparseVector &longer = nonzeros() <= nv.nonzeros() ? nv : *this;
+        if(longer.nonzeros() > shorter.nonzeros() * BRADBURY_SPARSE_GALLOP_RATIO) {
+            return shorter.gallop(longer);
+        }
+
+        value_type result = 0;
+        size_t i = 0, j = 0;
+        while(i < _indices.size() && j < nv._indices.size()) {
+            if(_indices[i] < nv._indices[j]) {
+                i++;
+            } else if(nv._indices[j] < _indices[i]) {
+                j++;
+            } else {
+                result += static_cast<value_type>(_values[i++]) * static_cast<value_type>(nv._values[j++]);
+            }
+        }
+        return result;
+    };
+    // The sparse-dense product: a gather of the dense components at the
+    // nonzeros.
+    value_type dot(std::span<const T> dense) const {
+        checkDimension(dense.size());
+        value_type result = 0;
+        for(size_t k = 0; k < _indices.size(); k++) {
+            result += static_cast<value_type>(_values[k]) * static_cast<value_type>(dense[_indices[k]]);
+        }
+        return result;
+    };
+    value_type dot(const DynVector<T> &dense) const {
+        return dot(std::span<const T>(dense.data(), dense.dimension()));
+    };
+    template <size_t D, size_t A>
+    value_type dot(const Vector<D, T, A> &dense) const {
+        return dot(std::span<const T>(dense.data(), D));
+    };
+
+    // vector-number operations
+    template <class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+    SparseVector operator*(S d) const {
+        SparseVector result(_dimension);
+        if(d == 0) {
+            return result;
+        }
+        result._indices = _indices;
+        result._values.resize(_values.size());
+        for(size_t k = 0; k < _values.size(); k++) {
+            result._values[k] = static_cast<T>(static_cast<value_type>(_values[k]) * d);
+        }
+        return result;
+    };
+    template <class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+    SparseVector operator/(S d) const {
+        SparseVector result(_dimension);
+        result._indices = _indices;
+        result._values.resize(_values.size());
+        for(size_t k = 0; k < _values.size(); k++) {
+            result._values[k] = static_cast<T>(static_cast<value_type>(_values[k]) / d);
+        }
+        return result;
+    };
+
+    // reductions
+    value_type squaredmagnitude() const {
+        value_type result = 0;
+        for(T v : _values) {
+            result += static_cast<value_type>(v) * static_cast<value_type>(v);
+        }
+        return result;
+    };
+    real_type magnitude() const {
+        return std::sqrt(static_cast<real_type>(squaredmagnitude()));
+    };
+
+    // y[i] += d * this[i] over the nonzeros only: a scatter into dense
+    // components, which must number dimension() (std::length_error
+    // otherwise).
+    void axpy(value_type d, std::span<T> y) const {
+        checkDimension(y.size());
+        for(size_t k = 0; k < _indices.size(); k++) {
+            y[_indices[k]] = static_cast<T>(d * static_cast<value_type>(_values[k]) + static_cast<value_type>(y[_indices[k]]));
+        }
+    };
+
+private:
+    size_t _dimension;
+    std::vector<index_type> _indices;
+    std::vector<T> _values;
+
+    void push(size_t index, T value) {
+        if(value != T(0)) {
+            _indices.push_back(static_cast<index_type>(index));
+            _values.push_back(value);
+        }
+    };
+
+    void scatter(T *dense) const {
+        for(size_t k = 0; k < _indices.size(); k++) {
+            dense[_indices[k]] = _values[k];
+        }
+    };
+
+    // f(index, a, b) for every index nonzero in either vector, in order, with
+    // the missing side zero.
+    template <class F>
+    void merge(const SparseVector &nv, F f) const {
+        size_t i = 0, j = 0;
+        while(i < _indices.size() || j < nv._indices.size()) {
+            if(j == nv._indices.size() || (i < _indices.size() && _indices[i] < nv._indices[j])) {
+                f(_indices[i], static_cast<value_type>(_values[i]), value_type(0));
+                i++;
+            } else if(i == _indices.size() || nv._indices[j] < _indices[i]) {
+                f(nv._indices[j], value_type(0), static_cast<value_type>(nv._values[j]));
+                j++;
+            } else {
+                f(_indices[i], static_cast<value_type>(_values[i]), static_cast<value_type>(nv._values[j]));
+                i++;
+                j++;
+            }
+        }
+    };
+
+    // this + sign * nv, dropping components that cancel.
+    SparseVector combine(const SparseVector &nv, int sign) const {
+        checkDimension(nv._dimension);
+        SparseVector result(_dimension);
+        result._indices.reserve(nonzeros() + nv.nonzeros());
+        result._values.reserve(nonzeros() + nv.nonzeros());
+        merge(nv, [&](size_t index, value_type a, value_type b) {
+            result.push(index, static_cast<T>(a + sign * b));
+        });
+        return result;
+    };
+
+    // The product with a vector of many more nonzeros. Each search starts at
+    // the last match and doubles its step until it passes the index wanted,
+    // then binary searches the last step.
+    value_type gallop(const SparseVector &longer) const {
+        const index_type *begin = longer._indices.data();
+        const index_type *end = begin + longer._indices.size();
+        const index_type *at = begin;
+
+        value_type result = 0;
+        for(size_t k = 0; k < _indices.size() && at != end; k++) {
+            index_type wanted = _indices[k];
+            size_t step = 1;
+            const index_type *low = at;
+            while(at != end && *at < wanted) {
+                low = at;
+                at = static_cast<size_t>(end - at) > step ? at + step : end;
+                step *= 2;
+            }
+            at = std::lower_bound(low, at, wanted);
+            if(at != end && *at == wanted) {
+                result += static_cast<value_type>(_values[k]) * static_cast<value_type>(longer._values[at - begin]);
+            }
+        }
+        return result;
+    };
+
+    void checkDimension(size_t dimension) const {
+        if(dimension != _dimension) {
+            throw std::length_error("Cannot combine vectors of dimension " + std::to_string(_dimension) + " and " + std::to_string(dimension));
+        }
+    };
+    static void checkIndexable(size_t dimension) {
+        if(dimension > static_cast<size_t>(std::numeric_limits<index_type>::max()) + 1) {
+            throw std::length_error("Cannot initalize sparse vector of dimension " + std::to_string(dimension));
+        }
+    };
+};
+
+template<class T>
+typename SparseVector<T>::value_type operator*(const SparseVector<T> &l, const SparseVector<T> &r) {
+    return l.dot(r);
+};
+template<class T>
+typename SparseVector<T>::value_type operator*(const SparseVector<T> &l, const DynVector<T> &r) {
+    return l.dot(r);
+};
+template<class T>
+typename SparseVector<T>::value_type operator*(const DynVector<T> &l, const SparseVector<T> &r) {
+    return r.dot(l);
+};
+
+template<class T, class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+SparseVector<T> operator*(S d, const SparseVector<T> &v) {
+    return v * d;
+};
+
+// d * x + y, for sparse x and dense y: the dense result costs one copy of y
+// plus O(nonzeros).
+template<class T>
+DynVector<T> axpy(typename SparseVector<T>::value_type d, const SparseVector<T> &x, const DynVector<T> &y) {
+    std::vector<T> out(y.data(), y.data() + y.dimension());
+    x.axpy(d, out);
+    return DynVector<T>(std::span<const T>(out));
+};
+template<size_t D, class T, size_t A>
+Vector<D, T, A> axpy(typename SparseVector<T>::value_type d, const SparseVector<T> &x, const Vector<D, T, A> &y) {
+    MutableVector<D, T, A> out = y;
+    x.axpy(d, std::span<T>(out.data(), D));
+    return out;
+};
+// d * x + y, for both sparse: a merge of the two.
+template<class T>
+SparseVector<T> axpy(typename SparseVector<T>::value_type d, const SparseVector<T> &x, const SparseVector<T> &y) {
+    return x * d + y;
+};
+
+#endif // bradbury_sparse_vector_h
@@ -0,0 +1,41 @@
+//
+//  transform.h
+//  bradbury
+//
+//  Bulk point transforms: one 4x4 matrix applied to a whole span of points,
+//  split across cores, for point clouds and vertex buffers.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_transform_h
+#define bradbury_transform_h
+
+#include <span>
+#include <type_traits>
+
+#include "matrix.h"
+#include "vector.h"
+
+// Outputs larger than this many bytes are written with non-temporal stores,
+// which go straight to memory instead of evicting the cache for data that will
+// not be read again soon.
+#ifndef BRADBURY_STREAMING_THRESHOLD
+#define BRADBURY_STREAMING_THRESHOLD (8 << 20)
+#endif
+
+// out[i] = m * in[i], for float or double points. Vector<3>s are points
+// (w = 1); when m is projective (its last row is not 0 0 0 1) each result is
+// divided by its w. Vector<4>s are transformed as they are.
+//
+// `out` is provided by the caller, must be as long as `in` (std::length_error
+// otherwise) and may be the same span. Nothing is allocated per point.
+//
+// T is deduced from the matrix alone, so containers convert to the spans.
+template<class T>
+void transformPoints(const Matrix<4, 4, T> &m, std::type_identity_t<std::span<const Vector<3, T>>> in, std::type_identity_t<std::span<Vector<3, T>>> out);
+template<class T>
+void transformPoints(const Matrix<4, 4, T> &m, std::type_identity_t<std::span<const Vector<4, T>>> in, std::type_identity_t<std::span<Vector<4, T>>> out);
+
+#endif // bradbury_transform_h
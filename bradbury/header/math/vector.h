@@ -2,8 +2,8 @@
 //  vector.h
 //  bradbury
 //
-//  An immutable, arbitrary length vector, designed for doubles, with typical
-//  matrix operations.
+//  An immutable, arbitrary length vector of doubles (or any other scalar
+//  type), with typical matrix operations.
 //
 //  Created by Ben Stolovitz on 12/14/14.
 //  Copyright (c) 2014 citelao. All rights reserved.
@@ -13,186 +13,422 @@
 #define bradbury_vector_h
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <ranges>
+#include <span>
 #include <string>
 #include <vector>
 #include <initializer_list>
 #include <iostream>
+#include <stdexcept>
+#include <type_traits>
 
-template<size_t D>
-class Vector {
+#include "simd.h"
+#include "vector_expression.h"
+
+// operator[] checks its index and throws std::out_of_range only when this is
+// set; by default that is in debug builds. Everything else is checked at
+// compile time: get<I>(), x() through t() and conversions between dimensions.
+#ifndef BRADBURY_CHECKED_ACCESS
+#ifdef DEBUG
+#define BRADBURY_CHECKED_ACCESS 1
+#else
+#define BRADBURY_CHECKED_ACCESS 0
+#endif
+#endif
+
+// Components are stored inline, so a Vector never allocates and can be copied
+// with a plain memcpy. A Vector is standard layout and holds nothing but its
+// D components: by default sizeof(Vector<D, T>) == D * sizeof(T), so an array
+// of Vectors is also an array of scalars (see components()). A may raise the
+// alignment, to 16 or 32 bytes for aligned SIMD loads; the size is then
+// rounded up to a multiple of A. Arithmetic operators return lazy expressions
+// (see vector_expression.h) that are only evaluated when assigned to a Vector.
+// Single operations on whole Vectors longer than BRADBURY_UNROLL_LIMIT (a + b,
+// -a, a * d, dot products and squared distances) run on the SIMD kernels in
+// simd.h instead. Shorter loops over the components are unrolled at compile
+// time; see unroll().
+//
+// Everything is constexpr, so Vectors can be built and combined at compile
+// time; constant evaluation always takes the plain loops.
+//
+// Vectors are not changed in place; accumulate into a MutableVector (see
+// mutable_vector.h) instead.
+//
+// T is the stored scalar type (double unless given). float, int32_t and half
+// are supported as well; half is widened to float for arithmetic. mixed
+// stores floats but sums them in double (see accumulate_type), for large
+// point clouds that want half the memory of double without losing accuracy
+// on long sums.
+template<size_t D, class T, size_t A>
+class Vector : public VectorExpression<D, Vector<D, T, A>> {
+    static_assert(A >= alignof(T) && (A & (A - 1)) == 0, "alignment must be a power of two no smaller than the scalar's");
+    
 public:
+    typedef T scalar_type;
+    typedef typename ScalarTraits<T>::compute_type value_type;
+    // The type of dot products and other sums; value_type but for mixed.
+    typedef typename ScalarTraits<T>::accumulate_type accumulate_type;
+    // Magnitudes and distances are real even for integer vectors.
+    typedef typename std::conditional<std::is_floating_point<accumulate_type>::value, accumulate_type, double>::type real_type;
+    
     // Default constructor
-    Vector() : Vector(0) {};
+    constexpr Vector() : Vector(0) {};
     
     // Default value constructor
-    template <class T>
-    Vector(T r) {
-        _components = std::vector<double>(D, r);
+    template <class U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+    constexpr Vector(U r) {
+        std::fill(_components, _components + D, static_cast<T>(r));
     };
     
     // Copy constructors
-    // TODO: This first specialization could be removed. It would leave a compile-
-    // time error instead of a run-time one.
-    template <size_t E>
-    Vector(Vector<E> const &vector) {
-        throw std::length_error("Cannot initalize vector of size " + std::to_string(E) + " for dimension " + std::to_string(D));
-    }
-    Vector(Vector<D> const &vector) {
-        _components = vector._components;
+    // Vectors of another dimension cannot be converted; those of the same
+    // dimension but another scalar type convert through the expression
+    // constructor below.
+    template <size_t E, class U, size_t B>
+    Vector(Vector<E, U, B> const &vector) requires (E != D) = delete;
+    constexpr Vector(Vector const &vector) = default;
+    constexpr Vector &operator=(Vector const &vector) = default;
+    
+    // Expression constructor & assignment: evaluates the whole expression in
+    // one pass. Every node is component-wise, so `v = v + w` is safe.
+    template <class E>
+    constexpr Vector(VectorExpression<D, E> const &expression) {
+        assign(expression.self());
+    };
+    template <class E>
+    constexpr Vector &operator=(VectorExpression<D, E> const &expression) {
+        assign(expression.self());
+        return *this;
     };
     
     // List & vector constructors
-    template <class T>
-    Vector(std::initializer_list<T> components) {
+    template <class U>
+    constexpr Vector(std::initializer_list<U> components) {
         if(components.size() != D) {
             throw std::length_error("Cannot initalize vector of size " + std::to_string(components.size()) + " for dimension " + std::to_string(D));
         }
         
-        _components = std::vector<double>(components.begin(), components.end());
+        std::transform(components.begin(), components.end(), _components, [](U u) { return static_cast<T>(u); });
     };
-    template <class T>
-    Vector(std::vector<T> components) {
+    template <class U>
+    constexpr Vector(std::vector<U> const &components) {
         if(components.size() != D) {
             throw std::length_error("Cannot initalize vector of size " + std::to_string(components.size()) + " for dimension " + std::to_string(D));
         }
         
-        _components = std::vector<double>(components.begin(), components.end());
+        std::transform(components.begin(), components.end(), _components, [](U u) { return static_cast<T>(u); });
     };
     
     // Specialized constructors for the first 4 dimensions.
-    template <class T>
-    Vector<2>(T x, T y) {
-        _components = {static_cast<double>(x), static_cast<double>(y)};
-    };
-    template <class T>
-    Vector<3>(T x, T y, T z) {
-        _components = {static_cast<double>(x), static_cast<double>(y), static_cast<double>(z)};
-    };
-    template <class T>
-    Vector<4>(T x, T y, T z, T t) {
-        _components = {static_cast<double>(x), static_cast<double>(y), static_cast<double>(z), static_cast<double>(t)};
-    };
+    template <class U, size_t E = D, typename std::enable_if<E == 2, int>::type = 0>
+    constexpr Vector(U x, U y) : _components{static_cast<T>(x), static_cast<T>(y)} {};
+    template <class U, size_t E = D, typename std::enable_if<E == 3, int>::type = 0>
+    constexpr Vector(U x, U y, U z) : _components{static_cast<T>(x), static_cast<T>(y), static_cast<T>(z)} {};
+    template <class U, size_t E = D, typename std::enable_if<E == 4, int>::type = 0>
+    constexpr Vector(U x, U y, U z, U t) : _components{static_cast<T>(x), static_cast<T>(y), static_cast<T>(z), static_cast<T>(t)} {};
     
     // Access operators
-    const double operator[](int i) const {
-        if(D <= i) {
-            throw std::out_of_range("no " + std::to_string(i) + " component for dimension " + std::to_string(D));
+    constexpr const T operator[](int i) const {
+#if BRADBURY_CHECKED_ACCESS
+        if(static_cast<size_t>(i) >= D) [[unlikely]] {
+            outOfRange(i);
         }
+#endif
         
         return _components[i];
     };
-    const double x() const {
-        return (*this)[0];
+    template <size_t I>
+    constexpr const T get() const requires (I < D) {
+        return _components[I];
     };
-    const double y() const {
-        if(D < 2) {
-            throw std::out_of_range("no y component for dimension " + std::to_string(D));
-        }
-        
-        return (*this)[1];
+    constexpr const T x() const {
+        return _components[0];
     };
-    const double z() const {
-        if(D < 3) {
-            throw std::out_of_range("no z component for dimension " + std::to_string(D));
-        }
-        
-        return (*this)[2];
+    constexpr const T y() const requires (D >= 2) {
+        return _components[1];
     };
-    const double t() const {
-        if(D < 4) {
-            throw std::out_of_range("no z component for dimension " + std::to_string(D));
-        }
-        
-        return (*this)[3];
+    constexpr const T z() const requires (D >= 3) {
+        return _components[2];
+    };
+    constexpr const T t() const requires (D >= 4) {
+        return _components[3];
     }
-    const double w() const {
+    constexpr const T w() const requires (D >= 4) {
         return t();
     }
     
-//    double magnitude() const;
-//    double squaredmagnitude() const;
+    // Unchecked component access for expression evaluation.
+    constexpr value_type evaluate(size_t i) const {
+        return static_cast<value_type>(_components[i]);
+    };
     
-    const size_t dimension() const {
+    // The components as a contiguous array.
+    constexpr const T *data() const {
+        return _components;
+    };
+    
+    constexpr const size_t dimension() const {
         return D;
     }
     
-    bool operator==(const Vector &nv) const {
-        if(nv.dimension() != this->dimension())
-            return false;
-        
-        Vector diff = nv - *this;
+    constexpr bool operator==(const Vector &nv) const {
+        bool equal = true;
+        unroll<D>([&](size_t i) {
+            value_type diff = nv.evaluate(i) - evaluate(i);
+            equal = equal && diff <= tolerance && -diff <= tolerance;
+        });
         
-        return (diff.x() < tolerance &&
-                diff.y() < tolerance &&
-                diff.z() < tolerance);
+        return equal;
     };
-    bool operator!=(const Vector &nv) const {
+    constexpr bool operator!=(const Vector &nv) const {
         return !this->operator==(nv);
     };
     
     // vector-vector operations
-    const Vector<D> operator+(const Vector<D> &nv) const {
-        std::vector<double> results = {};
-        for(int i = 0; i < _components.size(); i++) {
-            results.push_back(_components[i] + nv._components[i]);
+    // +, -, unary -, the dot product `*` and scalar `*` and `/` are lazy
+    // expressions; see vector_expression.h.
+    // Short vectors are cheaper to reduce inline than through a kernel call;
+    // only those past the unroll limit use one. The kernels sum long vectors
+    // pairwise, so a Vector<4096> keeps its accuracy. The same goes for
+    // squaredmagnitude() and squareddistance() below.
+    constexpr accumulate_type dot(const Vector &nv) const {
+        if constexpr(D > BRADBURY_UNROLL_LIMIT) {
+            if(!std::is_constant_evaluated()) {
+                if constexpr(simd::supported<T>) {
+                    return simd::kernels<T>().dot(_components, nv._components, D);
+                } else if constexpr(std::is_same<T, mixed>::value) {
+                    return simd::kernels<float>().widenedDot(floats(), nv.floats(), D);
+                }
+            }
         }
         
-        return Vector<D>(results);
+        accumulate_type result = 0;
+        unroll<D>([&](size_t i) {
+            result += static_cast<accumulate_type>(evaluate(i)) * nv.evaluate(i);
+        });
+        return result;
     };
-    const Vector<D> operator-(const Vector<D> &nv) const{
-        std::vector<double> results = {};
-        for(int i = 0; i < _components.size(); i++) {
-            results.push_back(_components[i] - nv._components[i]);
+    // Three components are always under the unroll limit, so this is inline
+    // like short dot products.
+    constexpr Vector cross(const Vector &nv) const requires (D == 3) {
+        return Vector(y() * nv.z() - z() * nv.y(),
+                      - x() * nv.z() + z() * nv.x(),
+                      x() * nv.y() - y() * nv.x());
+    };
+    
+    // reductions
+    constexpr accumulate_type squaredmagnitude() const {
+        return dot(*this);
+    };
+    constexpr real_type magnitude() const {
+        return root(static_cast<real_type>(squaredmagnitude()));
+    };
+    constexpr accumulate_type squareddistance(const Vector &nv) const {
+        if constexpr(D > BRADBURY_UNROLL_LIMIT) {
+            if(!std::is_constant_evaluated()) {
+                if constexpr(simd::supported<T>) {
+                    return simd::kernels<T>().squaredDistance(_components, nv._components, D);
+                } else if constexpr(std::is_same<T, mixed>::value) {
+                    return simd::kernels<float>().widenedSquaredDistance(floats(), nv.floats(), D);
+                }
+            }
         }
         
-        return Vector<D>(results);
-    }
-    Vector<D> operator-() const {
-        std::vector<double> results = {};
-        for(int i = 0; i < _components.size(); i++) {
-            results.push_back(-_components[i]);
+        accumulate_type result = 0;
+        unroll<D>([&](size_t i) {
+            accumulate_type diff = static_cast<accumulate_type>(evaluate(i)) - nv.evaluate(i);
+            result += diff * diff;
+        });
+        return result;
+    };
+    constexpr real_type distance(const Vector &nv) const {
+        return root(static_cast<real_type>(squareddistance(nv)));
+    };
+    
+    // A unit vector in the same direction. The zero vector has no direction
+    // and is returned unchanged.
+    constexpr Vector normalize() const requires std::is_floating_point<value_type>::value {
+        value_type length = magnitude();
+        if(length == 0) {
+            return *this;
         }
         
-        return Vector<D>(results);
-    };
-    double operator*(const Vector &nv) const {
-        return this->dot(nv);
+        return Vector(*this * (1 / length));
     };
-    double dot(const Vector &nv) const {
-        return x() * nv.x() +
-        y() * nv.y() +
-        z() * nv.z();
+    
+    // Approximations of magnitude() and normalize() for code that does not
+    // need every bit, such as lighting and steering: a hardware reciprocal
+    // square root estimate and one Newton step, within
+    // simd::approximationError (relative, per component) of the exact
+    // results. They save a square root and a divide per vector; to normalize
+    // millions at once, fastnormalize() a VectorArray, which does a register
+    // of vectors per instruction. Constant evaluation is exact.
+    constexpr real_type fastmagnitude() const requires std::is_floating_point<value_type>::value {
+        real_type squared = squaredmagnitude();
+        if(std::is_constant_evaluated() || squared == 0) {
+            return root(squared);
+        }
+        return squared * simd::approximateInverseSqrt(squared);
     };
-    Vector cross(const Vector &nv) const {
-        return Vector(y() * nv.z() - z() * nv.y(),
-                      - x() * nv.z() + z() * nv.x(),
-                      x() * nv.y() - y() * nv.x());
+    constexpr Vector fastnormalize() const requires std::is_floating_point<value_type>::value {
+        real_type squared = squaredmagnitude();
+        if(squared == 0) {
+            return *this;
+        }
+        if(std::is_constant_evaluated()) {
+            return normalize();
+        }
+        
+        return Vector(*this * simd::approximateInverseSqrt(squared));
     };
     
-    // vector-number operations
-    Vector operator*(const double &d) const  {
-        return Vector(x() * d,
-                      y() * d,
-                      z() * d);
+    constexpr T mincomponent() const {
+        T result = _components[0];
+        unroll<D>([&](size_t i) {
+            if(_components[i] < result) {
+                result = _components[i];
+            }
+        });
+        return result;
     };
-    friend Vector operator*(const double &d, const Vector &v)  {
-        return v * d;
+    constexpr T maxcomponent() const {
+        T result = _components[0];
+        unroll<D>([&](size_t i) {
+            if(_components[i] > result) {
+                result = _components[i];
+            }
+        });
+        return result;
     };
-    Vector operator/(const double &d) const {
-        return Vector(x() / d,
-                      y() / d,
-                      z() / d);
+    
+    // Linear interpolation: this vector at t = 0, nv at t = 1. Both ends are
+    // exact.
+    template <class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+    constexpr Vector lerp(const Vector &nv, S t) const {
+        Vector result;
+        unroll<D>([&](size_t i) {
+            result._components[i] = static_cast<T>(evaluate(i) * (1 - t) + nv.evaluate(i) * t);
+        });
+        return result;
     };
     
+    // The largest difference between components that still compares equal.
+    static constexpr double tolerance = 0.000001;
+    
 protected:
-    std::vector<double> _components;
+    alignas(A) T _components[D];
     
-    double tolerance = 0.000001;
     
-    template <typename Array>
-    void init(Array components) {
-        _components = components;
+    // Kept out of line so the checked operator[] stays small.
+    [[noreturn]] static void outOfRange(int i) {
+        throw std::out_of_range("no " + std::to_string(i) + " component for dimension " + std::to_string(D));
     };
+    
+private:
+    
+    // mixed components as the floats they hold, for the widening kernels.
+    const float *floats() const requires std::is_same<T, mixed>::value {
+        return reinterpret_cast<const float *>(_components);
+    };
+    
+    template <class E>
+    constexpr void assign(E const &expression) {
+        assignComponents(expression);
+    };
+    template <class E>
+    constexpr void assignComponents(E const &expression) {
+        unroll<D>([&](size_t i) {
+            _components[i] = static_cast<T>(expression.evaluate(i));
+        });
+    };
+    
+    // std::sqrt is not usable in constant expressions, so those take Newton's
+    // method instead. Starting at or above the root, each step decreases until
+    // it converges.
+    static constexpr real_type root(real_type x) {
+        if(!std::is_constant_evaluated()) {
+            return std::sqrt(x);
+        }
+        
+        if(!(x >= 0)) {
+            return std::numeric_limits<real_type>::quiet_NaN();
+        }
+        if(x == 0 || x == std::numeric_limits<real_type>::infinity()) {
+            return x;
+        }
+        
+        real_type r = x > 1 ? x : 1;
+        while(true) {
+            real_type next = (r + x / r) / 2;
+            if(next >= r) {
+                return r;
+            }
+            r = next;
+        }
+    };
+    
+    // Whole-vector operations past the unroll limit map directly onto a
+    // kernel where one exists for T; shorter ones, like dot(), are cheaper
+    // as the fused loop than through a kernel call. The kernels cannot run in
+    // a constant expression, so those fall back to the loop too.
+    constexpr void assign(VectorSum<D, Vector, Vector> const &expression) {
+        if constexpr(D > BRADBURY_UNROLL_LIMIT && simd::supported<T>) {
+            if(!std::is_constant_evaluated()) {
+                return simd::kernels<T>().add(expression.left()._components, expression.right()._components, _components, D);
+            }
+        }
+        assignComponents(expression);
+    };
+    constexpr void assign(VectorDifference<D, Vector, Vector> const &expression) {
+        if constexpr(D > BRADBURY_UNROLL_LIMIT && simd::supported<T>) {
+            if(!std::is_constant_evaluated()) {
+                return simd::kernels<T>().subtract(expression.left()._components, expression.right()._components, _components, D);
+            }
+        }
+        assignComponents(expression);
+    };
+    constexpr void assign(VectorNegation<D, Vector> const &expression) {
+        if constexpr(D > BRADBURY_UNROLL_LIMIT && simd::supported<T>) {
+            if(!std::is_constant_evaluated()) {
+                return simd::kernels<T>().negate(expression.operand()._components, _components, D);
+            }
+        }
+        assignComponents(expression);
+    };
+    constexpr void assign(VectorScale<D, Vector, value_type> const &expression) {
+        if constexpr(D > BRADBURY_UNROLL_LIMIT && simd::supported<T>) {
+            if(!std::is_constant_evaluated()) {
+                return simd::kernels<T>().scale(expression.operand()._components, expression.scalar(), _components, D);
+            }
+        }
+        assignComponents(expression);
+    };
+};
+
+template<size_t D, class T, size_t A>
+constexpr typename Vector<D, T, A>::accumulate_type operator*(const Vector<D, T, A> &l, const Vector<D, T, A> &r) {
+    return l.dot(r);
+};
+
+// A Vector (or MutableVector) with no padding: exactly its components.
+template<class V>
+concept PackedVector = requires { typename V::scalar_type; }
+    && std::is_standard_layout<V>::value
+    && sizeof(V) == V().dimension() * sizeof(typename V::scalar_type);
+
+// A contiguous range of packed Vectors viewed as its D * size() scalars, for
+// vertex buffers, file I/O and SIMD loads without a conversion copy. The view
+// is const if the range is.
+template<std::ranges::contiguous_range R>
+auto components(R &&vectors) requires PackedVector<std::ranges::range_value_t<R>> {
+    typedef std::ranges::range_value_t<R> V;
+    typedef typename std::conditional<std::is_const<std::remove_pointer_t<decltype(std::ranges::data(vectors))>>::value,
+                                      const typename V::scalar_type,
+                                      typename V::scalar_type>::type S;
+    
+    return std::span<S>(reinterpret_cast<S *>(std::ranges::data(vectors)), V().dimension() * std::ranges::size(vectors));
 };
 
 #endif // bradbury_vector_h
\ No newline at end of file
@@ -0,0 +1,330 @@
+//
+//  vector_array.h
+//  bradbury
+//
+//  A container of Vectors stored as a structure of arrays: one contiguous
+//  array per component, so bulk operations stream through memory and run on
+//  the SIMD kernels a whole register of vectors at a time.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_vector_array_h
+#define bradbury_vector_array_h
+
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "simd.h"
+#include "vector.h"
+
+template<size_t D, class T = double>
+class VectorArray;
+
+// One element of a VectorArray, standing in for a Vector<D, T>. It is an
+// expression like any other, so it can be combined with Vectors and other
+// elements and converts to a Vector on assignment. Unless Const, assigning to
+// it writes through to the array.
+//
+// Like any proxy, an element refers to its array: `auto v = array[i]` is not
+// a copy. Use `Vector<D, T> v = array[i]` for one.
+template<size_t D, class T, bool Const>
+class VectorArrayElement : public VectorExpression<D, VectorArrayElement<D, T, Const>> {
+public:
+    typedef T scalar_type;
+    typedef typename ScalarTraits<T>::compute_type value_type;
+    typedef typename std::conditional<Const, const VectorArray<D, T>, VectorArray<D, T>>::type array_type;
+
+    constexpr VectorArrayElement(array_type &array, size_t index) : _array(&array), _index(index) {};
+    constexpr VectorArrayElement(VectorArrayElement const &) = default;
+
+    // A writable element can be used where a read-only one is expected.
+    template <bool Other>
+    constexpr VectorArrayElement(VectorArrayElement<D, T, Other> const &element) requires (Const && !Other) : _array(&element.array()), _index(element.index()) {};
+
+    // Assignment writes components, it does not rebind the element. Every
+    // expression is component-wise, so `a[0] = a[0] + a[1]` is safe.
+    constexpr VectorArrayElement &operator=(VectorArrayElement const &element) requires (!Const) {
+        return *this = static_cast<VectorExpression<D, VectorArrayElement> const &>(element);
+    };
+    template <class E>
+    constexpr VectorArrayElement &operator=(VectorExpression<D, E> const &expression) requires (!Const) {
+        unroll<D>([&](size_t i) {
+            _array->component(i)[_index] = static_cast<T>(expression.self().evaluate(i));
+        });
+        return *this;
+    };
+
+    // Access operators
+    constexpr const T operator[](size_t i) const {
+        return _array->component(i)[_index];
+    };
+    template <size_t I>
+    constexpr const T get() const requires (I < D) {
+        return _array->component(I)[_index];
+    };
+    constexpr const T x() const {
+        return get<0>();
+    };
+    constexpr const T y() const requires (D >= 2) {
+        return get<1>();
+    };
+    constexpr const T z() const requires (D >= 3) {
+        return get<2>();
+    };
+    constexpr const T t() const requires (D >= 4) {
+        return get<3>();
+    };
+    constexpr const T w() const requires (D >= 4) {
+        return get<3>();
+    };
+
+    constexpr value_type evaluate(size_t i) const {
+        return static_cast<value_type>(_array->component(i)[_index]);
+    };
+
+    constexpr array_type &array() const {
+        return *_array;
+    };
+    constexpr size_t index() const {
+        return _index;
+    };
+
+private:
+    array_type *_array;
+    size_t _index;
+};
+
+// N Vectors of dimension D, held as D arrays of N scalars. Elements are read
+// and written through VectorArrayElement proxies; whole arrays are combined
+// with the bulk operations below, which run each component array through the
+// SIMD kernels in simd.h.
+template<size_t D, class T>
+class VectorArray {
+public:
+    typedef Vector<D, T> vector_type;
+    typedef T scalar_type;
+    typedef typename ScalarTraits<T>::compute_type value_type;
+    typedef VectorArrayElement<D, T, false> reference;
+    typedef VectorArrayElement<D, T, true> const_reference;
+
+    VectorArray() {};
+    explicit VectorArray(size_t size, vector_type const &value = vector_type()) {
+        resize(size, value);
+    };
+    VectorArray(std::initializer_list<vector_type> vectors) {
+        reserve(vectors.size());
+        for(vector_type const &vector : vectors) {
+            push_back(vector);
+        }
+    };
+
+    size_t size() const {
+        return _components[0].size();
+    };
+    bool empty() const {
+        return size() == 0;
+    };
+
+    void resize(size_t size, vector_type const &value = vector_type()) {
+        for(size_t i = 0; i < D; i++) {
+            _components[i].resize(size, value[i]);
+        }
+    };
+    void reserve(size_t capacity) {
+        for(size_t i = 0; i < D; i++) {
+            _components[i].reserve(capacity);
+        }
+    };
+    void clear() {
+        for(size_t i = 0; i < D; i++) {
+            _components[i].clear();
+        }
+    };
+    template <class E>
+    void push_back(VectorExpression<D, E> const &expression) {
+        unroll<D>([&](size_t i) {
+            _components[i].push_back(static_cast<T>(expression.self().evaluate(i)));
+        });
+    };
+
+    // Access operators
+    reference operator[](size_t i) {
+        return reference(*this, i);
+    };
+    const_reference operator[](size_t i) const {
+        return const_reference(*this, i);
+    };
+
+    // Throws std::length_error unless this holds `size` vectors.
+    void checkSize(size_t size) const {
+        if(this->size() != size) {
+            throw std::length_error("Cannot combine vector arrays of size " + std::to_string(this->size()) + " and " + std::to_string(size));
+        }
+    };
+
+    // The contiguous array holding component `i` of every vector.
+    T *component(size_t i) {
+        return _components[i].data();
+    };
+    const T *component(size_t i) const {
+        return _components[i].data();
+    };
+
+private:
+    std::vector<T> _components[D];
+};
+
+// Bulk operations. `out` is resized to match and may be one of the inputs;
+// arrays of different sizes throw std::length_error.
+
+// out[i] = a[i] + b[i]
+template<size_t D, class T>
+void add(VectorArray<D, T> const &a, VectorArray<D, T> const &b, VectorArray<D, T> &out) {
+    b.checkSize(a.size());
+    out.resize(a.size());
+    for(size_t c = 0; c < D; c++) {
+        if constexpr(simd::supported<T>) {
+            simd::kernels<T>().add(a.component(c), b.component(c), out.component(c), a.size());
+        } else {
+            for(size_t i = 0; i < a.size(); i++) {
+                out.component(c)[i] = static_cast<T>(a.component(c)[i] + b.component(c)[i]);
+            }
+        }
+    }
+};
+
+// out[i] = a[i] * d
+template<size_t D, class T>
+void scale(VectorArray<D, T> const &a, typename VectorArray<D, T>::value_type d, VectorArray<D, T> &out) {
+    out.resize(a.size());
+    for(size_t c = 0; c < D; c++) {
+        if constexpr(simd::supported<T>) {
+            simd::kernels<T>().scale(a.component(c), d, out.component(c), a.size());
+        } else {
+            for(size_t i = 0; i < a.size(); i++) {
+                out.component(c)[i] = static_cast<T>(a.component(c)[i] * d);
+            }
+        }
+    }
+};
+
+// y[i] = d * x[i] + y[i]
+template<size_t D, class T>
+void axpy(typename VectorArray<D, T>::value_type d, VectorArray<D, T> const &x, VectorArray<D, T> &y) {
+    y.checkSize(x.size());
+    for(size_t c = 0; c < D; c++) {
+        if constexpr(simd::supported<T>) {
+            simd::kernels<T>().axpy(d, x.component(c), y.component(c), y.component(c), x.size());
+        } else {
+            for(size_t i = 0; i < x.size(); i++) {
+                y.component(c)[i] = static_cast<T>(d * x.component(c)[i] + y.component(c)[i]);
+            }
+        }
+    }
+};
+
+// out[i] = a[i] . b[i], one dot product per element. `out` must hold size()
+// values.
+template<size_t D, class T>
+void dot(VectorArray<D, T> const &a, VectorArray<D, T> const &b, std::span<typename VectorArray<D, T>::value_type> out) {
+    b.checkSize(a.size());
+    if(out.size() != a.size()) {
+        throw std::length_error("Cannot write " + std::to_string(a.size()) + " dot products to " + std::to_string(out.size()) + " values");
+    }
+
+    if constexpr(simd::supported<T>) {
+        simd::Kernels<T> const &k = simd::kernels<T>();
+        k.multiply(a.component(0), b.component(0), out.data(), a.size());
+        for(size_t c = 1; c < D; c++) {
+            k.multiplyAdd(a.component(c), b.component(c), out.data(), out.data(), a.size());
+        }
+    } else {
+        for(size_t i = 0; i < a.size(); i++) {
+            out[i] = a[i] * b[i];
+        }
+    }
+};
+
+// out[i] = a[i] / |a[i]|. Zero vectors are left unchanged, as in
+// Vector::normalize().
+template<size_t D, class T>
+void normalize(VectorArray<D, T> const &a, VectorArray<D, T> &out) requires std::is_floating_point<typename VectorArray<D, T>::value_type>::value {
+    typedef typename VectorArray<D, T>::value_type value_type;
+
+    std::vector<value_type> inverse(a.size());
+    dot(a, a, std::span<value_type>(inverse));
+    out.resize(a.size());
+
+    if constexpr(simd::supported<T>) {
+        simd::Kernels<T> const &k = simd::kernels<T>();
+        k.inverseSqrt(inverse.data(), inverse.data(), a.size());
+        for(size_t i = 0; i < a.size(); i++) {
+            inverse[i] = inverse[i] == std::numeric_limits<value_type>::infinity() ? 1 : inverse[i];
+        }
+        for(size_t c = 0; c < D; c++) {
+            k.multiply(a.component(c), inverse.data(), out.component(c), a.size());
+        }
+    } else {
+        for(size_t i = 0; i < a.size(); i++) {
+            inverse[i] = inverse[i] == 0 ? 1 : 1 / std::sqrt(inverse[i]);
+        }
+        for(size_t c = 0; c < D; c++) {
+            for(size_t i = 0; i < a.size(); i++) {
+                out.component(c)[i] = static_cast<T>(a.component(c)[i] * inverse[i]);
+            }
+        }
+    }
+};
+
+// normalize() through the approximate inverse square root kernel: within
+// simd::approximationError of it, per component, and about twice as fast.
+// The level picks the kernels, as in simd::kernels(Level), for testing.
+template<size_t D, class T>
+void fastnormalize(VectorArray<D, T> const &a, VectorArray<D, T> &out, simd::Level level) requires std::is_floating_point<typename VectorArray<D, T>::value_type>::value {
+    typedef typename VectorArray<D, T>::value_type value_type;
+
+    std::vector<value_type> inverse(a.size());
+    dot(a, a, std::span<value_type>(inverse));
+    out.resize(a.size());
+
+    if constexpr(simd::supported<T>) {
+        simd::Kernels<T> const &k = simd::kernels<T>(level);
+        std::vector<value_type> estimate(a.size());
+        k.approximateInverseSqrt(inverse.data(), estimate.data(), a.size());
+        // Below AVX-512 the kernel estimates in float, so it takes what
+        // simd::approximateInverseSqrt() does: positive normal floats. Redo
+        // anything else exactly, leaving zero vectors unchanged.
+        for(size_t i = 0; i < a.size(); i++) {
+            if(inverse[i] >= std::numeric_limits<float>::min() && inverse[i] <= std::numeric_limits<float>::max()) [[likely]] {
+                inverse[i] = estimate[i];
+            } else {
+                inverse[i] = inverse[i] == 0 ? 1 : 1 / std::sqrt(inverse[i]);
+            }
+        }
+        for(size_t c = 0; c < D; c++) {
+            k.multiply(a.component(c), inverse.data(), out.component(c), a.size());
+        }
+    } else {
+        for(size_t i = 0; i < a.size(); i++) {
+            inverse[i] = inverse[i] == 0 ? 1 : simd::approximateInverseSqrt(inverse[i]);
+        }
+        for(size_t c = 0; c < D; c++) {
+            for(size_t i = 0; i < a.size(); i++) {
+                out.component(c)[i] = static_cast<T>(a.component(c)[i] * inverse[i]);
+            }
+        }
+    }
+};
+template<size_t D, class T>
+void fastnormalize(VectorArray<D, T> const &a, VectorArray<D, T> &out) requires std::is_floating_point<typename VectorArray<D, T>::value_type>::value {
+    fastnormalize(a, out, simd::detected());
+};
+
+#endif // bradbury_vector_array_h
@@ -0,0 +1,251 @@
+//
+//  vector_expression.h
+//  bradbury
+//
+//  Lazy expression nodes for Vector arithmetic. Operators build a tree of
+//  these nodes instead of temporaries; the tree is evaluated component by
+//  component, in a single loop, when it is assigned to a Vector.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_vector_expression_h
+#define bradbury_vector_expression_h
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "half.h"
+#include "mixed.h"
+
+// The scalar type defaults to double and the alignment to the scalar's own
+// here, at Vector's first declaration.
+template<size_t D, class T = double, size_t A = alignof(T)>
+class Vector;
+
+// Arithmetic on a stored scalar happens in its compute_type; half is widened
+// to float. Dot products, magnitudes and sums accumulate in accumulate_type,
+// which is wider for mixed.
+template<class T>
+struct ScalarTraits {
+    typedef T compute_type;
+    typedef T accumulate_type;
+};
+template<>
+struct ScalarTraits<half> {
+    typedef float compute_type;
+    typedef float accumulate_type;
+};
+template<>
+struct ScalarTraits<mixed> {
+    typedef float compute_type;
+    typedef double accumulate_type;
+};
+
+// Scaling keeps a floating point expression's precision (a float Vector times
+// a double literal stays float) and promotes integer expressions as usual.
+template<class T, class S>
+using ScaledType = typename std::conditional<std::is_floating_point<T>::value, T, typename std::common_type<T, S>::type>::type;
+
+// Loops over a dimension are unrolled at compile time up to this many
+// components; longer vectors keep an ordinary loop rather than generate one
+// statement per component.
+#ifndef BRADBURY_UNROLL_LIMIT
+#define BRADBURY_UNROLL_LIMIT 16
+#endif
+
+// Calls f(i) for every i < N, in order.
+template<size_t N, class F>
+constexpr void unroll(F &&f) {
+    if constexpr(N <= BRADBURY_UNROLL_LIMIT) {
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (f(I), ...);
+        }(std::make_index_sequence<N>());
+    } else {
+        for(size_t i = 0; i < N; i++) {
+            f(i);
+        }
+    }
+};
+
+// Base of every expression of dimension D. E is the concrete node type.
+template<size_t D, class E>
+class VectorExpression {
+public:
+    constexpr const E &self() const {
+        return static_cast<const E &>(*this);
+    };
+
+    constexpr size_t dimension() const {
+        return D;
+    }
+};
+
+// Vectors are held by reference; intermediate nodes are small and held by
+// value, so a whole expression can outlive the full-expression it was built in
+// as long as its Vector operands do.
+template<class E>
+struct VectorExpressionStorage {
+    typedef const E type;
+};
+template<size_t D, class T, size_t A>
+struct VectorExpressionStorage<Vector<D, T, A>> {
+    typedef const Vector<D, T, A> &type;
+};
+
+template<size_t D, class L, class R>
+class VectorSum : public VectorExpression<D, VectorSum<D, L, R>> {
+public:
+    typedef typename std::common_type<typename L::value_type, typename R::value_type>::type value_type;
+
+    constexpr VectorSum(const L &l, const R &r) : _l(l), _r(r) {};
+
+    constexpr const L &left() const {
+        return _l;
+    };
+    constexpr const R &right() const {
+        return _r;
+    };
+
+    constexpr value_type evaluate(size_t i) const {
+        return _l.evaluate(i) + _r.evaluate(i);
+    };
+
+private:
+    typename VectorExpressionStorage<L>::type _l;
+    typename VectorExpressionStorage<R>::type _r;
+};
+
+template<size_t D, class L, class R>
+class VectorDifference : public VectorExpression<D, VectorDifference<D, L, R>> {
+public:
+    typedef typename std::common_type<typename L::value_type, typename R::value_type>::type value_type;
+
+    constexpr VectorDifference(const L &l, const R &r) : _l(l), _r(r) {};
+
+    constexpr const L &left() const {
+        return _l;
+    };
+    constexpr const R &right() const {
+        return _r;
+    };
+
+    constexpr value_type evaluate(size_t i) const {
+        return _l.evaluate(i) - _r.evaluate(i);
+    };
+
+private:
+    typename VectorExpressionStorage<L>::type _l;
+    typename VectorExpressionStorage<R>::type _r;
+};
+
+template<size_t D, class E>
+class VectorNegation : public VectorExpression<D, VectorNegation<D, E>> {
+public:
+    typedef typename E::value_type value_type;
+
+    constexpr VectorNegation(const E &e) : _e(e) {};
+
+    constexpr const E &operand() const {
+        return _e;
+    };
+
+    constexpr value_type evaluate(size_t i) const {
+        return -_e.evaluate(i);
+    };
+
+private:
+    typename VectorExpressionStorage<E>::type _e;
+};
+
+// S is the already-promoted scalar type; see ScaledType.
+template<size_t D, class E, class S>
+class VectorScale : public VectorExpression<D, VectorScale<D, E, S>> {
+public:
+    typedef S value_type;
+
+    constexpr VectorScale(const E &e, S d) : _e(e), _d(d) {};
+
+    constexpr const E &operand() const {
+        return _e;
+    };
+    constexpr S scalar() const {
+        return _d;
+    };
+
+    constexpr value_type evaluate(size_t i) const {
+        return _e.evaluate(i) * _d;
+    };
+
+private:
+    typename VectorExpressionStorage<E>::type _e;
+    S _d;
+};
+
+template<size_t D, class E, class S>
+class VectorQuotient : public VectorExpression<D, VectorQuotient<D, E, S>> {
+public:
+    typedef S value_type;
+
+    constexpr VectorQuotient(const E &e, S d) : _e(e), _d(d) {};
+
+    constexpr const E &operand() const {
+        return _e;
+    };
+    constexpr S scalar() const {
+        return _d;
+    };
+
+    constexpr value_type evaluate(size_t i) const {
+        return _e.evaluate(i) / _d;
+    };
+
+private:
+    typename VectorExpressionStorage<E>::type _e;
+    S _d;
+};
+
+// vector-vector operations
+template<size_t D, class L, class R>
+constexpr VectorSum<D, L, R> operator+(const VectorExpression<D, L> &l, const VectorExpression<D, R> &r) {
+    return VectorSum<D, L, R>(l.self(), r.self());
+};
+template<size_t D, class L, class R>
+constexpr VectorDifference<D, L, R> operator-(const VectorExpression<D, L> &l, const VectorExpression<D, R> &r) {
+    return VectorDifference<D, L, R>(l.self(), r.self());
+};
+template<size_t D, class E>
+constexpr VectorNegation<D, E> operator-(const VectorExpression<D, E> &e) {
+    return VectorNegation<D, E>(e.self());
+};
+
+// The dot product consumes its operands directly, so `(a - b) * c` never
+// materializes `a - b`.
+template<size_t D, class L, class R>
+constexpr typename std::common_type<typename L::value_type, typename R::value_type>::type
+operator*(const VectorExpression<D, L> &l, const VectorExpression<D, R> &r) {
+    typename std::common_type<typename L::value_type, typename R::value_type>::type result = 0;
+    unroll<D>([&](size_t i) {
+        result += l.self().evaluate(i) * r.self().evaluate(i);
+    });
+
+    return result;
+};
+
+// vector-number operations
+template<size_t D, class E, class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+constexpr VectorScale<D, E, ScaledType<typename E::value_type, S>> operator*(const VectorExpression<D, E> &e, const S &d) {
+    return VectorScale<D, E, ScaledType<typename E::value_type, S>>(e.self(), d);
+};
+template<size_t D, class E, class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+constexpr VectorScale<D, E, ScaledType<typename E::value_type, S>> operator*(const S &d, const VectorExpression<D, E> &e) {
+    return VectorScale<D, E, ScaledType<typename E::value_type, S>>(e.self(), d);
+};
+template<size_t D, class E, class S, typename std::enable_if<std::is_arithmetic<S>::value, int>::type = 0>
+constexpr VectorQuotient<D, E, ScaledType<typename E::value_type, S>> operator/(const VectorExpression<D, E> &e, const S &d) {
+    return VectorQuotient<D, E, ScaledType<typename E::value_type, S>>(e.self(), d);
+};
+
+#endif // bradbury_vector_expression_h
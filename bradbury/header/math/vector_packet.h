@@ -0,0 +1,319 @@
+//
+//  vector_packet.h
+//  bradbury
+//
+//  W Vectors processed side by side, one per SIMD lane, for ray, particle and
+//  collision kernels that handle several items per instruction.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_vector_packet_h
+#define bradbury_vector_packet_h
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include "mutable_vector.h"
+#include "vector.h"
+
+// One bit per lane of a packet, as produced by packet comparisons.
+template<size_t W>
+class PacketMask {
+    static_assert(W >= 1 && W <= 64, "masks hold up to 64 lanes");
+
+public:
+    constexpr PacketMask() : _bits(0) {};
+    constexpr explicit PacketMask(uint64_t bits) : _bits(bits & full()) {};
+
+    constexpr bool operator[](size_t lane) const {
+        return (_bits >> lane) & 1;
+    };
+    constexpr uint64_t bits() const {
+        return _bits;
+    };
+
+    constexpr bool any() const {
+        return _bits != 0;
+    };
+    constexpr bool all() const {
+        return _bits == full();
+    };
+    constexpr bool none() const {
+        return _bits == 0;
+    };
+
+    constexpr PacketMask operator&(PacketMask m) const {
+        return PacketMask(_bits & m._bits);
+    };
+    constexpr PacketMask operator|(PacketMask m) const {
+        return PacketMask(_bits | m._bits);
+    };
+    constexpr PacketMask operator~() const {
+        return PacketMask(~_bits);
+    };
+    constexpr bool operator==(PacketMask m) const {
+        return _bits == m._bits;
+    };
+
+private:
+    uint64_t _bits;
+
+    static constexpr uint64_t full() {
+        return W == 64 ? ~uint64_t(0) : (uint64_t(1) << W) - 1;
+    };
+};
+
+// W Vector<D, T>s in AoSoA layout: component c of every lane is contiguous,
+// so each operation below is a loop of fixed length W over aligned storage
+// that the compiler turns into a handful of vector instructions (one for
+// 8 floats under AVX2). Packets are small values and evaluate eagerly.
+//
+// The operations mirror Vector's, lane by lane. Reductions such as dot()
+// return a ScalarPacket (a packet of dimension 1) and comparisons return a
+// PacketMask.
+//
+// Vectors move in and out with load/store (W consecutive Vectors, with a count
+// for a partial packet) and gather/scatter (W Vectors picked by index).
+template<size_t D, size_t W, class T = double>
+class VectorPacket {
+    static_assert(std::is_arithmetic<T>::value, "packets hold arithmetic scalars");
+    static_assert(W >= 1 && W <= 64 && (W & (W - 1)) == 0, "the lane count must be a power of two no larger than 64");
+
+public:
+    typedef T scalar_type;
+    typedef T value_type;
+    typedef Vector<D, T> vector_type;
+    typedef VectorPacket<1, W, T> scalar_packet;
+    typedef PacketMask<W> mask_type;
+
+    static constexpr size_t width = W;
+
+    // Constructors
+    constexpr VectorPacket() : VectorPacket(T(0)) {};
+    // Every lane holds r in every component.
+    constexpr VectorPacket(T r) {
+        for(size_t c = 0; c < D; c++) {
+            for(size_t l = 0; l < W; l++) {
+                _lanes[c][l] = r;
+            }
+        }
+    };
+    // Every lane holds v.
+    template <size_t A>
+    constexpr explicit VectorPacket(Vector<D, T, A> const &v) {
+        for(size_t c = 0; c < D; c++) {
+            for(size_t l = 0; l < W; l++) {
+                _lanes[c][l] = v[c];
+            }
+        }
+    };
+
+    // Vectors in and out
+    // Lanes past `count` are zero on load and left alone on store.
+    template <size_t A>
+    static VectorPacket load(Vector<D, T, A> const *vectors, size_t count = W) {
+        VectorPacket packet;
+        for(size_t l = 0; l < count && l < W; l++) {
+            packet.setLane(l, vectors[l]);
+        }
+        return packet;
+    };
+    template <size_t A>
+    void store(Vector<D, T, A> *vectors, size_t count = W) const {
+        for(size_t l = 0; l < count && l < W; l++) {
+            vectors[l] = lane(l);
+        }
+    };
+    template <size_t A, class I>
+    static VectorPacket gather(Vector<D, T, A> const *vectors, I const *indices) {
+        VectorPacket packet;
+        for(size_t l = 0; l < W; l++) {
+            packet.setLane(l, vectors[indices[l]]);
+        }
+        return packet;
+    };
+    template <size_t A, class I>
+    void scatter(Vector<D, T, A> *vectors, I const *indices) const {
+        for(size_t l = 0; l < W; l++) {
+            vectors[indices[l]] = lane(l);
+        }
+    };
+
+    // Access operators
+    constexpr vector_type lane(size_t l) const {
+        MutableVector<D, T> v;
+        for(size_t c = 0; c < D; c++) {
+            v[c] = _lanes[c][l];
+        }
+        return v;
+    };
+    template <size_t A>
+    constexpr void setLane(size_t l, Vector<D, T, A> const &v) {
+        for(size_t c = 0; c < D; c++) {
+            _lanes[c][l] = v[c];
+        }
+    };
+    // Component c of every lane, contiguous.
+    constexpr const T *component(size_t c) const {
+        return _lanes[c];
+    };
+    constexpr T *component(size_t c) {
+        return _lanes[c];
+    };
+    constexpr T operator[](size_t l) const requires (D == 1) {
+        return _lanes[0][l];
+    };
+
+    constexpr size_t dimension() const {
+        return D;
+    };
+
+    // packet-packet operations
+    constexpr VectorPacket operator+(VectorPacket const &p) const {
+        return map(p, [](T a, T b) { return a + b; });
+    };
+    constexpr VectorPacket operator-(VectorPacket const &p) const {
+        return map(p, [](T a, T b) { return a - b; });
+    };
+    constexpr VectorPacket operator-() const {
+        return map(*this, [](T a, T) { return -a; });
+    };
+    // Each lane scaled by the matching lane of s.
+    constexpr VectorPacket operator*(scalar_packet const &s) const requires (D != 1) {
+        VectorPacket result;
+        for(size_t c = 0; c < D; c++) {
+            for(size_t l = 0; l < W; l++) {
+                result._lanes[c][l] = _lanes[c][l] * s.component(0)[l];
+            }
+        }
+        return result;
+    };
+    constexpr VectorPacket operator*(VectorPacket const &p) const requires (D == 1) {
+        return map(p, [](T a, T b) { return a * b; });
+    };
+    constexpr VectorPacket operator/(VectorPacket const &p) const requires (D == 1) {
+        return map(p, [](T a, T b) { return a / b; });
+    };
+
+    // packet-number operations
+    constexpr VectorPacket operator*(T d) const {
+        return map(*this, [d](T a, T) { return a * d; });
+    };
+    constexpr VectorPacket operator/(T d) const {
+        return map(*this, [d](T a, T) { return a / d; });
+    };
+
+    constexpr scalar_packet dot(VectorPacket const &p) const {
+        scalar_packet result;
+        T *out = result.component(0);
+        for(size_t c = 0; c < D; c++) {
+            for(size_t l = 0; l < W; l++) {
+                out[l] += _lanes[c][l] * p._lanes[c][l];
+            }
+        }
+        return result;
+    };
+    constexpr VectorPacket cross(VectorPacket const &p) const requires (D == 3) {
+        VectorPacket result;
+        for(size_t l = 0; l < W; l++) {
+            result._lanes[0][l] = _lanes[1][l] * p._lanes[2][l] - _lanes[2][l] * p._lanes[1][l];
+            result._lanes[1][l] = _lanes[2][l] * p._lanes[0][l] - _lanes[0][l] * p._lanes[2][l];
+            result._lanes[2][l] = _lanes[0][l] * p._lanes[1][l] - _lanes[1][l] * p._lanes[0][l];
+        }
+        return result;
+    };
+
+    constexpr scalar_packet squaredmagnitude() const {
+        return dot(*this);
+    };
+    scalar_packet magnitude() const requires std::is_floating_point<T>::value {
+        scalar_packet result = squaredmagnitude();
+        T *out = result.component(0);
+        for(size_t l = 0; l < W; l++) {
+            out[l] = std::sqrt(out[l]);
+        }
+        return result;
+    };
+    // Zero lanes are left unchanged, as in Vector::normalize().
+    VectorPacket normalize() const requires std::is_floating_point<T>::value {
+        scalar_packet inverse = magnitude();
+        T *out = inverse.component(0);
+        for(size_t l = 0; l < W; l++) {
+            out[l] = out[l] == 0 ? 1 : 1 / out[l];
+        }
+        return *this * inverse;
+    };
+
+    // Comparisons, lane by lane. equal() uses Vector's tolerance.
+    constexpr mask_type equal(VectorPacket const &p) const {
+        uint64_t bits = 0;
+        for(size_t l = 0; l < W; l++) {
+            bool same = true;
+            for(size_t c = 0; c < D; c++) {
+                T diff = _lanes[c][l] - p._lanes[c][l];
+                same = same && diff <= vector_type::tolerance && -diff <= vector_type::tolerance;
+            }
+            bits |= uint64_t(same) << l;
+        }
+        return mask_type(bits);
+    };
+    constexpr mask_type operator<(VectorPacket const &p) const requires (D == 1) {
+        return compare(p, [](T a, T b) { return a < b; });
+    };
+    constexpr mask_type operator<=(VectorPacket const &p) const requires (D == 1) {
+        return compare(p, [](T a, T b) { return a <= b; });
+    };
+    constexpr mask_type operator>(VectorPacket const &p) const requires (D == 1) {
+        return compare(p, [](T a, T b) { return a > b; });
+    };
+    constexpr mask_type operator>=(VectorPacket const &p) const requires (D == 1) {
+        return compare(p, [](T a, T b) { return a >= b; });
+    };
+
+    // Lanes of a where the mask is set, of b elsewhere.
+    static constexpr VectorPacket select(mask_type mask, VectorPacket const &a, VectorPacket const &b) {
+        VectorPacket result;
+        for(size_t c = 0; c < D; c++) {
+            for(size_t l = 0; l < W; l++) {
+                result._lanes[c][l] = mask[l] ? a._lanes[c][l] : b._lanes[c][l];
+            }
+        }
+        return result;
+    };
+
+private:
+    alignas(W * sizeof(T) < 64 ? W * sizeof(T) : 64) T _lanes[D][W];
+
+    template <class F>
+    constexpr VectorPacket map(VectorPacket const &p, F f) const {
+        VectorPacket result;
+        for(size_t c = 0; c < D; c++) {
+            for(size_t l = 0; l < W; l++) {
+                result._lanes[c][l] = f(_lanes[c][l], p._lanes[c][l]);
+            }
+        }
+        return result;
+    };
+    template <class F>
+    constexpr mask_type compare(VectorPacket const &p, F f) const {
+        uint64_t bits = 0;
+        for(size_t l = 0; l < W; l++) {
+            bits |= uint64_t(f(_lanes[0][l], p._lanes[0][l])) << l;
+        }
+        return mask_type(bits);
+    };
+};
+
+// W scalars, one per lane: the result of packet reductions.
+template<size_t W, class T = double>
+using ScalarPacket = VectorPacket<1, W, T>;
+
+template<size_t D, size_t W, class T>
+constexpr VectorPacket<D, W, T> operator*(T d, VectorPacket<D, W, T> const &p) {
+    return p * d;
+};
+
+#endif // bradbury_vector_packet_h
@@ -0,0 +1,157 @@
+//
+//  aabb.h
+//  bradbury
+//
+//  Axis-aligned bounding boxes in 3D, the bounding volumes of the spatial
+//  structures.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_aabb_h
+#define bradbury_aabb_h
+
+#include <algorithm>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+#include "ray.h"
+#include "reduce.h"
+#include "vector.h"
+
+// The box between two corners, lower <= upper in every component. Like Vector
+// it is an immutable value; merge() returns a new box.
+//
+// The default box is empty: its lower corner is +infinity and its upper
+// -infinity, so it contains and overlaps nothing and merging anything into it
+// gives that thing's box.
+template<class T = double>
+class AABB {
+    static_assert(std::is_floating_point<T>::value, "boxes hold floats or doubles");
+
+public:
+    typedef T scalar_type;
+
+    // Default constructor: the empty box.
+    constexpr AABB() : _lower(std::numeric_limits<T>::infinity()), _upper(-std::numeric_limits<T>::infinity()) {};
+    constexpr AABB(const Vector<3, T> &lower, const Vector<3, T> &upper) : _lower(lower), _upper(upper) {};
+    constexpr explicit AABB(const Bounds<3, T> &bounds) : AABB(bounds.lower, bounds.upper) {};
+
+    // The box around a point, a sphere, or many points (the empty box for
+    // none). Many points are bounded in parallel; see bounds() in reduce.h.
+    static constexpr AABB around(const Vector<3, T> &point) {
+        return AABB(point, point);
+    };
+    static constexpr AABB around(const Vector<3, T> &center, T radius) {
+        return AABB(Vector<3, T>(center - Vector<3, T>(radius)), Vector<3, T>(center + Vector<3, T>(radius)));
+    };
+    static AABB around(std::span<const Vector<3, T>> points) {
+        if(points.empty()) {
+            return AABB();
+        }
+        return AABB(bounds(points));
+    };
+
+    // Access operators
+    constexpr const Vector<3, T> &lower() const {
+        return _lower;
+    };
+    constexpr const Vector<3, T> &upper() const {
+        return _upper;
+    };
+    constexpr Vector<3, T> center() const {
+        return Vector<3, T>((_lower + _upper) * T(0.5));
+    };
+    // upper - lower: the size along each axis.
+    constexpr Vector<3, T> extent() const {
+        return Vector<3, T>(_upper - _lower);
+    };
+
+    constexpr bool empty() const {
+        return _lower.x() > _upper.x() || _lower.y() > _upper.y() || _lower.z() > _upper.z();
+    };
+    // The SAH cost of a box is proportional to this. Zero for the empty box.
+    constexpr T surfacearea() const {
+        if(empty()) {
+            return 0;
+        }
+        Vector<3, T> e = extent();
+        return 2 * (e.x() * e.y() + e.y() * e.z() + e.z() * e.x());
+    };
+
+    constexpr bool operator==(const AABB &box) const {
+        return _lower == box._lower && _upper == box._upper;
+    };
+    constexpr bool operator!=(const AABB &box) const {
+        return !this->operator==(box);
+    };
+
+    // The smallest box containing both.
+    constexpr AABB merge(const AABB &box) const {
+        return AABB(Vector<3, T>(std::min(_lower.x(), box._lower.x()), std::min(_lower.y(), box._lower.y()), std::min(_lower.z(), box._lower.z())),
+                    Vector<3, T>(std::max(_upper.x(), box._upper.x()), std::max(_upper.y(), box._upper.y()), std::max(_upper.z(), box._upper.z())));
+    };
+    constexpr AABB merge(const Vector<3, T> &point) const {
+        return merge(around(point));
+    };
+
+    // Boundaries count as inside.
+    constexpr bool contains(const Vector<3, T> &point) const {
+        return _lower.x() <= point.x() && point.x() <= _upper.x() &&
+               _lower.y() <= point.y() && point.y() <= _upper.y() &&
+               _lower.z() <= point.z() && point.z() <= _upper.z();
+    };
+    constexpr bool contains(const AABB &box) const {
+        return contains(box._lower) && contains(box._upper);
+    };
+    constexpr bool overlaps(const AABB &box) const {
+        return _lower.x() <= box._upper.x() && box._lower.x() <= _upper.x() &&
+               _lower.y() <= box._upper.y() && box._lower.y() <= _upper.y() &&
+               _lower.z() <= box._upper.z() && box._lower.z() <= _upper.z();
+    };
+    // Whether the sphere of `radius` about `center` touches the box.
+    constexpr bool overlaps(const Vector<3, T> &center, T radius) const {
+        return squareddistance(center) <= radius * radius;
+    };
+
+    // The squared distance from the point to the nearest point of the box;
+    // zero inside.
+    constexpr T squareddistance(const Vector<3, T> &point) const {
+        T result = 0;
+        for(size_t c = 0; c < 3; c++) {
+            T p = point.data()[c];
+            T d = std::max(std::max(_lower.data()[c] - p, p - _upper.data()[c]), T(0));
+            result += d * d;
+        }
+        return result;
+    };
+
+    // The distance along the ray at which it enters the box, if that is in
+    // [tmin, tmax]; infinity if it misses. A ray starting inside enters at
+    // tmin. This is the slab test: the ray's intervals within each pair of
+    // planes, intersected. A ray lying in one of the planes (0 * infinity)
+    // counts as inside that slab.
+    constexpr T intersect(const Ray<T> &ray, T tmin, T tmax) const {
+        const T *origin = ray.origin().data();
+        const T *inverse = ray.inverse().data();
+        for(size_t c = 0; c < 3; c++) {
+            T near = (_lower.data()[c] - origin[c]) * inverse[c];
+            T far = (_upper.data()[c] - origin[c]) * inverse[c];
+            if(inverse[c] < 0) {
+                std::swap(near, far);
+            }
+            // Written so that NaN leaves the interval alone.
+            tmin = near > tmin ? near : tmin;
+            tmax = far < tmax ? far : tmax;
+        }
+        return tmin <= tmax ? tmin : std::numeric_limits<T>::infinity();
+    };
+
+private:
+    Vector<3, T> _lower;
+    Vector<3, T> _upper;
+};
+
+#endif // bradbury_aabb_h
@@ -0,0 +1,238 @@
+//
+//  bvh.h
+//  bradbury
+//
+//  A bounding volume hierarchy over boxes, for logarithmic ray, box and
+//  sphere queries in place of linear scans.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_bvh_h
+#define bradbury_bvh_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "aabb.h"
+#include "ray.h"
+#include "vector.h"
+
+// Candidate split planes per axis when building: each node's primitives are
+// sorted into this many bins by centroid, and the surface area heuristic is
+// evaluated at every boundary between bins.
+#ifndef BRADBURY_BVH_BINS
+#define BRADBURY_BVH_BINS 16
+#endif
+
+// Nodes with at most this many primitives become leaves.
+#ifndef BRADBURY_BVH_LEAF
+#define BRADBURY_BVH_LEAF 4
+#endif
+
+// A binary tree of boxes over a set of primitives, given by their bounding
+// boxes. Queries report primitives by their index in that set; the tree knows
+// nothing else about them, so ray queries take a callback for the exact test.
+//
+// Construction is top down with binned SAH (the surface area heuristic):
+// each node's primitives are binned by centroid along its longest axis, and
+// it is split at the bin boundary that minimizes the expected cost of a
+// query, area(left) * count(left) + area(right) * count(right).
+//
+// The tree is built a level at a time. Nodes with many primitives are binned
+// in parallel chunks, and a level's other nodes are split in parallel with
+// each other (see parallel.h). Results are combined in chunk and node order,
+// so the tree is the same on any number of threads.
+//
+// Nodes are stored in one array with the root first and siblings adjacent;
+// leaves hold a run of the primitives, whose boxes are copied into the same
+// order for locality. Queries walk the tree with a fixed stack and do not
+// allocate (except to return vectors), and a built tree may be queried from
+// many threads at once.
+template<class T = double>
+class BVH {
+public:
+    typedef T scalar_type;
+
+    // No primitive: the index of a Hit that missed.
+    static constexpr size_t none = std::numeric_limits<size_t>::max();
+
+    // count == 0 for interior nodes, whose children are nodes `start` and
+    // `start + 1`. Leaves hold primitives [start, start + count) of indices().
+    struct Node {
+        AABB<T> bounds;
+        uint32_t start;
+        uint32_t count;
+    };
+
+    struct Hit {
+        size_t index;
+        T distance;
+
+        explicit operator bool() const {
+            return index != none;
+        };
+    };
+
+    // Default constructor: no primitives.
+    BVH() = default;
+    // Builds the tree over `boxes`, which it copies. At most 2^32 - 1
+    // primitives (std::length_error otherwise), each with a finite, nonempty
+    // box (std::invalid_argument otherwise).
+    explicit BVH(std::span<const AABB<T>> boxes);
+
+    size_t size() const {
+        return _indices.size();
+    };
+    std::span<const Node> nodes() const {
+        return _nodes;
+    };
+    // The primitives in leaf order.
+    std::span<const uint32_t> indices() const {
+        return _indices;
+    };
+    // The box around every primitive.
+    AABB<T> bounds() const {
+        return _nodes.empty() ? AABB<T>() : _nodes[0].bounds;
+    };
+
+    // Box and sphere queries: f(index) for every primitive whose box overlaps
+    // `box`, or the sphere of `radius` about `center`, in no particular
+    // order.
+    template <class F>
+    void query(const AABB<T> &box, F f) const {
+        visit([&](const AABB<T> &b) { return b.overlaps(box); }, f);
+    };
+    template <class F>
+    void query(const Vector<3, T> &center, T radius, F f) const {
+        visit([&](const AABB<T> &b) { return b.overlaps(center, radius); }, f);
+    };
+    std::vector<size_t> query(const AABB<T> &box) const {
+        std::vector<size_t> found;
+        query(box, [&](size_t index) { found.push_back(index); });
+        return found;
+    };
+    std::vector<size_t> query(const Vector<3, T> &center, T radius) const {
+        std::vector<size_t> found;
+        query(center, radius, [&](size_t index) { found.push_back(index); });
+        return found;
+    };
+
+    // Ray queries. For every primitive whose box the ray enters within
+    // [0, tmax], nearer nodes first, calls f(index, tmax) and continues with
+    // the tmax it returns: returning a shorter one (the distance of a hit)
+    // prunes everything beyond it.
+    template <class F>
+    void query(const Ray<T> &ray, T tmax, F f) const {
+        // Misses are at infinity; keep them beyond even an unlimited ray.
+        tmax = std::min(tmax, std::numeric_limits<T>::max());
+        if(_nodes.empty() || _nodes[0].bounds.intersect(ray, 0, tmax) > tmax) {
+            return;
+        }
+
+        std::pair<uint32_t, T> stack[stackDepth];
+        size_t top = 0;
+        stack[top++] = {0, 0};
+        while(top > 0) {
+            auto [index, entry] = stack[--top];
+            if(entry > tmax) {
+                continue;
+            }
+
+            const Node &node = _nodes[index];
+            if(node.count > 0) {
+                for(size_t k = node.start; k < node.start + node.count; k++) {
+                    if(_boxes[k].intersect(ray, 0, tmax) <= tmax) {
+                        tmax = f(static_cast<size_t>(_indices[k]), tmax);
+                    }
+                }
+                continue;
+            }
+
+            // Push the farther child first so the nearer is taken next.
+            T left = _nodes[node.start].bounds.intersect(ray, 0, tmax);
+            T right = _nodes[node.start + 1].bounds.intersect(ray, 0, tmax);
+            bool leftFirst = left <= right;
+            T nearer = leftFirst ? left : right;
+            T farther = leftFirst ? right : left;
+            if(farther <= tmax) {
+                stack[top++] = {node.start + (leftFirst ? 1 : 0), farther};
+            }
+            if(nearer <= tmax) {
+                stack[top++] = {node.start + (leftFirst ? 0 : 1), nearer};
+            }
+        }
+    };
+    // Every primitive whose box the ray enters within [0, tmax].
+    std::vector<size_t> query(const Ray<T> &ray, T tmax = std::numeric_limits<T>::infinity()) const {
+        std::vector<size_t> found;
+        query(ray, tmax, [&](size_t index, T limit) {
+            found.push_back(index);
+            return limit;
+        });
+        return found;
+    };
+    // The nearest hit within [0, tmax]. intersect(index) is the exact test: it
+    // returns the distance at which the ray hits primitive `index`, or
+    // infinity for a miss. The Hit's index is `none` if nothing is hit.
+    template <class F>
+    Hit closest(const Ray<T> &ray, F intersect, T tmax = std::numeric_limits<T>::infinity()) const {
+        Hit best = {none, std::numeric_limits<T>::infinity()};
+        query(ray, tmax, [&](size_t index, T limit) {
+            T distance = intersect(index);
+            if(distance >= 0 && distance <= limit && distance < std::numeric_limits<T>::infinity()) {
+                best = {index, distance};
+                return distance;
+            }
+            return limit;
+        });
+        return best;
+    };
+
+private:
+    // Below this depth nodes are split at their median instead of by SAH,
+    // which bounds the depth of any tree at sahDepth + 32 and with it the
+    // traversal stack.
+    static const size_t sahDepth = 64;
+    static const size_t stackDepth = sahDepth + 33;
+
+    std::vector<Node> _nodes;
+    std::vector<uint32_t> _indices;
+    std::vector<AABB<T>> _boxes;
+
+    template <class O, class F>
+    void visit(O overlaps, F f) const {
+        if(_nodes.empty()) {
+            return;
+        }
+
+        uint32_t stack[stackDepth];
+        size_t top = 0;
+        stack[top++] = 0;
+        while(top > 0) {
+            const Node &node = _nodes[stack[--top]];
+            if(!overlaps(node.bounds)) {
+                continue;
+            }
+
+            if(node.count > 0) {
+                for(size_t k = node.start; k < node.start + node.count; k++) {
+                    if(overlaps(_boxes[k])) {
+                        f(static_cast<size_t>(_indices[k]));
+                    }
+                }
+            } else {
+                stack[top++] = node.start + 1;
+                stack[top++] = node.start;
+            }
+        }
+    };
+};
+
+#endif // bradbury_bvh_h
@@ -0,0 +1,88 @@
+//
+//  frustum.h
+//  bradbury
+//
+//  The volume a camera sees, as six planes, for culling boxes against it.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_frustum_h
+#define bradbury_frustum_h
+
+#include <array>
+#include <type_traits>
+
+#include "aabb.h"
+#include "matrix.h"
+#include "vector.h"
+
+// The intersection of six half-spaces. Each plane is (a, b, c, d), and a
+// point p is inside it when a * p.x + b * p.y + c * p.z + d >= 0. The planes
+// need not be normalized.
+template<class T = double>
+class Frustum {
+    static_assert(std::is_floating_point<T>::value, "frustums hold floats or doubles");
+
+public:
+    typedef T scalar_type;
+
+    constexpr explicit Frustum(const std::array<Vector<4, T>, 6> &planes) : _planes(planes) {};
+    // The frustum of a projection (or projection * view) matrix: everything
+    // that lands in the clip cube, -w <= x, y, z <= w. Planes are left,
+    // right, bottom, top, near and far, in that order.
+    constexpr explicit Frustum(const Matrix<4, 4, T> &m) : _planes{
+        Vector<4, T>(m.row(3) + m.row(0)), Vector<4, T>(m.row(3) - m.row(0)),
+        Vector<4, T>(m.row(3) + m.row(1)), Vector<4, T>(m.row(3) - m.row(1)),
+        Vector<4, T>(m.row(3) + m.row(2)), Vector<4, T>(m.row(3) - m.row(2))} {};
+
+    constexpr const std::array<Vector<4, T>, 6> &planes() const {
+        return _planes;
+    };
+
+    constexpr bool contains(const Vector<3, T> &point) const {
+        for(const Vector<4, T> &plane : _planes) {
+            if(side(plane, point.x(), point.y(), point.z()) < 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+    // Whether the box is wholly inside.
+    constexpr bool contains(const AABB<T> &box) const {
+        for(const Vector<4, T> &plane : _planes) {
+            if(side(plane, nearest(plane, box, 0), nearest(plane, box, 1), nearest(plane, box, 2)) < 0) {
+                return false;
+            }
+        }
+        return !box.empty();
+    };
+    // Whether the box may overlap: false only if it is wholly outside some
+    // plane, so a box just beyond a corner of the frustum can pass.
+    constexpr bool overlaps(const AABB<T> &box) const {
+        for(const Vector<4, T> &plane : _planes) {
+            if(side(plane, farthest(plane, box, 0), farthest(plane, box, 1), farthest(plane, box, 2)) < 0) {
+                return false;
+            }
+        }
+        return !box.empty();
+    };
+
+private:
+    std::array<Vector<4, T>, 6> _planes;
+
+    static constexpr T side(const Vector<4, T> &plane, T x, T y, T z) {
+        return plane.x() * x + plane.y() * y + plane.z() * z + plane.t();
+    };
+    // The box's corner coordinate farthest along, or against, the plane's
+    // normal on axis `a`.
+    static constexpr T farthest(const Vector<4, T> &plane, const AABB<T> &box, size_t a) {
+        return plane.data()[a] >= 0 ? box.upper().data()[a] : box.lower().data()[a];
+    };
+    static constexpr T nearest(const Vector<4, T> &plane, const AABB<T> &box, size_t a) {
+        return plane.data()[a] >= 0 ? box.lower().data()[a] : box.upper().data()[a];
+    };
+};
+
+#endif // bradbury_frustum_h
@@ -0,0 +1,176 @@
+//
+//  hash_grid.h
+//  bradbury
+//
+//  A uniform grid over the plane or space, hashed so that only occupied
+//  cells take memory, for finding pairs of nearby moving objects.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_hash_grid_h
+#define bradbury_hash_grid_h
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "vector.h"
+
+// A broadphase: objects are points, sorted into cubes (squares in 2D) of side
+// cellSize, and any two objects in the same or adjacent cells are a candidate
+// pair. So every two objects within cellSize of each other on every axis are
+// candidates, and for spheres of radius at most r a cell size of 2r finds
+// every overlap. The caller does the exact test.
+//
+// Objects are named by the ids insert() returns; erased ids are reused. Cells
+// are found through an open-addressed table and hold their objects in a flat
+// array. Moving an object within its cell only records its position, and
+// moving it to another cell is a swap-and-pop from the old cell's array and
+// a push onto the new one's, so an update costs O(1) per object however much
+// of the scene moved. pairs() visits each occupied cell and half of its
+// neighbours, so it costs O(objects + candidates) and reports each pair once.
+//
+// Cells beyond 2^31 steps from the origin on any axis are not supported. A
+// grid may be queried from many threads at once, but not while it changes.
+template<size_t D, class T = double>
+class HashGrid {
+    static_assert(D == 2 || D == 3, "hash grids are over the plane or space");
+    static_assert(std::is_floating_point<T>::value, "hash grids are over real positions");
+
+public:
+    typedef T scalar_type;
+    // A cell's coordinates: a position divided by the cell size, rounded down.
+    typedef std::array<int32_t, D> Key;
+
+    // No object, or no cell.
+    static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+    // An empty grid of cells `cellSize` on a side, which must be positive
+    // (std::invalid_argument otherwise).
+    explicit HashGrid(T cellSize);
+
+    T cellSize() const {
+        return _cellSize;
+    };
+    // The number of objects.
+    size_t size() const {
+        return _objects.size() - _free.size();
+    };
+    Key key(const Vector<D, T> &position) const;
+
+    // Adds an object at `position` and returns its id.
+    uint32_t insert(const Vector<D, T> &position);
+    // Moves object `id`; std::out_of_range if there is none.
+    void move(uint32_t id, const Vector<D, T> &position);
+    // Moves object i to positions[i] for every i, as a grid whose objects
+    // were inserted in order would be updated each frame.
+    void move(std::span<const Vector<D, T>> positions);
+    void erase(uint32_t id);
+    const Vector<D, T> &position(uint32_t id) const;
+
+    // f(a, b) once for every candidate pair: objects a != b in the same or
+    // adjacent cells. Pairs come in no particular order, and neither do a
+    // and b.
+    template <class F>
+    void pairs(F f) const {
+        for(const Cell &cell : _cells) {
+            const std::vector<uint32_t> &objects = cell.objects;
+            for(size_t i = 0; i < objects.size(); i++) {
+                for(size_t j = i + 1; j < objects.size(); j++) {
+                    f(objects[i], objects[j]);
+                }
+            }
+            if(objects.empty()) {
+                continue;
+            }
+
+            for(const Key &offset : forward()) {
+                uint32_t other = find(shift(cell.key, offset));
+                if(other == none) {
+                    continue;
+                }
+                for(uint32_t a : objects) {
+                    for(uint32_t b : _cells[other].objects) {
+                        f(a, b);
+                    }
+                }
+            }
+        }
+    };
+    // Every candidate pair, each with first < second.
+    std::vector<std::pair<uint32_t, uint32_t>> pairs() const {
+        std::vector<std::pair<uint32_t, uint32_t>> found;
+        pairs([&](uint32_t a, uint32_t b) {
+            found.push_back(a < b ? std::make_pair(a, b) : std::make_pair(b, a));
+        });
+        return found;
+    };
+
+    // f(id) for every object in the cell of `point` or one adjacent to it.
+    template <class F>
+    void query(const Vector<D, T> &point, F f) const {
+        Key center = key(point);
+        for(const Key &offset : neighbourhood()) {
+            uint32_t cell = find(shift(center, offset));
+            if(cell == none) {
+                continue;
+            }
+            for(uint32_t id : _cells[cell].objects) {
+                f(id);
+            }
+        }
+    };
+    std::vector<uint32_t> query(const Vector<D, T> &point) const {
+        std::vector<uint32_t> found;
+        query(point, [&](uint32_t id) { found.push_back(id); });
+        return found;
+    };
+
+private:
+    struct Object {
+        Vector<D, T> position;
+        // `none` once erased.
+        uint32_t cell;
+        // The object's place in its cell's array.
+        uint32_t slot;
+    };
+
+    struct Cell {
+        Key key;
+        std::vector<uint32_t> objects;
+    };
+
+    T _cellSize;
+    T _inverse;
+    std::vector<Object> _objects;
+    std::vector<uint32_t> _free;
+    // Every cell occupied since the table was last rebuilt, some perhaps
+    // empty now; they are dropped when it is.
+    std::vector<Cell> _cells;
+    // Indices into _cells by hash of the key, `none` for free slots, with
+    // linear probing. Its size is a power of two, at least twice _cells'.
+    std::vector<uint32_t> _table;
+
+    static size_t hash(const Key &key);
+    static Key shift(const Key &key, const Key &offset);
+    // The offsets of a cell's neighbours that come after it, one of each
+    // pair of opposites; and of the cell and all its neighbours.
+    static const std::vector<Key> &forward();
+    static const std::vector<Key> &neighbourhood();
+
+    uint32_t find(const Key &key) const;
+    uint32_t findOrAdd(const Key &key);
+    void rebuild();
+    void place(uint32_t id, uint32_t cell);
+    void remove(uint32_t id);
+    void check(uint32_t id) const;
+};
+
+#endif // bradbury_hash_grid_h
@@ -0,0 +1,348 @@
+//
+//  kd_tree.h
+//  bradbury
+//
+//  A k-d tree over points, for nearest-neighbour, k-nearest and radius
+//  queries in place of all-pairs distance checks.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_kd_tree_h
+#define bradbury_kd_tree_h
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+#include "vector.h"
+
+// Nodes with at most this many points become leaves.
+#ifndef BRADBURY_KDTREE_LEAF
+#define BRADBURY_KDTREE_LEAF 8
+#endif
+
+// A binary tree over points in D dimensions. Queries report points by their
+// index in the set the tree was built from.
+//
+// Every node is split at the median of its points along the axis on which
+// they spread furthest, so the tree is balanced and at most 32 levels deep.
+// The tree is built a level at a time, a level's nodes in parallel with each
+// other (see parallel.h); it is the same on any number of threads.
+//
+// The points are copied into tree order, so a leaf's points are adjacent in
+// memory. Queries walk the tree with a fixed stack, nearer side first, and
+// skip any node farther than the best found so far; they compare squared
+// distances and do not allocate except to return results. A built tree may
+// be queried from many threads at once, and the batched queries below do so.
+template<size_t D, class T = double>
+class KDTree {
+    static_assert(std::is_floating_point<T>::value, "k-d trees are over real points");
+
+public:
+    typedef T scalar_type;
+
+    // No point: the index of a Neighbor that was not found.
+    static constexpr size_t none = std::numeric_limits<size_t>::max();
+
+    // count == 0 for interior nodes, whose children are nodes `start` and
+    // `start + 1`: points below `split` on `axis` to the left, above it to
+    // the right. Leaves hold points [start, start + count) of points().
+    struct Node {
+        T split;
+        uint32_t axis;
+        uint32_t start;
+        uint32_t count;
+    };
+
+    struct Neighbor {
+        size_t index;
+        T distance;
+
+        explicit operator bool() const {
+            return index != none;
+        };
+    };
+
+    // Default constructor: no points.
+    KDTree() = default;
+    // Builds the tree over `points`, which it copies. At most 2^32 - 1 points
+    // (std::length_error otherwise).
+    explicit KDTree(std::span<const Vector<D, T>> points);
+
+    size_t size() const {
+        return _points.size();
+    };
+    std::span<const Node> nodes() const {
+        return _nodes;
+    };
+    // The points in tree order, and the index of each in the original set.
+    std::span<const Vector<D, T>> points() const {
+        return _points;
+    };
+    std::span<const uint32_t> indices() const {
+        return _indices;
+    };
+
+    // The nearest point no farther than maxDistance; its index is `none` if
+    // there is none. Of equally near points, any one.
+    Neighbor nearest(const Vector<D, T> &point, T maxDistance = std::numeric_limits<T>::infinity()) const {
+        Neighbor best = {none, std::numeric_limits<T>::infinity()};
+        T bestSquared = std::numeric_limits<T>::infinity();
+        search(point, square(maxDistance), [&](uint32_t k, T squared) {
+            if(squared < bestSquared) {
+                best.index = _indices[k];
+                bestSquared = squared;
+            }
+            return bestSquared;
+        });
+        best.distance = std::sqrt(bestSquared);
+        return best;
+    };
+    // The k nearest points no farther than maxDistance, nearest first; fewer
+    // if there are not that many.
+    std::vector<Neighbor> knearest(const Vector<D, T> &point, size_t k, T maxDistance = std::numeric_limits<T>::infinity()) const {
+        std::vector<Neighbor> found;
+        knearest(point, k, maxDistance, found);
+        return found;
+    };
+    // Every point within `radius` of `point`, in no particular order.
+    std::vector<Neighbor> within(const Vector<D, T> &point, T radius) const {
+        std::vector<Neighbor> found;
+        within(point, radius, found);
+        return found;
+    };
+
+    // Batched queries, spread over threads. results[i] = nearest(queries[i]).
+    void nearest(std::span<const Vector<D, T>> queries, std::span<Neighbor> results, T maxDistance = std::numeric_limits<T>::infinity()) const {
+        checkSize(queries.size(), results.size());
+        parallel::forChunks(queries.size(), batchGrain, [&](size_t, size_t begin, size_t end) {
+            for(size_t i = begin; i < end; i++) {
+                results[i] = nearest(queries[i], maxDistance);
+            }
+        });
+    };
+    // results holds k neighbours per query, query by query: knearest(queries[i])
+    // at [i * k, i * k + k), padded with misses (index `none`, infinite
+    // distance) when fewer are found.
+    void knearest(std::span<const Vector<D, T>> queries, size_t k, std::span<Neighbor> results, T maxDistance = std::numeric_limits<T>::infinity()) const {
+        checkSize(queries.size() * k, results.size());
+        parallel::forChunks(queries.size(), batchGrain, [&](size_t, size_t begin, size_t end) {
+            std::vector<Neighbor> found;
+            for(size_t i = begin; i < end; i++) {
+                knearest(queries[i], k, maxDistance, found);
+                std::copy(found.begin(), found.end(), results.begin() + i * k);
+                std::fill(results.begin() + i * k + found.size(), results.begin() + (i + 1) * k, Neighbor{none, std::numeric_limits<T>::infinity()});
+            }
+        });
+    };
+    // within(queries[i], radius) for every query.
+    std::vector<std::vector<Neighbor>> within(std::span<const Vector<D, T>> queries, T radius) const {
+        std::vector<std::vector<Neighbor>> results(queries.size());
+        parallel::forChunks(queries.size(), batchGrain, [&](size_t, size_t begin, size_t end) {
+            for(size_t i = begin; i < end; i++) {
+                within(queries[i], radius, results[i]);
+            }
+        });
+        return results;
+    };
+
+private:
+    // Queries per chunk of a batch. A query costs microseconds, far more
+    // than a vector kernel's item.
+    static const size_t batchGrain = 64;
+    // Median splits halve every node, so no tree of 2^32 points is deeper
+    // than 32; a traversal holds at most one pending node per level.
+    static const size_t stackDepth = 34;
+
+    std::vector<Node> _nodes;
+    std::vector<Vector<D, T>> _points;
+    std::vector<uint32_t> _indices;
+
+    static T square(T t) {
+        return t * t;
+    };
+
+    static void checkSize(size_t expected, size_t actual) {
+        if(expected != actual) {
+            throw std::length_error("Cannot combine query batches of size " + std::to_string(expected) + " and " + std::to_string(actual));
+        }
+    };
+
+    // Calls f(k, squared distance) for points of points() within the bound,
+    // nearest subtrees first, and continues with the bound it returns.
+    template <class F>
+    void search(const Vector<D, T> &point, T bound, F f) const {
+        if(_nodes.empty()) {
+            return;
+        }
+
+        // Each pending node with a lower bound on its squared distance.
+        std::pair<uint32_t, T> stack[stackDepth];
+        size_t top = 0;
+        stack[top++] = {0, 0};
+        while(top > 0) {
+            auto [index, floor] = stack[--top];
+            if(floor > bound) {
+                continue;
+            }
+
+            const Node &node = _nodes[index];
+            if(node.count > 0) {
+                for(size_t k = node.start; k < node.start + node.count; k++) {
+                    T squared = point.squareddistance(_points[k]);
+                    if(squared <= bound) {
+                        bound = f(static_cast<uint32_t>(k), squared);
+                    }
+                }
+                continue;
+            }
+
+            T offset = point.data()[node.axis] - node.split;
+            bool left = offset < 0;
+            T farther = std::max(floor, square(offset));
+            if(farther <= bound) {
+                stack[top++] = {node.start + (left ? 1 : 0), farther};
+            }
+            stack[top++] = {node.start + (left ? 0 : 1), floor};
+        }
+    };
+
+    void knearest(const Vector<D, T> &point, size_t k, T maxDistance, std::vector<Neighbor> &found) const {
+        found.clear();
+        if(k == 0) {
+            return;
+        }
+
+        // A max-heap of the k best so far, by squared distance.
+        auto farther = [](const Neighbor &a, const Neighbor &b) { return a.distance < b.distance; };
+        search(point, square(maxDistance), [&](uint32_t i, T squared) {
+            if(found.size() < k) {
+                found.push_back({_indices[i], squared});
+                std::push_heap(found.begin(), found.end(), farther);
+            } else if(squared < found.front().distance) {
+                std::pop_heap(found.begin(), found.end(), farther);
+                found.back() = {_indices[i], squared};
+                std::push_heap(found.begin(), found.end(), farther);
+            }
+            return found.size() < k ? square(maxDistance) : found.front().distance;
+        });
+
+        std::sort_heap(found.begin(), found.end(), farther);
+        for(Neighbor &n : found) {
+            n.distance = std::sqrt(n.distance);
+        }
+    };
+
+    void within(const Vector<D, T> &point, T radius, std::vector<Neighbor> &found) const {
+        found.clear();
+        T bound = square(radius);
+        search(point, bound, [&](uint32_t i, T squared) {
+            found.push_back({_indices[i], std::sqrt(squared)});
+            return bound;
+        });
+    };
+};
+
+template<size_t D, class T>
+KDTree<D, T>::KDTree(std::span<const Vector<D, T>> points) {
+    if(points.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Cannot build a tree of " + std::to_string(points.size()) + " points");
+    }
+    if(points.empty()) {
+        return;
+    }
+
+    _indices.resize(points.size());
+    std::iota(_indices.begin(), _indices.end(), uint32_t(0));
+
+    // Node `node` over points [begin, end) of the indices.
+    struct Task {
+        uint32_t node;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    _nodes.push_back(Node{0, 0, 0, 0});
+    std::vector<Task> level = {Task{0, 0, static_cast<uint32_t>(points.size())}};
+    while(!level.empty()) {
+        // Tasks cover disjoint runs of the indices, so a level's medians are
+        // independent of each other.
+        parallel::forChunks(level.size(), 1, [&](size_t, size_t begin, size_t end) {
+            for(size_t t = begin; t < end; t++) {
+                const Task &task = level[t];
+                Node &node = _nodes[task.node];
+                if(task.end - task.begin <= BRADBURY_KDTREE_LEAF) {
+                    node.start = task.begin;
+                    node.count = task.end - task.begin;
+                    continue;
+                }
+
+                std::array<T, D> lower, upper;
+                lower.fill(std::numeric_limits<T>::infinity());
+                upper.fill(-std::numeric_limits<T>::infinity());
+                for(size_t k = task.begin; k < task.end; k++) {
+                    const T *p = points[_indices[k]].data();
+                    for(size_t a = 0; a < D; a++) {
+                        lower[a] = std::min(lower[a], p[a]);
+                        upper[a] = std::max(upper[a], p[a]);
+                    }
+                }
+                size_t axis = 0;
+                for(size_t a = 1; a < D; a++) {
+                    if(upper[a] - lower[a] > upper[axis] - lower[axis]) {
+                        axis = a;
+                    }
+                }
+
+                uint32_t middle = task.begin + (task.end - task.begin) / 2;
+                std::nth_element(_indices.begin() + task.begin, _indices.begin() + middle, _indices.begin() + task.end, [&](uint32_t a, uint32_t b) {
+                    return points[a].data()[axis] < points[b].data()[axis];
+                });
+                node.split = points[_indices[middle]].data()[axis];
+                node.axis = static_cast<uint32_t>(axis);
+                node.count = 0;
+                // The middle of the run; children are allocated below.
+                node.start = middle;
+            }
+        });
+
+        std::vector<Task> next;
+        for(const Task &task : level) {
+            Node &node = _nodes[task.node];
+            if(node.count > 0) {
+                continue;
+            }
+
+            uint32_t middle = node.start;
+            uint32_t left = static_cast<uint32_t>(_nodes.size());
+            node.start = left;
+            _nodes.push_back(Node{0, 0, 0, 0});
+            _nodes.push_back(Node{0, 0, 0, 0});
+            next.push_back(Task{left, task.begin, middle});
+            next.push_back(Task{left + 1, middle, task.end});
+        }
+        level = std::move(next);
+    }
+
+    _points.resize(points.size());
+    parallel::forChunks(points.size(), 1 << 14, [&](size_t, size_t begin, size_t end) {
+        for(size_t k = begin; k < end; k++) {
+            _points[k] = points[_indices[k]];
+        }
+    });
+}
+
+#endif // bradbury_kd_tree_h
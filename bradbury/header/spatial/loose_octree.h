@@ -0,0 +1,248 @@
+//
+//  loose_octree.h
+//  bradbury
+//
+//  A loose octree over moving boxes, for box, frustum and ray queries over
+//  scenes too uneven for a grid and too lively to rebuild every frame.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_loose_octree_h
+#define bradbury_loose_octree_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "aabb.h"
+#include "frustum.h"
+#include "ray.h"
+#include "vector.h"
+
+// Levels below the root. Cells at the deepest level are the root's size
+// over 2^depth.
+#ifndef BRADBURY_OCTREE_DEPTH
+#define BRADBURY_OCTREE_DEPTH 8
+#endif
+
+// A leaf splits when an object would join it already holding this many of
+// its own.
+#ifndef BRADBURY_OCTREE_CAPACITY
+#define BRADBURY_OCTREE_CAPACITY 8
+#endif
+
+// Each cell's loose bounds are its cell scaled about its center by this
+// much, so objects near a boundary need not move up a level.
+#ifndef BRADBURY_OCTREE_LOOSENESS
+#define BRADBURY_OCTREE_LOOSENESS 2
+#endif
+
+// An octree whose cells overlap: an object belongs to one cell whose loose
+// bounds contain its box, so it is found by visiting the cells whose loose
+// bounds a query touches. With a looseness of 2, an object fits any cell at
+// least as large as it that holds its center. Objects go as deep as the tree
+// goes; a leaf splits once it holds more than BRADBURY_OCTREE_CAPACITY
+// objects, and those of them that fit a child move down.
+//
+// Nodes are pooled in one array, children in blocks of eight addressed by
+// the index of the first; a node's objects are a list threaded through the
+// object array by index. Children are returned to the pool when their
+// parent's subtree empties, so memory follows the objects however unevenly
+// they are spread.
+//
+// update() is lazy: an object that stays within its cell's loose bounds only
+// has its box replaced. One that leaves climbs to the nearest cell that
+// holds it and descends from there. Objects outside the root's loose bounds
+// are kept at the root and still found.
+//
+// Objects are named by the ids insert() returns; erased ids are reused.
+// Queries walk the tree with a fixed stack and do not allocate (except to
+// return vectors). A tree may be queried from many threads at once, but not
+// while it changes.
+template<class T = double>
+class LooseOctree {
+    static_assert(std::is_floating_point<T>::value, "octrees hold floats or doubles");
+    static_assert(BRADBURY_OCTREE_DEPTH <= 20, "deeper octrees would underflow their cells");
+
+public:
+    typedef T scalar_type;
+
+    // No object, node or children.
+    static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+    struct Node {
+        Vector<3, T> center;
+        // Half the cell's side.
+        T half;
+        uint32_t depth;
+        uint32_t parent;
+        // The first of eight children, by octant: bit 0 set for +x, bit 1
+        // for +y and bit 2 for +z. `none` for leaves.
+        uint32_t children;
+        // The first of the node's own objects, and how many it has.
+        uint32_t first;
+        uint32_t own;
+        // Objects in the node and below it; 0 for pooled nodes.
+        uint32_t count;
+    };
+
+    // An empty tree whose root cell is the cube centered on `world` with the
+    // side of its longest. std::invalid_argument if `world` is empty.
+    explicit LooseOctree(const AABB<T> &world);
+
+    // The number of objects.
+    size_t size() const {
+        return _objects.size() - _free.size();
+    };
+    // Every node, including pooled ones.
+    std::span<const Node> nodes() const {
+        return _nodes;
+    };
+    AABB<T> loose(const Node &node) const {
+        return AABB<T>::around(node.center, node.half * T(BRADBURY_OCTREE_LOOSENESS));
+    };
+
+    // Adds an object and returns its id.
+    uint32_t insert(const AABB<T> &box);
+    // Replaces object `id`'s box; std::out_of_range if there is none.
+    void update(uint32_t id, const AABB<T> &box);
+    void erase(uint32_t id);
+    const AABB<T> &bounds(uint32_t id) const;
+    // The node holding object `id`.
+    uint32_t node(uint32_t id) const;
+
+    // f(id) for every object whose box overlaps `box`, or may overlap
+    // `frustum` (see Frustum::overlaps()), in no particular order.
+    template <class F>
+    void query(const AABB<T> &box, F f) const {
+        visit([&](const AABB<T> &b) { return b.overlaps(box); }, [&](const AABB<T> &b) { return box.contains(b); }, f);
+    };
+    template <class F>
+    void query(const Frustum<T> &frustum, F f) const {
+        visit([&](const AABB<T> &b) { return frustum.overlaps(b); }, [&](const AABB<T> &b) { return frustum.contains(b); }, f);
+    };
+    std::vector<uint32_t> query(const AABB<T> &box) const {
+        std::vector<uint32_t> found;
+        query(box, [&](uint32_t id) { found.push_back(id); });
+        return found;
+    };
+    std::vector<uint32_t> query(const Frustum<T> &frustum) const {
+        std::vector<uint32_t> found;
+        query(frustum, [&](uint32_t id) { found.push_back(id); });
+        return found;
+    };
+
+    // Ray queries, as BVH's: for every object whose box the ray enters within
+    // [0, tmax], calls f(id, tmax) and continues with the tmax it returns.
+    // Objects come in no particular order.
+    template <class F>
+    void query(const Ray<T> &ray, T tmax, F f) const {
+        // Misses are at infinity; keep them beyond even an unlimited ray.
+        tmax = std::min(tmax, std::numeric_limits<T>::max());
+        uint32_t stack[stackDepth];
+        size_t top = 0;
+        stack[top++] = 0;
+        while(top > 0) {
+            const Node &node = _nodes[stack[--top]];
+            if(node.count == 0 || (node.depth > 0 && loose(node).intersect(ray, 0, tmax) > tmax)) {
+                continue;
+            }
+
+            for(uint32_t id = node.first; id != none; id = _objects[id].next) {
+                if(_objects[id].box.intersect(ray, 0, tmax) <= tmax) {
+                    tmax = f(id, tmax);
+                }
+            }
+            if(node.children != none) {
+                for(uint32_t c = 0; c < 8; c++) {
+                    stack[top++] = node.children + c;
+                }
+            }
+        }
+    };
+    std::vector<uint32_t> query(const Ray<T> &ray, T tmax = std::numeric_limits<T>::infinity()) const {
+        std::vector<uint32_t> found;
+        query(ray, tmax, [&](uint32_t id, T limit) {
+            found.push_back(id);
+            return limit;
+        });
+        return found;
+    };
+
+private:
+    struct Object {
+        AABB<T> box;
+        // `none` once erased.
+        uint32_t node;
+        uint32_t previous;
+        uint32_t next;
+    };
+
+    // Each level pushes at most eight children and pops their parent.
+    static const size_t stackDepth = 7 * BRADBURY_OCTREE_DEPTH + 8;
+
+    std::vector<Node> _nodes;
+    std::vector<uint32_t> _freeBlocks;
+    std::vector<Object> _objects;
+    std::vector<uint32_t> _free;
+
+    // The child of `node` whose loose bounds hold `box`, or `none`.
+    uint32_t octant(uint32_t node, const AABB<T> &box) const;
+    // The node at or below `node` where `box` belongs, splitting a full leaf
+    // on the way.
+    uint32_t descend(uint32_t node, const AABB<T> &box);
+    void split(uint32_t node);
+    uint32_t allocate(uint32_t parent);
+    void link(uint32_t id, uint32_t node);
+    void unlink(uint32_t id);
+    // Adds `delta` to the counts of `node` and its ancestors.
+    void adjust(uint32_t node, int delta);
+    // Pools the children of `node` and its ancestors whose subtrees emptied.
+    void prune(uint32_t node);
+    void check(uint32_t id) const;
+
+    // Visits nodes whose loose bounds overlap (the root always, for objects
+    // outside it), testing each object; below a node whose loose bounds
+    // are contained, reports objects untested.
+    template <class O, class C, class F>
+    void visit(O overlaps, C contains, F f) const {
+        // Each entry is a node and whether it lies wholly inside the query.
+        std::pair<uint32_t, bool> stack[stackDepth];
+        size_t top = 0;
+        stack[top++] = {0, false};
+        while(top > 0) {
+            auto [index, inside] = stack[--top];
+            const Node &node = _nodes[index];
+            if(node.count == 0) {
+                continue;
+            }
+            if(!inside && node.depth > 0) {
+                AABB<T> bounds = loose(node);
+                if(!overlaps(bounds)) {
+                    continue;
+                }
+                inside = contains(bounds);
+            }
+
+            for(uint32_t id = node.first; id != none; id = _objects[id].next) {
+                if(inside || overlaps(_objects[id].box)) {
+                    f(id);
+                }
+            }
+            if(node.children != none) {
+                for(uint32_t c = 0; c < 8; c++) {
+                    stack[top++] = {node.children + c, inside};
+                }
+            }
+        }
+    };
+};
+
+#endif // bradbury_loose_octree_h
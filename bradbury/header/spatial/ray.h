@@ -0,0 +1,56 @@
+//
+//  ray.h
+//  bradbury
+//
+//  A half-line through 3D space, for ray casts against bounding volume
+//  hierarchies and the geometry they hold.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_ray_h
+#define bradbury_ray_h
+
+#include <type_traits>
+
+#include "vector.h"
+
+// origin + t * direction for t >= 0. The direction need not be normalized;
+// distances along the ray are in multiples of its length. The reciprocal of
+// each direction component is kept for slab tests, with zero components
+// giving infinities.
+template<class T = double>
+class Ray {
+    static_assert(std::is_floating_point<T>::value, "rays hold floats or doubles");
+
+public:
+    typedef T scalar_type;
+
+    constexpr Ray(const Vector<3, T> &origin, const Vector<3, T> &direction)
+        : _origin(origin), _direction(direction), _inverse(1 / direction.x(), 1 / direction.y(), 1 / direction.z()) {};
+
+    // Access operators
+    constexpr const Vector<3, T> &origin() const {
+        return _origin;
+    };
+    constexpr const Vector<3, T> &direction() const {
+        return _direction;
+    };
+    // 1 / direction(), component by component.
+    constexpr const Vector<3, T> &inverse() const {
+        return _inverse;
+    };
+
+    // The point at distance t.
+    constexpr Vector<3, T> at(T t) const {
+        return Vector<3, T>(_origin + _direction * t);
+    };
+
+private:
+    Vector<3, T> _origin;
+    Vector<3, T> _direction;
+    Vector<3, T> _inverse;
+};
+
+#endif // bradbury_ray_h
@@ -0,0 +1,221 @@
+//
+//  ray_packet.h
+//  bradbury
+//
+//  Ray tests W at a time: one ray against W triangles or boxes, or W rays
+//  against one, for picking, visibility and lighting.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_ray_packet_h
+#define bradbury_ray_packet_h
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#include "aabb.h"
+#include "ray.h"
+#include "triangle.h"
+#include "vector.h"
+#include "vector_packet.h"
+
+// The tests themselves, over packets in which either side may be one item
+// repeated in every lane. Each is a loop over lanes of fixed length W, on
+// lane-contiguous components, which the compiler turns into vector
+// instructions. Results are as Triangle::intersect() and
+// AABB::intersect() give lane by lane: the distance of a hit, or infinity.
+namespace intersection {
+    template<size_t W, class T>
+    ScalarPacket<W, T> triangles(const VectorPacket<3, W, T> &origins, const VectorPacket<3, W, T> &directions,
+                                 const VectorPacket<3, W, T> &a, const VectorPacket<3, W, T> &edge1, const VectorPacket<3, W, T> &edge2,
+                                 const ScalarPacket<W, T> &tmin, const ScalarPacket<W, T> &tmax) {
+        const T *ox = origins.component(0), *oy = origins.component(1), *oz = origins.component(2);
+        const T *dx = directions.component(0), *dy = directions.component(1), *dz = directions.component(2);
+        const T *ax = a.component(0), *ay = a.component(1), *az = a.component(2);
+        const T *e1x = edge1.component(0), *e1y = edge1.component(1), *e1z = edge1.component(2);
+        const T *e2x = edge2.component(0), *e2y = edge2.component(1), *e2z = edge2.component(2);
+        ScalarPacket<W, T> result;
+        T *out = result.component(0);
+        // As Triangle::intersect(), in one pass over the lanes so that
+        // nothing round-trips through memory.
+        for(size_t l = 0; l < W; l++) {
+            T sx = ox[l] - ax[l], sy = oy[l] - ay[l], sz = oz[l] - az[l];
+            T px = dy[l] * e2z[l] - dz[l] * e2y[l];
+            T py = dz[l] * e2x[l] - dx[l] * e2z[l];
+            T pz = dx[l] * e2y[l] - dy[l] * e2x[l];
+            T qx = sy * e1z[l] - sz * e1y[l];
+            T qy = sz * e1x[l] - sx * e1z[l];
+            T qz = sx * e1y[l] - sy * e1x[l];
+            T determinant = e1x[l] * px + e1y[l] * py + e1z[l] * pz;
+            T inverse = 1 / determinant;
+            T u = (sx * px + sy * py + sz * pz) * inverse;
+            T v = (dx[l] * qx + dy[l] * qy + dz[l] * qz) * inverse;
+            T t = (e2x[l] * qx + e2y[l] * qy + e2z[l] * qz) * inverse;
+            // & rather than &&, so the lanes have no branches to diverge on.
+            bool hit = (determinant != 0) & (u >= 0) & (u <= 1) & (v >= 0) & (u + v <= 1) & (t >= tmin[l]) & (t <= tmax[l]);
+            out[l] = hit ? t : std::numeric_limits<T>::infinity();
+        }
+        return result;
+    }
+
+    template<size_t W, class T>
+    ScalarPacket<W, T> boxes(const VectorPacket<3, W, T> &origins, const VectorPacket<3, W, T> &inverses,
+                             const VectorPacket<3, W, T> &lower, const VectorPacket<3, W, T> &upper,
+                             const ScalarPacket<W, T> &tmin, const ScalarPacket<W, T> &tmax) {
+        ScalarPacket<W, T> result;
+        T *out = result.component(0);
+        T entry[W], exit[W];
+        for(size_t l = 0; l < W; l++) {
+            entry[l] = tmin[l];
+            exit[l] = tmax[l];
+        }
+        for(size_t c = 0; c < 3; c++) {
+            const T *o = origins.component(c), *inverse = inverses.component(c);
+            const T *lo = lower.component(c), *hi = upper.component(c);
+            for(size_t l = 0; l < W; l++) {
+                T a = (lo[l] - o[l]) * inverse[l];
+                T b = (hi[l] - o[l]) * inverse[l];
+                T near = inverse[l] < 0 ? b : a;
+                T far = inverse[l] < 0 ? a : b;
+                // Written so that NaN leaves the interval alone.
+                entry[l] = near > entry[l] ? near : entry[l];
+                exit[l] = far < exit[l] ? far : exit[l];
+            }
+        }
+        for(size_t l = 0; l < W; l++) {
+            out[l] = entry[l] <= exit[l] ? entry[l] : std::numeric_limits<T>::infinity();
+        }
+        return result;
+    }
+}
+
+// W rays side by side, for coherent rays (from one pixel block, or toward
+// one light) tested against the same primitives. Each lane has its own
+// [tmin, tmax]; a single T converts to a packet holding it in every lane.
+// Lanes past a partial load hold rays that miss everything.
+template<size_t W, class T = double>
+class RayPacket {
+    static_assert(std::is_floating_point<T>::value, "rays hold floats or doubles");
+
+public:
+    typedef T scalar_type;
+    static constexpr size_t width = W;
+
+    RayPacket() = default;
+    // The ray in every lane, for testing it against packets of primitives.
+    constexpr explicit RayPacket(const Ray<T> &ray)
+        : _origins(ray.origin()), _directions(ray.direction()), _inverses(ray.inverse()) {};
+
+    static RayPacket load(const Ray<T> *rays, size_t count = W) {
+        // Parked at infinity with no direction, which no slab or triangle
+        // test accepts.
+        RayPacket packet;
+        for(size_t l = 0; l < count && l < W; l++) {
+            packet._origins.setLane(l, rays[l].origin());
+            packet._directions.setLane(l, rays[l].direction());
+            packet._inverses.setLane(l, rays[l].inverse());
+        }
+        return packet;
+    };
+
+    Ray<T> lane(size_t l) const {
+        return Ray<T>(_origins.lane(l), _directions.lane(l));
+    };
+    const VectorPacket<3, W, T> &origins() const {
+        return _origins;
+    };
+    const VectorPacket<3, W, T> &directions() const {
+        return _directions;
+    };
+    const VectorPacket<3, W, T> &inverses() const {
+        return _inverses;
+    };
+
+    // Every ray against the triangle, or the box.
+    ScalarPacket<W, T> intersect(const Triangle<T> &triangle, const ScalarPacket<W, T> &tmin, const ScalarPacket<W, T> &tmax) const {
+        return intersection::triangles(_origins, _directions, VectorPacket<3, W, T>(triangle.a()),
+                                       VectorPacket<3, W, T>(triangle.edge1()), VectorPacket<3, W, T>(triangle.edge2()), tmin, tmax);
+    };
+    ScalarPacket<W, T> intersect(const AABB<T> &box, const ScalarPacket<W, T> &tmin, const ScalarPacket<W, T> &tmax) const {
+        return intersection::boxes(_origins, _inverses, VectorPacket<3, W, T>(box.lower()), VectorPacket<3, W, T>(box.upper()), tmin, tmax);
+    };
+
+private:
+    VectorPacket<3, W, T> _origins = VectorPacket<3, W, T>(std::numeric_limits<T>::infinity());
+    VectorPacket<3, W, T> _directions;
+    VectorPacket<3, W, T> _inverses = VectorPacket<3, W, T>(std::numeric_limits<T>::infinity());
+};
+
+// W triangles side by side, kept as a vertex and two edges, the form the
+// test wants. Lanes past a partial load hold degenerate triangles, which
+// every ray misses.
+template<size_t W, class T = double>
+class TrianglePacket {
+    static_assert(std::is_floating_point<T>::value, "triangles hold floats or doubles");
+
+public:
+    typedef T scalar_type;
+    static constexpr size_t width = W;
+
+    static TrianglePacket load(const Triangle<T> *triangles, size_t count = W) {
+        TrianglePacket packet;
+        for(size_t l = 0; l < count && l < W; l++) {
+            packet._a.setLane(l, triangles[l].a());
+            packet._edge1.setLane(l, triangles[l].edge1());
+            packet._edge2.setLane(l, triangles[l].edge2());
+        }
+        return packet;
+    };
+
+    // The ray against every triangle: Triangle::intersect() lane by lane.
+    // Casting one ray against many packets, broadcast it into a RayPacket
+    // once rather than on every call.
+    ScalarPacket<W, T> intersect(const RayPacket<W, T> &rays, const ScalarPacket<W, T> &tmin, const ScalarPacket<W, T> &tmax) const {
+        return intersection::triangles(rays.origins(), rays.directions(), _a, _edge1, _edge2, tmin, tmax);
+    };
+    ScalarPacket<W, T> intersect(const Ray<T> &ray, T tmin, T tmax) const {
+        return intersect(RayPacket<W, T>(ray), tmin, tmax);
+    };
+
+private:
+    VectorPacket<3, W, T> _a;
+    VectorPacket<3, W, T> _edge1;
+    VectorPacket<3, W, T> _edge2;
+};
+
+// W boxes side by side. Lanes past a partial load hold empty boxes, which
+// every ray misses.
+template<size_t W, class T = double>
+class BoxPacket {
+    static_assert(std::is_floating_point<T>::value, "boxes hold floats or doubles");
+
+public:
+    typedef T scalar_type;
+    static constexpr size_t width = W;
+
+    static BoxPacket load(const AABB<T> *boxes, size_t count = W) {
+        BoxPacket packet;
+        for(size_t l = 0; l < count && l < W; l++) {
+            packet._lower.setLane(l, boxes[l].lower());
+            packet._upper.setLane(l, boxes[l].upper());
+        }
+        return packet;
+    };
+
+    // The ray against every box: AABB::intersect() lane by lane.
+    ScalarPacket<W, T> intersect(const RayPacket<W, T> &rays, const ScalarPacket<W, T> &tmin, const ScalarPacket<W, T> &tmax) const {
+        return intersection::boxes(rays.origins(), rays.inverses(), _lower, _upper, tmin, tmax);
+    };
+    ScalarPacket<W, T> intersect(const Ray<T> &ray, T tmin, T tmax) const {
+        return intersect(RayPacket<W, T>(ray), tmin, tmax);
+    };
+
+private:
+    VectorPacket<3, W, T> _lower = VectorPacket<3, W, T>(std::numeric_limits<T>::infinity());
+    VectorPacket<3, W, T> _upper = VectorPacket<3, W, T>(-std::numeric_limits<T>::infinity());
+};
+
+#endif // bradbury_ray_packet_h
@@ -0,0 +1,93 @@
+//
+//  triangle.h
+//  bradbury
+//
+//  A triangle in 3D space, with the ray test for picking and ray tracing.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_triangle_h
+#define bradbury_triangle_h
+
+#include <limits>
+#include <type_traits>
+
+#include "aabb.h"
+#include "ray.h"
+#include "vector.h"
+
+// Three vertices. Like AABB, it is an immutable value.
+template<class T = double>
+class Triangle {
+    static_assert(std::is_floating_point<T>::value, "triangles hold floats or doubles");
+
+public:
+    typedef T scalar_type;
+
+    constexpr Triangle(const Vector<3, T> &a, const Vector<3, T> &b, const Vector<3, T> &c) : _a(a), _b(b), _c(c) {};
+
+    // Access operators
+    constexpr const Vector<3, T> &a() const {
+        return _a;
+    };
+    constexpr const Vector<3, T> &b() const {
+        return _b;
+    };
+    constexpr const Vector<3, T> &c() const {
+        return _c;
+    };
+    // b - a and c - a.
+    constexpr Vector<3, T> edge1() const {
+        return Vector<3, T>(_b - _a);
+    };
+    constexpr Vector<3, T> edge2() const {
+        return Vector<3, T>(_c - _a);
+    };
+    // edge1 x edge2: facing the side from which a, b, c run counterclockwise,
+    // with twice the triangle's area as its length.
+    constexpr Vector<3, T> normal() const {
+        return edge1().cross(edge2());
+    };
+    constexpr AABB<T> bounds() const {
+        return AABB<T>::around(_a).merge(_b).merge(_c);
+    };
+
+    // The distance along the ray at which it hits the triangle, if that is in
+    // [tmin, tmax]; infinity if it misses. Edges count as hits, from either
+    // side; rays in the triangle's plane miss. This is the Moller-Trumbore
+    // test, which solves for the distance and two barycentric coordinates
+    // directly, with one division.
+    constexpr T intersect(const Ray<T> &ray, T tmin, T tmax) const {
+        const T infinity = std::numeric_limits<T>::infinity();
+        Vector<3, T> e1 = edge1(), e2 = edge2();
+        Vector<3, T> offset(ray.origin() - _a);
+
+        Vector<3, T> p = ray.direction().cross(e2);
+        T determinant = e1.dot(p);
+        if(determinant == 0) {
+            return infinity;
+        }
+        T inverse = 1 / determinant;
+
+        T u = offset.dot(p) * inverse;
+        if(!(u >= 0 && u <= 1)) {
+            return infinity;
+        }
+        Vector<3, T> q = offset.cross(e1);
+        T v = ray.direction().dot(q) * inverse;
+        if(!(v >= 0 && u + v <= 1)) {
+            return infinity;
+        }
+        T t = e2.dot(q) * inverse;
+        return t >= tmin && t <= tmax ? t : infinity;
+    };
+
+private:
+    Vector<3, T> _a;
+    Vector<3, T> _b;
+    Vector<3, T> _c;
+};
+
+#endif // bradbury_triangle_h
@@ -9,4 +9,23 @@
 #define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
 #include "lib/Catch.hpp"
 
-#include "tests/vector_test.cpp"
\ No newline at end of file
+#include "tests/vector_test.cpp"
+#include "tests/vector_constexpr_test.cpp"
+#include "tests/mutable_vector_test.cpp"
+#include "tests/vector_array_test.cpp"
+#include "tests/vector_packet_test.cpp"
+#include "tests/dyn_vector_test.cpp"
+#include "tests/sparse_vector_test.cpp"
+#include "tests/matrix_test.cpp"
+#include "tests/quaternion_test.cpp"
+#include "tests/parallel_test.cpp"
+#include "tests/transform_test.cpp"
+#include "tests/reduce_test.cpp"
+#include "tests/simd_test.cpp"
+#include "tests/half_test.cpp"
+#include "tests/bvh_test.cpp"
+#include "tests/kd_tree_test.cpp"
+#include "tests/hash_grid_test.cpp"
+#include "tests/loose_octree_test.cpp"
+#include "tests/ray_packet_test.cpp"
+#include "tests/benchmark_test.cpp"
\ No newline at end of file
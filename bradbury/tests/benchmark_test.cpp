@@ -0,0 +1,320 @@
+//
+//  benchmark_test.cpp
+//  bradbury
+//
+//  Timings rather than tests: hidden from the default run. Run them with
+//  `tests [benchmark]`, in a release build.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "aabb.h"
+#include "bvh.h"
+#include "hash_grid.h"
+#include "kd_tree.h"
+#include "loose_octree.h"
+#include "parallel.h"
+#include "ray.h"
+#include "ray_packet.h"
+#include "simd.h"
+#include "triangle.h"
+#include "vector.h"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace {
+    // Nanoseconds per call of f, over enough calls to take about 50 ms.
+    template<class F>
+    double timePerCall(F f) {
+        typedef std::chrono::steady_clock clock;
+        size_t calls = 1;
+        while(true) {
+            clock::time_point start = clock::now();
+            for(size_t i = 0; i < calls; i++) {
+                f();
+            }
+            double elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+            if(elapsed > 5e7) {
+                return elapsed / calls;
+            }
+            calls *= 2;
+        }
+    }
+    
+    // The loop a caller would write by hand: one accumulator, in order.
+    template<size_t D>
+    float naiveDot(const Vector<D, float> &a, const Vector<D, float> &b) {
+        float sum = 0;
+        for(size_t i = 0; i < D; i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+    template<size_t D>
+    float naiveSquaredDistance(const Vector<D, float> &a, const Vector<D, float> &b) {
+        float sum = 0;
+        for(size_t i = 0; i < D; i++) {
+            float d = a[i] - b[i];
+            sum += d * d;
+        }
+        return sum;
+    }
+    
+    template<size_t D>
+    void benchmarkReductions() {
+        std::vector<float> x(D), y(D);
+        for(size_t i = 0; i < D; i++) {
+            x[i] = float(rand() % 1000) / 1000;
+            y[i] = float(rand() % 1000) / 1000;
+        }
+        Vector<D, float> a = x, b = y;
+        
+        // Results go through a volatile so the calls are not optimized away.
+        volatile float sink = 0;
+        double dot = timePerCall([&] { sink = a.dot(b); });
+        double naive = timePerCall([&] { sink = naiveDot(a, b); });
+        double distance = timePerCall([&] { sink = a.squareddistance(b); });
+        double naiveDistance = timePerCall([&] { sink = naiveSquaredDistance(a, b); });
+        double norm = timePerCall([&] { sink = a.magnitude(); });
+        
+        // The same storage summed in double, and all-double for comparison.
+        Vector<D, mixed> ma = a, mb = b;
+        Vector<D, double> da = a, db = b;
+        volatile double wideSink = 0;
+        double mixedDot = timePerCall([&] { wideSink = ma.dot(mb); });
+        double doubleDot = timePerCall([&] { wideSink = da.dot(db); });
+        
+        std::cout << "D = " << D << " (" << simd::name(simd::detected()) << "): "
+                  << "dot " << dot << " ns (naive " << naive << "), "
+                  << "squared distance " << distance << " ns (naive " << naiveDistance << "), "
+                  << "magnitude " << norm << " ns, "
+                  << "mixed dot " << mixedDot << " ns (double " << doubleDot << ")" << std::endl;
+        
+        float kernel = a.dot(b);
+        float reference = naiveDot(a, b);
+        REQUIRE(kernel == Approx(reference).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("high-dimension reductions against naive loops", "[.][benchmark]") {
+    benchmarkReductions<128>();
+    benchmarkReductions<768>();
+    benchmarkReductions<4096>();
+}
+
+TEST_CASE("hierarchy build and queries against a linear scan", "[.][benchmark]") {
+    std::vector<AABB<float>> boxes;
+    for(int i = 0; i < 100000; i++) {
+        Vector<3, float> center(float(rand() % 10000), float(rand() % 10000), float(rand() % 10000));
+        Vector<3, float> half(float(rand() % 20 + 1));
+        boxes.push_back(AABB<float>(center - half, center + half));
+    }
+    
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+    BVH<float> bvh(boxes);
+    double build = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    
+    AABB<float> region = AABB<float>::around(Vector<3, float>(5000.0f, 5000.0f, 5000.0f), 300.0f);
+    volatile size_t sink = 0;
+    double query = timePerCall([&] { sink = bvh.query(region).size(); });
+    double scan = timePerCall([&] {
+        size_t found = 0;
+        for(const AABB<float> &box : boxes) {
+            found += box.overlaps(region);
+        }
+        sink = found;
+    });
+    
+    Ray<float> ray(Vector<3, float>(0.0f, 0.0f, 0.0f), Vector<3, float>(1.0f, 1.02f, 0.98f));
+    double cast = timePerCall([&] { sink = bvh.query(ray).size(); });
+    
+    std::cout << "BVH over " << boxes.size() << " boxes (" << parallel::threads() << " threads): "
+              << "build " << build << " ms, box query " << query << " ns (scan " << scan << "), "
+              << "ray query " << cast << " ns" << std::endl;
+    
+    REQUIRE(bvh.size() == boxes.size());
+}
+
+TEST_CASE("batched nearest neighbours against all pairs", "[.][benchmark]") {
+    std::vector<Vector<3, float>> points, queries;
+    for(int i = 0; i < 100000; i++) {
+        points.push_back(Vector<3, float>(float(rand() % 10000), float(rand() % 10000), float(rand() % 10000)));
+    }
+    for(int i = 0; i < 2000; i++) {
+        queries.push_back(Vector<3, float>(float(rand() % 10000), float(rand() % 10000), float(rand() % 10000)));
+    }
+    
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+    KDTree<3, float> tree{std::span<const Vector<3, float>>(points)};
+    double build = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    
+    std::vector<KDTree<3, float>::Neighbor> found(queries.size());
+    start = clock::now();
+    tree.nearest(std::span<const Vector<3, float>>(queries), found);
+    double batched = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    
+    // The O(N * M) scan the tree replaces.
+    std::vector<float> scanned(queries.size());
+    start = clock::now();
+    for(size_t q = 0; q < queries.size(); q++) {
+        float best = std::numeric_limits<float>::infinity();
+        for(const Vector<3, float> &p : points) {
+            best = std::min(best, queries[q].squareddistance(p));
+        }
+        scanned[q] = std::sqrt(best);
+    }
+    double scan = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    
+    std::cout << "k-d tree over " << points.size() << " points (" << parallel::threads() << " threads): "
+              << "build " << build << " ms, " << queries.size() << " nearest " << batched << " ms (all pairs " << scan << ")" << std::endl;
+    
+    for(size_t q = 0; q < queries.size(); q++) {
+        REQUIRE(found[q].distance == scanned[q]);
+    }
+}
+
+TEST_CASE("broadphase frames with little and much movement", "[.][benchmark]") {
+    const size_t count = 20000;
+    std::vector<Vector<3, float>> positions(count), jittered(count), scattered(count);
+    for(size_t i = 0; i < count; i++) {
+        positions[i] = Vector<3, float>(float(rand() % 2000) / 10, float(rand() % 2000) / 10, float(rand() % 2000) / 10);
+        jittered[i] = positions[i] + Vector<3, float>(0.01f);
+        scattered[i] = Vector<3, float>(float(rand() % 2000) / 10, float(rand() % 2000) / 10, float(rand() % 2000) / 10);
+    }
+    HashGrid<3, float> grid(2.0f);
+    for(const Vector<3, float> &p : positions) {
+        grid.insert(p);
+    }
+    
+    // A frame: move every object, then gather the candidate pairs. Each call
+    // is two, there and back.
+    volatile size_t sink = 0;
+    auto frame = [&](const std::vector<Vector<3, float>> &a, const std::vector<Vector<3, float>> &b) {
+        return timePerCall([&] {
+            for(const std::vector<Vector<3, float>> *to : {&a, &b}) {
+                grid.move(std::span<const Vector<3, float>>(*to));
+                size_t found = 0;
+                grid.pairs([&](uint32_t, uint32_t) { found++; });
+                sink = found;
+            }
+        }) / 2;
+    };
+    double still = frame(positions, jittered);
+    double teleport = frame(positions, scattered);
+    
+    std::cout << "Hash grid over " << count << " objects: frame " << still << " ns jittering, "
+              << teleport << " ns with every object changing cell" << std::endl;
+    
+    REQUIRE(grid.size() == count);
+}
+
+TEST_CASE("octree updates against rebuilding a hierarchy", "[.][benchmark]") {
+    // Clustered: most boxes in a hundredth of the world's volume.
+    std::vector<AABB<float>> boxes, moved;
+    for(int i = 0; i < 100000; i++) {
+        float spread = i % 4 == 0 ? 10000.0f : 2000.0f;
+        Vector<3, float> center(float(rand() % 1000) / 1000 * spread, float(rand() % 1000) / 1000 * spread, float(rand() % 1000) / 1000 * spread);
+        Vector<3, float> half(float(rand() % 20 + 1));
+        boxes.push_back(AABB<float>(center - half, center + half));
+        Vector<3, float> step(float(rand() % 5) - 2);
+        moved.push_back(AABB<float>(boxes.back().lower() + step, boxes.back().upper() + step));
+    }
+    
+    LooseOctree<float> tree(AABB<float>(Vector<3, float>(0.0f), Vector<3, float>(10000.0f)));
+    for(const AABB<float> &box : boxes) {
+        tree.insert(box);
+    }
+    
+    // A frame of small moves, there and back per call.
+    double update = timePerCall([&] {
+        for(uint32_t i = 0; i < moved.size(); i++) {
+            tree.update(i, moved[i]);
+        }
+        for(uint32_t i = 0; i < boxes.size(); i++) {
+            tree.update(i, boxes[i]);
+        }
+    }) / 2;
+    double rebuild = timePerCall([&] { BVH<float> bvh(moved); });
+    
+    AABB<float> region = AABB<float>::around(Vector<3, float>(1000.0f, 1000.0f, 1000.0f), 100.0f);
+    volatile size_t sink = 0;
+    double query = timePerCall([&] { sink = tree.query(region).size(); });
+    
+    std::cout << "Loose octree over " << boxes.size() << " boxes: frame of updates " << update / 1e6 << " ms (BVH rebuild "
+              << rebuild / 1e6 << "), box query " << query << " ns, " << tree.nodes().size() << " nodes" << std::endl;
+    
+    REQUIRE(tree.size() == boxes.size());
+}
+
+TEST_CASE("packet ray tests against one at a time", "[.][benchmark]") {
+    std::vector<Triangle<float>> triangles;
+    std::vector<AABB<float>> boxes;
+    for(int i = 0; i < 1024; i++) {
+        Vector<3, float> a(float(rand() % 1000) / 100, float(rand() % 1000) / 100, float(rand() % 1000) / 100);
+        Vector<3, float> b(a.x() + 1, a.y(), a.z()), c(a.x(), a.y() + 1, a.z() + float(rand() % 10) / 10);
+        triangles.push_back(Triangle<float>(a, b, c));
+        boxes.push_back(triangles.back().bounds());
+    }
+    std::vector<TrianglePacket<8, float>> trianglePackets;
+    std::vector<BoxPacket<8, float>> boxPackets;
+    for(size_t i = 0; i < triangles.size(); i += 8) {
+        trianglePackets.push_back(TrianglePacket<8, float>::load(&triangles[i]));
+        boxPackets.push_back(BoxPacket<8, float>::load(&boxes[i]));
+    }
+    Ray<float> ray(Vector<3, float>(-1.0f, 5.0f, 5.0f), Vector<3, float>(1.0f, 0.01f, 0.02f));
+    RayPacket<8, float> broadcast(ray);
+    const float infinity = std::numeric_limits<float>::infinity();
+    volatile float sink = 0;
+
+    // The closest hit, as picking wants it.
+    double packets = timePerCall([&] {
+        float closest = infinity;
+        for(const TrianglePacket<8, float> &packet : trianglePackets) {
+            ScalarPacket<8, float> t = packet.intersect(broadcast, 0, closest);
+            for(size_t l = 0; l < 8; l++) {
+                closest = t[l] < closest ? t[l] : closest;
+            }
+        }
+        sink = closest;
+    });
+    double scalar = timePerCall([&] {
+        float closest = infinity;
+        for(const Triangle<float> &triangle : triangles) {
+            float t = triangle.intersect(ray, 0, closest);
+            closest = t < closest ? t : closest;
+        }
+        sink = closest;
+    });
+
+    double boxPacketTime = timePerCall([&] {
+        float closest = infinity;
+        for(const BoxPacket<8, float> &packet : boxPackets) {
+            ScalarPacket<8, float> t = packet.intersect(broadcast, 0, closest);
+            for(size_t l = 0; l < 8; l++) {
+                closest = t[l] < closest ? t[l] : closest;
+            }
+        }
+        sink = closest;
+    });
+    double boxScalar = timePerCall([&] {
+        float closest = infinity;
+        for(const AABB<float> &box : boxes) {
+            float t = box.intersect(ray, 0, closest);
+            closest = t < closest ? t : closest;
+        }
+        sink = closest;
+    });
+
+    std::cout << "One ray against " << triangles.size() << " triangles: packets of 8 " << packets / 1e3 << " us, one at a time "
+              << scalar / 1e3 << " us; boxes: packets of 8 " << boxPacketTime / 1e3
+              << " us, one at a time " << boxScalar / 1e3 << " us" << std::endl;
+
+    REQUIRE(sink < infinity);
+}
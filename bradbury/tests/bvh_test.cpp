@@ -0,0 +1,204 @@
+//
+//  bvh_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "aabb.h"
+#include "bvh.h"
+#include "fixtures.h"
+#include "parallel.h"
+#include "ray.h"
+#include "vector.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("boxes bound points and stop rays", "[aabb]") {
+    AABB<> box(Vector<3>(0, 0, 0), Vector<3>(2, 4, 6));
+    const double infinity = std::numeric_limits<double>::infinity();
+    
+    SECTION("construction") {
+        REQUIRE(AABB<>().empty());
+        REQUIRE(AABB<>().surfacearea() == 0);
+        REQUIRE_FALSE(box.empty());
+        REQUIRE(box.center() == Vector<3>(1, 2, 3));
+        REQUIRE(box.extent() == Vector<3>(2, 4, 6));
+        REQUIRE(box.surfacearea() == 2 * (8 + 24 + 12));
+        
+        std::vector<Vector<3>> points = {Vector<3>(1, -1, 0), Vector<3>(-2, 3, 5)};
+        AABB<> around = AABB<>::around(std::span<const Vector<3>>(points));
+        REQUIRE(around == AABB<>(Vector<3>(-2, -1, 0), Vector<3>(1, 3, 5)));
+        REQUIRE(AABB<>::around(std::span<const Vector<3>>()).empty());
+        REQUIRE(AABB<>().merge(box) == box);
+        REQUIRE(AABB<>::around(Vector<3>(1, 1, 1), 1) == AABB<>(Vector<3>(0, 0, 0), Vector<3>(2, 2, 2)));
+    }
+    
+    SECTION("containment and overlap") {
+        REQUIRE(box.contains(Vector<3>(2, 0, 3)));
+        REQUIRE_FALSE(box.contains(Vector<3>(2.1, 0.0, 3.0)));
+        REQUIRE(box.contains(AABB<>(Vector<3>(1, 1, 1), Vector<3>(2, 2, 2))));
+        REQUIRE(box.overlaps(AABB<>(Vector<3>(2, 4, 6), Vector<3>(3, 5, 7))));
+        REQUIRE_FALSE(box.overlaps(AABB<>(Vector<3>(2.5, 0.0, 0.0), Vector<3>(3, 5, 7))));
+        REQUIRE_FALSE(box.overlaps(AABB<>()));
+        
+        REQUIRE(box.squareddistance(Vector<3>(1, 1, 1)) == 0);
+        REQUIRE(box.squareddistance(Vector<3>(5, 8, 6)) == 25);
+        REQUIRE(box.overlaps(Vector<3>(5, 8, 6), 5));
+        REQUIRE_FALSE(box.overlaps(Vector<3>(5, 8, 6), 4.9));
+    }
+    
+    SECTION("slab test") {
+        Ray<> along(Vector<3>(-1, 1, 1), Vector<3>(1, 0, 0));
+        REQUIRE(box.intersect(along, 0, infinity) == 1);
+        REQUIRE(box.intersect(along, 0, 0.5) == infinity);
+        
+        Ray<> inside(Vector<3>(1, 1, 1), Vector<3>(0, 0, -1));
+        REQUIRE(box.intersect(inside, 0, infinity) == 0);
+        
+        Ray<> away(Vector<3>(-1, 1, 1), Vector<3>(-1, 0, 0));
+        REQUIRE(box.intersect(away, 0, infinity) == infinity);
+        
+        // Grazing the box's face, and parallel to it but outside.
+        Ray<> grazing(Vector<3>(-1, 0, 1), Vector<3>(1, 0, 0));
+        Ray<> parallel(Vector<3>(-1, -1, 1), Vector<3>(1, 0, 0));
+        REQUIRE(box.intersect(grazing, 0, infinity) == 1);
+        REQUIRE(box.intersect(parallel, 0, infinity) == infinity);
+        REQUIRE(AABB<>().intersect(along, 0, infinity) == infinity);
+    }
+}
+
+// Scattered boxes plus a pile at one spot, so that some nodes cannot be
+// split and must become oversized leaves.
+TEST_CASE("bounding volume hierarchies answer queries like a linear scan", "[bvh][parallel]") {
+    DefaultThreads restore;
+    
+    std::vector<AABB<>> boxes;
+    for(int i = 0; i < 3000; i++) {
+        boxes.push_back(sample::box(0.0, 100.0, 2.0));
+    }
+    // Coincident boxes, which share one centroid.
+    for(int i = 0; i < 50; i++) {
+        boxes.push_back(AABB<>::around(Vector<3>(50, 50, 50), 1));
+    }
+    BVH<> bvh(boxes);
+    
+    SECTION("structure") {
+        REQUIRE(bvh.size() == boxes.size());
+        REQUIRE(bvh.nodes().size() < 2 * boxes.size());
+        REQUIRE(bvh.bounds().contains(AABB<>::around(Vector<3>(50, 50, 50), 1)));
+        
+        std::vector<uint32_t> order(bvh.indices().begin(), bvh.indices().end());
+        std::sort(order.begin(), order.end());
+        for(size_t i = 0; i < order.size(); i++) {
+            REQUIRE(order[i] == i);
+        }
+        
+        for(const BVH<>::Node &node : bvh.nodes()) {
+            if(node.count == 0) {
+                REQUIRE(node.bounds.contains(bvh.nodes()[node.start].bounds));
+                REQUIRE(node.bounds.contains(bvh.nodes()[node.start + 1].bounds));
+            } else {
+                REQUIRE(node.count <= 50);
+            }
+        }
+    }
+    
+    SECTION("the same tree on any number of threads") {
+        // Enough boxes that the top levels are binned in parallel chunks.
+        std::vector<AABB<>> many;
+        for(int i = 0; i < 40000; i++) {
+            many.push_back(sample::box(0.0, 1000.0, 2.0));
+        }
+        parallel::setThreads(1);
+        BVH<> reference(many);
+        
+        for(size_t threads : {2, 3, 4}) {
+            parallel::setThreads(threads);
+            BVH<> rebuilt(many);
+            REQUIRE(rebuilt.nodes().size() == reference.nodes().size());
+            bool sameIndices = std::equal(reference.indices().begin(), reference.indices().end(), rebuilt.indices().begin());
+            bool sameNodes = std::equal(reference.nodes().begin(), reference.nodes().end(), rebuilt.nodes().begin(), [](const BVH<>::Node &a, const BVH<>::Node &b) {
+                return a.bounds == b.bounds && a.start == b.start && a.count == b.count;
+            });
+            REQUIRE(sameIndices);
+            REQUIRE(sameNodes);
+        }
+    }
+    
+    SECTION("box and sphere queries") {
+        for(int q = 0; q < 50; q++) {
+            Vector<3> center = sample::point<3>(0.0, 100.0);
+            AABB<> region = AABB<>::around(center, 8);
+            
+            std::vector<size_t> expectedBox = scan::matching(boxes.size(), [&](size_t i) { return boxes[i].overlaps(region); });
+            std::vector<size_t> expectedSphere = scan::matching(boxes.size(), [&](size_t i) { return boxes[i].overlaps(center, 8); });
+            REQUIRE(scan::sorted(bvh.query(region)) == expectedBox);
+            REQUIRE(scan::sorted(bvh.query(center, 8.0)) == expectedSphere);
+        }
+    }
+    
+    SECTION("ray queries") {
+        for(int q = 0; q < 50; q++) {
+            Vector<3> origin(rand() % 1000 / 10.0, rand() % 1000 / 10.0, -10.0);
+            Vector<3> direction(rand() % 200 / 100.0 - 1, rand() % 200 / 100.0 - 1, 1.0);
+            Ray<> ray(origin, direction);
+            
+            const double infinity = std::numeric_limits<double>::infinity();
+            std::vector<size_t> expected = scan::matching(boxes.size(), [&](size_t i) { return boxes[i].intersect(ray, 0, infinity) < infinity; });
+            size_t nearest = BVH<>::none;
+            double nearestDistance = infinity;
+            for(size_t i : expected) {
+                double d = boxes[i].intersect(ray, 0, infinity);
+                if(d < nearestDistance) {
+                    nearest = i;
+                    nearestDistance = d;
+                }
+            }
+            REQUIRE(scan::sorted(bvh.query(ray)) == expected);
+            
+            BVH<>::Hit hit = bvh.closest(ray, [&](size_t i) {
+                return boxes[i].intersect(ray, 0, infinity);
+            });
+            REQUIRE(bool(hit) == (nearest != BVH<>::none));
+            REQUIRE(hit.distance == nearestDistance);
+        }
+    }
+    
+    SECTION("no boxes") {
+        BVH<> empty(std::span<const AABB<>>{});
+        REQUIRE(empty.query(AABB<>::around(Vector<3>(0, 0, 0), 1)).empty());
+        REQUIRE(empty.query(Ray<>(Vector<3>(0, 0, 0), Vector<3>(1, 0, 0))).empty());
+        REQUIRE(empty.bounds().empty());
+    }
+    
+    SECTION("boxes without a centroid") {
+        std::vector<AABB<>> bad = {boxes[0], AABB<>()};
+        REQUIRE_THROWS_AS(BVH<>(std::span<const AABB<>>(bad)), std::invalid_argument);
+        bad[1] = AABB<>(Vector<3>(0.0), Vector<3>(std::nan(""), 1.0, 1.0));
+        REQUIRE_THROWS_AS(BVH<>(std::span<const AABB<>>(bad)), std::invalid_argument);
+    }
+    
+    SECTION("centroids too close to bin") {
+        // Denormal steps along x, so that bins / extent overflows a float.
+        std::vector<AABB<float>> close;
+        for(int i = 0; i < 12; i++) {
+            float x = i * std::numeric_limits<float>::denorm_min();
+            close.push_back(AABB<float>(Vector<3, float>(x, 0.0f, 0.0f), Vector<3, float>(x, 1.0f, 1.0f)));
+        }
+        BVH<float> tight(close);
+        REQUIRE(tight.nodes().size() > 1);
+        std::vector<uint32_t> order(tight.indices().begin(), tight.indices().end());
+        std::sort(order.begin(), order.end());
+        for(size_t i = 0; i < order.size(); i++) {
+            REQUIRE(order[i] == i);
+        }
+        REQUIRE(scan::sorted(tight.query(AABB<float>::around(Vector<3, float>(0.0f, 0.5f, 0.5f), 1.0f))) == scan::matching(close.size(), [](size_t) { return true; }));
+    }
+}
@@ -0,0 +1,121 @@
+//
+//  dyn_vector_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "dyn_vector.h"
+#include "fixtures.h"
+#include "vector.h"
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+TEST_CASE("runtime-sized vectors", "[dyn_vector]") {
+    DynVector<> a = {1, 2, 3};
+    DynVector<> b = {4, 5, 6};
+    
+    SECTION("construction") {
+        REQUIRE(a.dimension() == 3);
+        REQUIRE(a[2] == 3);
+        REQUIRE(DynVector<>().dimension() == 0);
+        
+        DynVector<> filled(5, 2);
+        REQUIRE(filled.dimension() == 5);
+        REQUIRE(filled[4] == 2);
+        
+        DynVector<> fromList(std::vector<int>{1, 2, 3});
+        REQUIRE(fromList == a);
+        REQUIRE(a != b);
+        REQUIRE(a != DynVector<>({1, 2}));
+    }
+    
+    SECTION("Vector conversions") {
+        DynVector<> fromVector = Vector<3>(1, 2, 3);
+        REQUIRE(fromVector == a);
+        
+        Vector<3> back = static_cast<Vector<3>>(b);
+        REQUIRE(back == Vector<3>(4, 5, 6));
+        
+        REQUIRE_THROWS_AS(static_cast<Vector<4>>(a), std::length_error);
+    }
+    
+    SECTION("arithmetic matches Vector") {
+        Vector<3> va(1, 2, 3), vb(4, 5, 6);
+        
+        REQUIRE(static_cast<Vector<3>>(a + b) == va + vb);
+        REQUIRE(static_cast<Vector<3>>(a - b) == va - vb);
+        REQUIRE(static_cast<Vector<3>>(-a) == -va);
+        REQUIRE(static_cast<Vector<3>>(a * 2) == va * 2);
+        REQUIRE(static_cast<Vector<3>>(2 * a) == va * 2);
+        REQUIRE(static_cast<Vector<3>>(a / 2) == va / 2);
+        REQUIRE(static_cast<Vector<3>>(a.cross(b)) == va.cross(vb));
+        REQUIRE(static_cast<Vector<3>>(a.lerp(b, 0.5)) == Vector<3>(2.5, 3.5, 4.5));
+        
+        double product = a * b;
+        REQUIRE(product == 32);
+        REQUIRE(a.squaredmagnitude() == 14);
+        REQUIRE(a.magnitude() == Approx(std::sqrt(14)));
+        REQUIRE(a.squareddistance(b) == 27);
+        REQUIRE(a.distance(b) == Approx(std::sqrt(27)));
+        REQUIRE(a.normalize().magnitude() == Approx(1));
+        REQUIRE(a.fastnormalize().magnitude() == Approx(1));
+        REQUIRE(DynVector<>(3).normalize() == DynVector<>(3));
+        REQUIRE(b.mincomponent() == 4);
+        REQUIRE(b.maxcomponent() == 6);
+    }
+    
+    SECTION("mismatched dimensions") {
+        DynVector<> c = {1, 2};
+        REQUIRE_THROWS_AS(a + c, std::length_error);
+        REQUIRE_THROWS_AS(a.dot(c), std::length_error);
+        REQUIRE_THROWS_AS(c.cross(c), std::length_error);
+        REQUIRE_THROWS_AS(DynVector<>().maxcomponent(), std::length_error);
+    }
+    
+    SECTION("short vectors allocate nothing") {
+        size_t before = allocationCount;
+        DynVector<float> small(DynVector<float>::inlineCapacity, 1.5);
+        DynVector<float> sum = small + small * 2;
+        DynVector<float> moved = std::move(sum);
+        float length = moved.magnitude();
+        size_t after = allocationCount;
+        
+        REQUIRE(after == before);
+        REQUIRE(moved.inlined());
+        REQUIRE(length == Approx(4.5 * std::sqrt(8)));
+    }
+    
+    SECTION("long vectors") {
+        std::vector<double> values(1000);
+        for(size_t i = 0; i < values.size(); i++) {
+            values[i] = i % 7;
+        }
+        DynVector<> longer(values);
+        REQUIRE_FALSE(longer.inlined());
+        
+        DynVector<> copy = longer;
+        DynVector<> moved = std::move(copy);
+        REQUIRE(copy.dimension() == 0);
+        REQUIRE(moved == longer);
+        REQUIRE(moved.data() != longer.data());
+        // So that std::vector<DynVector> moves rather than copies on growth.
+        REQUIRE(std::is_nothrow_move_constructible<DynVector<>>::value);
+        REQUIRE(std::is_nothrow_move_assignable<DynVector<>>::value);
+        
+        double expected = 0;
+        for(double v : values) {
+            expected += v * v;
+        }
+        REQUIRE(longer.squaredmagnitude() == Approx(expected));
+        REQUIRE((longer - moved).squaredmagnitude() == 0);
+        
+        moved = a;
+        REQUIRE(moved == a);
+        REQUIRE(moved.inlined());
+    }
+}
@@ -0,0 +1,185 @@
+//
+//  fixtures.h
+//  bradbury
+//
+//  Helpers shared between test files. Like the tests, this is compiled once,
+//  into the single translation unit tests.cpp builds.
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#ifndef bradbury_fixtures_h
+#define bradbury_fixtures_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "aabb.h"
+#include "parallel.h"
+#include "vector.h"
+
+// Every trip through the global allocator is counted, so tests can prove
+// that vector math stays off the heap. Every form of operator new and delete
+// is replaced, all through the same pair of functions, so whatever the
+// library allocates is freed by the allocator that made it.
+inline size_t allocationCount = 0;
+
+namespace counting {
+    // Null on failure. Kept out of line so the compiler never sees malloc
+    // and free on either side of a new/delete pair.
+    [[gnu::noinline]] void *allocate(size_t size, size_t alignment = alignof(std::max_align_t)) noexcept {
+        allocationCount++;
+        size = size ? size : 1;
+        if(alignment <= alignof(std::max_align_t)) {
+            return std::malloc(size);
+        }
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+    [[gnu::noinline]] void release(void *p) noexcept {
+        std::free(p);
+    }
+    inline void *allocateOrThrow(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        if(void *p = allocate(size, alignment)) {
+            return p;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+void *operator new(size_t size) {
+    return counting::allocateOrThrow(size);
+}
+void *operator new[](size_t size) {
+    return counting::allocateOrThrow(size);
+}
+void *operator new(size_t size, std::align_val_t alignment) {
+    return counting::allocateOrThrow(size, static_cast<size_t>(alignment));
+}
+void *operator new[](size_t size, std::align_val_t alignment) {
+    return counting::allocateOrThrow(size, static_cast<size_t>(alignment));
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return counting::allocate(size);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return counting::allocate(size);
+}
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return counting::allocate(size, static_cast<size_t>(alignment));
+}
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return counting::allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *p) noexcept {
+    counting::release(p);
+}
+void operator delete[](void *p) noexcept {
+    counting::release(p);
+}
+void operator delete(void *p, size_t) noexcept {
+    counting::release(p);
+}
+void operator delete[](void *p, size_t) noexcept {
+    counting::release(p);
+}
+void operator delete(void *p, std::align_val_t) noexcept {
+    counting::release(p);
+}
+void operator delete[](void *p, std::align_val_t) noexcept {
+    counting::release(p);
+}
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+    counting::release(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+    counting::release(p);
+}
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    counting::release(p);
+}
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    counting::release(p);
+}
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+    counting::release(p);
+}
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+    counting::release(p);
+}
+
+// The answers a query should give, found by testing everything: the indices
+// in [0, n), or the given ids, that `matches`, in ascending order.
+namespace scan {
+    template<class P>
+    std::vector<size_t> matching(size_t n, P matches) {
+        std::vector<size_t> found;
+        for(size_t i = 0; i < n; i++) {
+            if(matches(i)) {
+                found.push_back(i);
+            }
+        }
+        return found;
+    }
+
+    template<class I, class P>
+    std::vector<I> matching(const std::vector<I> &ids, P matches) {
+        std::vector<I> found;
+        for(I id : ids) {
+            if(matches(id)) {
+                found.push_back(id);
+            }
+        }
+        std::sort(found.begin(), found.end());
+        return found;
+    }
+
+    // A query's results in the same order, to compare with matching().
+    template<class I>
+    std::vector<I> sorted(std::vector<I> found) {
+        std::sort(found.begin(), found.end());
+        return found;
+    }
+}
+
+// Random inputs for the spatial structures, from rand(), so that a failure
+// reproduces from run to run.
+namespace sample {
+    // A point with every component uniform in [lower, upper).
+    template<size_t D, class T>
+    Vector<D, T> point(T lower, T upper) {
+        std::vector<T> components(D);
+        for(size_t i = 0; i < D; i++) {
+            components[i] = lower + static_cast<T>(rand() / (RAND_MAX + 1.0)) * (upper - lower);
+        }
+        return Vector<D, T>(components);
+    }
+
+    // A box centred in [lower, upper)^3, reaching up to maxHalf from its
+    // centre along each axis.
+    template<class T>
+    AABB<T> box(T lower, T upper, T maxHalf) {
+        Vector<3, T> center = point<3>(lower, upper);
+        Vector<3, T> half = point<3>(T(0), maxHalf);
+        return AABB<T>(center - half, center + half);
+    }
+}
+
+// Puts parallel's default thread count back when it goes out of scope, so a
+// test that sets its own cannot leave it behind for the next, even when an
+// assertion ends the test early.
+class DefaultThreads {
+public:
+    DefaultThreads() = default;
+    DefaultThreads(const DefaultThreads &) = delete;
+    DefaultThreads &operator=(const DefaultThreads &) = delete;
+    ~DefaultThreads() {
+        parallel::setThreads(0);
+    };
+};
+
+#endif // bradbury_fixtures_h
@@ -0,0 +1,57 @@
+//
+//  half_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "half.h"
+#include <cmath>
+#include <limits>
+
+
+TEST_CASE("halves round trip through float", "[half]") {
+    SECTION("exact values") {
+        float values[] = {0, 1, -1, 0.5f, 1.5f, 2048, -65504, 0.099975586f};
+        for(float f : values) {
+            REQUIRE(float(half(f)) == f);
+        }
+    }
+    
+    SECTION("known encodings") {
+        REQUIRE(half(1).bits() == 0x3c00);
+        REQUIRE(half(-2).bits() == 0xc000);
+        REQUIRE(half(65504).bits() == 0x7bff);
+        REQUIRE(half(0.0f).bits() == 0x0000);
+        REQUIRE(half(-0.0f).bits() == 0x8000);
+        REQUIRE(float(half::fromBits(0x0001)) == std::ldexp(1.0f, -24));
+        REQUIRE(float(half::fromBits(0x03ff)) == std::ldexp(1023.0f, -24));
+    }
+    
+    SECTION("rounding") {
+        // 1 + 2^-11 is halfway between 1 and the next half; ties go to even.
+        REQUIRE(half(1 + std::ldexp(1.0f, -11)).bits() == 0x3c00);
+        REQUIRE(half(1 + 3 * std::ldexp(1.0f, -11)).bits() == 0x3c02);
+        REQUIRE(half(1 + std::ldexp(1.0f, -10) * 0.75f).bits() == 0x3c01);
+        
+        // Rounding up out of the subnormals lands on the smallest normal.
+        REQUIRE(half(std::ldexp(1023.75f, -24)).bits() == 0x0400);
+    }
+    
+    SECTION("out of range") {
+        REQUIRE(half(70000).bits() == 0x7c00);
+        REQUIRE(half(-70000).bits() == 0xfc00);
+        REQUIRE(float(half(std::numeric_limits<float>::infinity())) == std::numeric_limits<float>::infinity());
+        REQUIRE(std::isnan(float(half(std::numeric_limits<float>::quiet_NaN()))));
+        REQUIRE(half(std::ldexp(1.0f, -30)).bits() == 0x0000);
+    }
+    
+    SECTION("relative error") {
+        for(int i = 0; i < 1000; i++) {
+            float f = (rand() % 2000000 - 1000000) / 100.0f;
+            float h = half(f);
+            REQUIRE(std::fabs(h - f) <= std::fabs(f) * std::ldexp(1.0f, -11));
+        }
+    }
+}
@@ -0,0 +1,143 @@
+//
+//  hash_grid_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "fixtures.h"
+#include "hash_grid.h"
+#include "vector.h"
+#include <algorithm>
+#include <cstdlib>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+    // Every pair in the same or adjacent cells, by checking all of them.
+    template<size_t D, class T>
+    std::vector<std::pair<uint32_t, uint32_t>> scanPairs(const HashGrid<D, T> &grid, const std::vector<uint32_t> &ids) {
+        std::vector<std::pair<uint32_t, uint32_t>> found;
+        for(size_t i = 0; i < ids.size(); i++) {
+            for(size_t j = i + 1; j < ids.size(); j++) {
+                typename HashGrid<D, T>::Key a = grid.key(grid.position(ids[i])), b = grid.key(grid.position(ids[j]));
+                bool adjacent = true;
+                for(size_t k = 0; k < D; k++) {
+                    adjacent = adjacent && std::abs(a[k] - b[k]) <= 1;
+                }
+                if(adjacent) {
+                    found.push_back(std::minmax(ids[i], ids[j]));
+                }
+            }
+        }
+        std::sort(found.begin(), found.end());
+        return found;
+    }
+
+    template<size_t D, class T>
+    std::vector<std::pair<uint32_t, uint32_t>> sortedPairs(const HashGrid<D, T> &grid) {
+        std::vector<std::pair<uint32_t, uint32_t>> found = grid.pairs();
+        std::sort(found.begin(), found.end());
+        return found;
+    }
+}
+
+// Candidates are checked against every pair of objects.
+TEST_CASE("hash grids find the pairs in adjacent cells", "[hashgrid]") {
+    HashGrid<3> grid(2.0);
+    std::vector<uint32_t> ids;
+    for(int i = 0; i < 1500; i++) {
+        ids.push_back(grid.insert(sample::point<3>(-30.0, 30.0)));
+    }
+
+    SECTION("pairs") {
+        REQUIRE(grid.size() == 1500);
+        HashGrid<3>::Key expected = {-1, 0, 1};
+        REQUIRE(grid.key(Vector<3>(-0.5, 0.0, 3.9)) == expected);
+
+        std::vector<std::pair<uint32_t, uint32_t>> found = sortedPairs(grid);
+        REQUIRE(std::adjacent_find(found.begin(), found.end()) == found.end());
+        REQUIRE(found == scanPairs(grid, ids));
+    }
+
+    SECTION("incremental moves") {
+        // A few frames of small steps, some across cells, and some jumps.
+        for(int frame = 0; frame < 5; frame++) {
+            for(size_t i = 0; i < ids.size(); i += 3) {
+                Vector<3> step(rand() % 11 / 10.0 - 0.5, rand() % 11 / 10.0 - 0.5, rand() % 11 / 10.0 - 0.5);
+                grid.move(ids[i], grid.position(ids[i]) + step);
+            }
+            grid.move(ids[frame], sample::point<3>(-30.0, 30.0));
+        }
+        REQUIRE(sortedPairs(grid) == scanPairs(grid, ids));
+
+        // The same positions inserted afresh give the same pairs.
+        std::vector<Vector<3>> positions;
+        for(uint32_t id : ids) {
+            positions.push_back(grid.position(id));
+        }
+        HashGrid<3> fresh(2.0);
+        for(const Vector<3> &p : positions) {
+            fresh.insert(p);
+        }
+        REQUIRE(sortedPairs(fresh) == sortedPairs(grid));
+
+        // Moving everything at once, as a frame update would.
+        for(Vector<3> &p : positions) {
+            p = sample::point<3>(-30.0, 30.0);
+        }
+        grid.move(std::span<const Vector<3>>(positions));
+        REQUIRE(grid.position(ids[7]) == positions[7]);
+        REQUIRE(sortedPairs(grid) == scanPairs(grid, ids));
+    }
+
+    SECTION("erasing") {
+        for(size_t i = 0; i < 500; i++) {
+            grid.erase(ids[i]);
+        }
+        REQUIRE(grid.size() == 1000);
+        REQUIRE_THROWS_AS(grid.position(ids[0]), std::out_of_range);
+        REQUIRE_THROWS_AS(grid.move(ids[0], Vector<3>(0, 0, 0)), std::out_of_range);
+        REQUIRE_THROWS_AS(grid.erase(5000), std::out_of_range);
+
+        std::vector<uint32_t> live(ids.begin() + 500, ids.end());
+        REQUIRE(sortedPairs(grid) == scanPairs(grid, live));
+
+        // Erased ids are reused.
+        uint32_t id = grid.insert(Vector<3>(0, 0, 0));
+        REQUIRE(id < 500);
+        REQUIRE(grid.size() == 1001);
+    }
+
+    SECTION("point queries") {
+        Vector<3> point(1, 1, 1);
+        std::vector<uint32_t> found = grid.query(point);
+        std::sort(found.begin(), found.end());
+        for(uint32_t id : ids) {
+            Vector<3> offset = grid.position(id) - point;
+            bool near = std::abs(offset.x()) < 2 && std::abs(offset.y()) < 2 && std::abs(offset.z()) < 2;
+            if(near) {
+                REQUIRE(std::binary_search(found.begin(), found.end(), id));
+            }
+        }
+    }
+
+    REQUIRE_THROWS_AS(HashGrid<3>(0.0), std::invalid_argument);
+}
+
+TEST_CASE("hash grids in the plane", "[hashgrid]") {
+    HashGrid<2, float> grid(1.0f);
+    std::vector<uint32_t> ids;
+    for(int i = 0; i < 800; i++) {
+        ids.push_back(grid.insert(sample::point<2>(-20.0f, 20.0f)));
+    }
+    REQUIRE(sortedPairs(grid) == scanPairs(grid, ids));
+
+    for(uint32_t id : ids) {
+        grid.move(id, grid.position(id) + Vector<2, float>(0.7f, -0.3f));
+    }
+    REQUIRE(sortedPairs(grid) == scanPairs(grid, ids));
+}
@@ -0,0 +1,172 @@
+//
+//  kd_tree_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "fixtures.h"
+#include "kd_tree.h"
+#include "parallel.h"
+#include "vector.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    // Every point's distance to `query`, nearest first, as a linear scan
+    // would find them.
+    template<size_t D, class T>
+    std::vector<T> scanDistances(const std::vector<Vector<D, T>> &points, const Vector<D, T> &query) {
+        std::vector<T> distances;
+        for(const Vector<D, T> &p : points) {
+            distances.push_back(std::sqrt(query.squareddistance(p)));
+        }
+        std::sort(distances.begin(), distances.end());
+        return distances;
+    }
+}
+
+// Distances are compared exactly, so any difference means a point was missed.
+TEST_CASE("k-d trees find neighbours like a linear scan", "[kdtree][parallel]") {
+    DefaultThreads restore;
+
+    std::vector<Vector<3>> points;
+    for(int i = 0; i < 2000; i++) {
+        points.push_back(sample::point<3>(0.0, 100.0));
+    }
+    // Twenty copies of one point, queried below, for ties at distance zero.
+    for(int i = 0; i < 20; i++) {
+        points.push_back(Vector<3>(50, 50, 50));
+    }
+    KDTree<3> tree{std::span<const Vector<3>>(points)};
+
+    std::vector<Vector<3>> queries;
+    for(int q = 0; q < 100; q++) {
+        queries.push_back(sample::point<3>(0.0, 100.0));
+    }
+    queries.push_back(Vector<3>(50, 50, 50));
+    std::span<const Vector<3>> batch(queries);
+
+    SECTION("structure") {
+        REQUIRE(tree.size() == points.size());
+        for(size_t k = 0; k < tree.size(); k++) {
+            REQUIRE(tree.points()[k] == points[tree.indices()[k]]);
+        }
+
+        std::vector<uint32_t> order(tree.indices().begin(), tree.indices().end());
+        std::sort(order.begin(), order.end());
+        for(size_t i = 0; i < order.size(); i++) {
+            REQUIRE(order[i] == i);
+        }
+
+        for(const KDTree<3>::Node &node : tree.nodes()) {
+            REQUIRE(node.count <= BRADBURY_KDTREE_LEAF);
+        }
+    }
+
+    SECTION("nearest") {
+        for(const Vector<3> &query : queries) {
+            std::vector<double> expected = scanDistances(points, query);
+            KDTree<3>::Neighbor nearest = tree.nearest(query);
+            REQUIRE(bool(nearest));
+            REQUIRE(nearest.distance == expected[0]);
+            REQUIRE(query.distance(points[nearest.index]) == expected[0]);
+
+            KDTree<3>::Neighbor bounded = tree.nearest(query, expected[0] / 2);
+            REQUIRE(bool(bounded) == (expected[0] == 0));
+        }
+    }
+
+    SECTION("k nearest") {
+        for(const Vector<3> &query : queries) {
+            std::vector<double> expected = scanDistances(points, query);
+            std::vector<KDTree<3>::Neighbor> found = tree.knearest(query, 25);
+            REQUIRE(found.size() == 25);
+            for(size_t i = 0; i < found.size(); i++) {
+                REQUIRE(found[i].distance == expected[i]);
+                REQUIRE(query.distance(points[found[i].index]) == expected[i]);
+            }
+
+            size_t inside = std::upper_bound(expected.begin(), expected.end(), 5.0) - expected.begin();
+            std::vector<KDTree<3>::Neighbor> limited = tree.knearest(query, 25, 5.0);
+            REQUIRE(limited.size() == std::min(inside, size_t(25)));
+        }
+        REQUIRE(tree.knearest(queries[0], 0).empty());
+        REQUIRE(tree.knearest(queries[0], 5000).size() == points.size());
+    }
+
+    SECTION("within a radius") {
+        for(const Vector<3> &query : queries) {
+            std::vector<size_t> expected = scan::matching(points.size(), [&](size_t i) { return query.distance(points[i]) <= 10; });
+            std::vector<size_t> found;
+            for(const KDTree<3>::Neighbor &n : tree.within(query, 10.0)) {
+                found.push_back(n.index);
+            }
+            REQUIRE(scan::sorted(found) == expected);
+        }
+    }
+
+    SECTION("batches on any number of threads") {
+        for(size_t threads : {1, 3}) {
+            parallel::setThreads(threads);
+            KDTree<3> rebuilt{std::span<const Vector<3>>(points)};
+            bool same = std::equal(tree.indices().begin(), tree.indices().end(), rebuilt.indices().begin());
+            REQUIRE(same);
+
+            std::vector<KDTree<3>::Neighbor> nearest(queries.size());
+            tree.nearest(batch, nearest);
+            std::vector<KDTree<3>::Neighbor> knearest(queries.size() * 3);
+            tree.knearest(batch, 3, knearest);
+            std::vector<std::vector<KDTree<3>::Neighbor>> within = tree.within(batch, 10.0);
+            for(size_t q = 0; q < queries.size(); q++) {
+                REQUIRE(nearest[q].distance == tree.nearest(queries[q]).distance);
+                std::vector<KDTree<3>::Neighbor> single = tree.knearest(queries[q], 3);
+                for(size_t i = 0; i < 3; i++) {
+                    REQUIRE(knearest[q * 3 + i].distance == single[i].distance);
+                }
+                REQUIRE(within[q].size() == tree.within(queries[q], 10.0).size());
+            }
+        }
+
+        // Only the repeated points are within 1 of (50, 50, 50).
+        std::vector<Vector<3>> far = {Vector<3>(500, 500, 500), Vector<3>(50, 50, 50)};
+        std::vector<KDTree<3>::Neighbor> padded(far.size() * 3);
+        tree.knearest(std::span<const Vector<3>>(far), 3, padded, 1.0);
+        REQUIRE_FALSE(padded[0]);
+        REQUIRE(padded[2].distance == std::numeric_limits<double>::infinity());
+        REQUIRE(padded[5].distance == 0);
+
+        std::vector<KDTree<3>::Neighbor> wrong(queries.size() - 1);
+        REQUIRE_THROWS_AS(tree.nearest(batch, wrong), std::length_error);
+    }
+
+    SECTION("no points") {
+        KDTree<3> empty{std::span<const Vector<3>>()};
+        REQUIRE_FALSE(empty.nearest(queries[0]));
+        REQUIRE(empty.knearest(queries[0], 3).empty());
+        REQUIRE(empty.within(queries[0], 10.0).empty());
+    }
+}
+
+TEST_CASE("k-d trees in higher dimensions", "[kdtree]") {
+    std::vector<Vector<8, float>> points;
+    for(int i = 0; i < 3000; i++) {
+        points.push_back(sample::point<8>(0.0f, 100.0f));
+    }
+    KDTree<8, float> tree{std::span<const Vector<8, float>>(points)};
+
+    for(int q = 0; q < 50; q++) {
+        Vector<8, float> query = sample::point<8>(0.0f, 100.0f);
+        std::vector<float> expected = scanDistances(points, query);
+        std::vector<KDTree<8, float>::Neighbor> found = tree.knearest(query, 4);
+        for(size_t i = 0; i < found.size(); i++) {
+            REQUIRE(found[i].distance == expected[i]);
+        }
+    }
+}
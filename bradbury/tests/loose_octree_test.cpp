@@ -0,0 +1,144 @@
+//
+//  loose_octree_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "aabb.h"
+#include "fixtures.h"
+#include "frustum.h"
+#include "loose_octree.h"
+#include "matrix.h"
+#include "ray.h"
+#include "vector.h"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    // A box somewhere in [-100, 100]^3, most of them crowded into one corner,
+    // of up to 2 * maxHalf on a side.
+    AABB<> randomBox(double maxHalf) {
+        return sample::box(-100.0, rand() % 4 == 0 ? 100.0 : -80.0, maxHalf);
+    }
+}
+
+TEST_CASE("frustums cull boxes", "[frustum]") {
+    // Looking down -z from the origin, 90 degrees wide, from 1 to 100 away.
+    Frustum<> frustum(Matrix<4, 4>::perspective(M_PI / 2, 1, 1, 100));
+
+    REQUIRE(frustum.contains(Vector<3>(0, 0, -10)));
+    REQUIRE(frustum.contains(Vector<3>(9, -9, -10)));
+    REQUIRE_FALSE(frustum.contains(Vector<3>(0, 0, 10)));
+    REQUIRE_FALSE(frustum.contains(Vector<3>(0.0, 0.0, -0.5)));
+    REQUIRE_FALSE(frustum.contains(Vector<3>(0, 0, -101)));
+    REQUIRE_FALSE(frustum.contains(Vector<3>(11, 0, -10)));
+
+    AABB<> inside = AABB<>::around(Vector<3>(0, 0, -10), 1);
+    AABB<> straddling = AABB<>::around(Vector<3>(10, 0, -10), 1);
+    AABB<> outside = AABB<>::around(Vector<3>(50, 0, -10), 1);
+    REQUIRE(frustum.contains(inside));
+    REQUIRE(frustum.overlaps(inside));
+    REQUIRE_FALSE(frustum.contains(straddling));
+    REQUIRE(frustum.overlaps(straddling));
+    REQUIRE_FALSE(frustum.overlaps(outside));
+    REQUIRE_FALSE(frustum.overlaps(AABB<>()));
+}
+
+// check() runs after the tree is built, after objects drift and jump, and
+// after half are erased, testing the live objects' current boxes one by one.
+TEST_CASE("loose octrees answer queries like a linear scan", "[octree]") {
+    LooseOctree<> tree(AABB<>::around(Vector<3>(0, 0, 0), 100));
+    std::vector<uint32_t> ids;
+    for(int i = 0; i < 2000; i++) {
+        ids.push_back(tree.insert(randomBox(rand() % 10 == 0 ? 20 : 1)));
+    }
+    // Outside the world altogether.
+    ids.push_back(tree.insert(AABB<>::around(Vector<3>(300, 0, 0), 1)));
+
+    Frustum<> frustum(Matrix<4, 4>::perspective(M_PI / 3, 1.5, 1, 150));
+    auto check = [&] {
+        REQUIRE(tree.nodes()[0].count == tree.size());
+
+        for(int q = 0; q < 20; q++) {
+            AABB<> region = randomBox(15);
+            std::vector<uint32_t> expected = scan::matching(ids, [&](uint32_t id) { return tree.bounds(id).overlaps(region); });
+            REQUIRE(scan::sorted(tree.query(region)) == expected);
+        }
+
+        std::vector<uint32_t> expected = scan::matching(ids, [&](uint32_t id) { return frustum.overlaps(tree.bounds(id)); });
+        REQUIRE(scan::sorted(tree.query(frustum)) == expected);
+
+        for(int q = 0; q < 20; q++) {
+            Ray<> ray(Vector<3>(rand() % 200 - 100.0, rand() % 200 - 100.0, -150.0), Vector<3>(rand() % 100 / 100.0 - 0.5, rand() % 100 / 100.0 - 0.5, 1.0));
+            const double infinity = std::numeric_limits<double>::infinity();
+            std::vector<uint32_t> hits = scan::matching(ids, [&](uint32_t id) { return tree.bounds(id).intersect(ray, 0, infinity) < infinity; });
+            REQUIRE(scan::sorted(tree.query(ray)) == hits);
+        }
+
+        AABB<> everything(Vector<3>(-1000, -1000, -1000), Vector<3>(1000, 1000, 1000));
+        REQUIRE(tree.query(everything).size() == tree.size());
+    };
+
+    SECTION("queries") {
+        check();
+    }
+
+    SECTION("lazy updates") {
+        // Nudged within its loose cell, an object stays put.
+        uint32_t id = ids[3];
+        uint32_t node = tree.node(id);
+        AABB<> loose = tree.loose(tree.nodes()[node]);
+        AABB<> box = tree.bounds(id);
+        Vector<3> room = loose.upper() - box.upper();
+        Vector<3> nudge = room * 0.5;
+        tree.update(id, AABB<>(box.lower() + nudge, box.upper() + nudge));
+        REQUIRE(tree.node(id) == node);
+
+        // Several frames of drifting, and some jumps across the world.
+        for(int frame = 0; frame < 5; frame++) {
+            for(size_t i = 0; i < ids.size(); i += 2) {
+                AABB<> b = tree.bounds(ids[i]);
+                Vector<3> step(rand() % 100 / 50.0 - 1, rand() % 100 / 50.0 - 1, rand() % 100 / 50.0 - 1);
+                tree.update(ids[i], AABB<>(b.lower() + step, b.upper() + step));
+            }
+            tree.update(ids[frame], randomBox(1));
+        }
+        // Everything below the root is within its cell's loose bounds.
+        for(uint32_t i : ids) {
+            bool held = tree.loose(tree.nodes()[tree.node(i)]).contains(tree.bounds(i));
+            REQUIRE((held || tree.node(i) == 0));
+        }
+        check();
+    }
+
+    SECTION("erasing") {
+        for(size_t i = 0; i < ids.size(); i += 2) {
+            tree.erase(ids[i]);
+        }
+        std::vector<uint32_t> live;
+        for(size_t i = 1; i < ids.size(); i += 2) {
+            live.push_back(ids[i]);
+        }
+        ids = live;
+        REQUIRE_THROWS_AS(tree.bounds(0), std::out_of_range);
+        REQUIRE_THROWS_AS(tree.update(0, AABB<>()), std::out_of_range);
+        check();
+
+        // Emptied subtrees go back to the pool.
+        for(uint32_t id : ids) {
+            tree.erase(id);
+        }
+        REQUIRE(tree.size() == 0);
+        REQUIRE(tree.nodes()[0].children == LooseOctree<>::none);
+        size_t pooled = tree.nodes().size();
+        uint32_t id = tree.insert(randomBox(1));
+        REQUIRE(id < 2001);
+        REQUIRE(tree.nodes().size() == pooled);
+    }
+
+    REQUIRE_THROWS_AS(LooseOctree<>(AABB<>()), std::invalid_argument);
+}
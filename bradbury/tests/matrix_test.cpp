@@ -0,0 +1,157 @@
+//
+//  matrix_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "matrix.h"
+#include <cmath>
+#include <memory>
+
+namespace {
+    static_assert(Matrix<3, 3>::identity()(1, 1) == 1 && Matrix<3, 3>::identity()(0, 1) == 0, "identity");
+    static_assert(Matrix<2, 3>({1, 2, 3, 4, 5, 6}).transpose()(2, 1) == 6, "transpose");
+    static_assert((Matrix<2, 2>({1, 2, 3, 4}) * Matrix<2, 2>({5, 6, 7, 8}))(1, 0) == 3 * 5 + 4 * 7, "product");
+    static_assert((Matrix<2, 2>({1, 2, 3, 4}) * Vector<2>(1, -1)).y() == -1, "matrix-vector product");
+    static_assert(Matrix<4, 4>::translation(Vector<3>(1, 2, 3)).transformPoint(Vector<3>(1, 1, 1)) == Vector<3>(2, 3, 4), "translation");
+    
+    // The product of an R x C and a C x K matrix, as a naive triple loop.
+    template<size_t R, size_t C, size_t K, class T>
+    double maximumError(const Matrix<R, C, T> &a, const Matrix<C, K, T> &b, const Matrix<R, K, T> &product) {
+        double error = 0;
+        for(size_t i = 0; i < R; i++) {
+            for(size_t j = 0; j < K; j++) {
+                double sum = 0;
+                for(size_t k = 0; k < C; k++) {
+                    sum += a(i, k) * b(k, j);
+                }
+                error = std::max(error, std::fabs(sum - product(i, j)));
+            }
+        }
+        return error;
+    }
+    
+    template<size_t R, size_t C>
+    std::unique_ptr<Matrix<R, C>> randomMatrix() {
+        std::unique_ptr<Matrix<R, C>> m(new Matrix<R, C>());
+        double *elements = const_cast<double *>(m->data());
+        for(size_t i = 0; i < R * C; i++) {
+            elements[i] = rand() % 2000 / 100.0 - 10;
+        }
+        return m;
+    }
+}
+
+TEST_CASE("matrices can be created and read", "[matrix]") {
+    Matrix<2, 3> m = {1, 2, 3,
+                      4, 5, 6};
+    
+    REQUIRE(m(0, 2) == 3);
+    REQUIRE(m(1, 0) == 4);
+    REQUIRE(m.rows() == 2);
+    REQUIRE(m.columns() == 3);
+    REQUIRE(m.row(1) == Vector<3>(4, 5, 6));
+    REQUIRE(m.column(2) == Vector<2>(3, 6));
+    
+    Matrix<3, 2> t = m.transpose();
+    REQUIRE(t(2, 1) == 6);
+    REQUIRE(t.transpose() == m);
+    
+    REQUIRE_THROWS_AS((Matrix<2, 2>({1, 2, 3})), std::length_error);
+    
+    Matrix<2, 3> sum = m + m * 2 - 0.5 * m;
+    REQUIRE(sum(1, 2) == 6 * 2.5);
+}
+
+TEST_CASE("matrices multiply", "[matrix]") {
+    SECTION("matrix-vector") {
+        Matrix<2, 3> m = {1, 2, 3,
+                          4, 5, 6};
+        Vector<2> v = m * Vector<3>(1, 0, -1);
+        
+        REQUIRE(v.x() == -2);
+        REQUIRE(v.y() == -2);
+    }
+    
+    SECTION("small products") {
+        Matrix<2, 3> a = {1, 2, 3,
+                          4, 5, 6};
+        Matrix<3, 2> b = {7, 8,
+                          9, 10,
+                          11, 12};
+        Matrix<2, 2> ab = a * b;
+        Matrix<2, 2> expected = {58, 64, 139, 154};
+        
+        REQUIRE(ab == expected);
+        REQUIRE(maximumError(a, b, ab) == 0);
+    }
+    
+    SECTION("4x4 products use the simd kernel") {
+        std::unique_ptr<Matrix<4, 4>> a = randomMatrix<4, 4>();
+        std::unique_ptr<Matrix<4, 4>> b = randomMatrix<4, 4>();
+        
+        Matrix<4, 4> ab = *a * *b;
+        REQUIRE(maximumError(*a, *b, ab) < 1e-9);
+        Matrix<4, 4> unchanged = *a * Matrix<4, 4>::identity();
+        REQUIRE(unchanged == *a);
+        
+        Matrix<4, 4, float> af = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+        Matrix<4, 4, float> squared = af * af;
+        REQUIRE(squared(0, 0) == 1 * 1 + 2 * 5 + 3 * 9 + 4 * 13);
+        REQUIRE(squared(3, 3) == 13 * 4 + 14 * 8 + 15 * 12 + 16 * 16);
+        
+        // Every level agrees.
+        for(simd::Level level : {simd::Level::scalar, simd::Level::sse2, simd::Level::avx2, simd::Level::avx512}) {
+            double out[16];
+            simd::kernels<double>(level).multiply4x4(a->data(), b->data(), out);
+            for(size_t i = 0; i < 16; i++) {
+                REQUIRE(out[i] == Approx(ab.data()[i]));
+            }
+        }
+    }
+    
+    SECTION("large products are blocked") {
+        std::unique_ptr<Matrix<70, 130>> a = randomMatrix<70, 130>();
+        std::unique_ptr<Matrix<130, 90>> b = randomMatrix<130, 90>();
+        std::unique_ptr<Matrix<70, 90>> ab(new Matrix<70, 90>(*a * *b));
+        
+        REQUIRE(maximumError(*a, *b, *ab) < 1e-9);
+    }
+}
+
+TEST_CASE("matrices build transforms", "[matrix]") {
+    typedef Matrix<4, 4> Transform;
+    Vector<3> p(1, 2, 3);
+    
+    SECTION("translation and scaling") {
+        Transform m = Transform::translation(Vector<3>(10, 0, 0)) * Transform::scaling(Vector<3>(2, 2, 2));
+        
+        // Scaled first, then moved.
+        REQUIRE(m.transformPoint(p) == Vector<3>(12, 4, 6));
+        REQUIRE(m.transformDirection(p) == Vector<3>(2, 4, 6));
+    }
+    
+    SECTION("rotation") {
+        Transform quarter = Transform::rotation(Vector<3>(0, 0, 2), M_PI / 2);
+        
+        REQUIRE(quarter.transformPoint(Vector<3>(1, 0, 0)) == Vector<3>(0, 1, 0));
+        REQUIRE(quarter.transformPoint(p).z() == Approx(3));
+        Transform inverse = quarter * quarter.transpose();
+        REQUIRE(inverse == Transform::identity());
+    }
+    
+    SECTION("projections") {
+        Transform perspective = Transform::perspective(M_PI / 2, 1, 1, 100);
+        
+        REQUIRE(perspective.transformPoint(Vector<3>(0, 0, -1)).z() == Approx(-1));
+        REQUIRE(perspective.transformPoint(Vector<3>(0, 0, -100)).z() == Approx(1));
+        REQUIRE(perspective.transformPoint(Vector<3>(1, 1, -1)).x() == Approx(1));
+        
+        Transform orthographic = Transform::orthographic(0, 800, 0, 600, -1, 1);
+        Vector<3> corner = orthographic.transformPoint(Vector<3>(800, 600, 0));
+        REQUIRE(corner.x() == Approx(1));
+        REQUIRE(corner.y() == Approx(1));
+    }
+}
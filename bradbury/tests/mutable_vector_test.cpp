@@ -0,0 +1,116 @@
+//
+//  mutable_vector_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "fixtures.h"
+#include "mutable_vector.h"
+#include <type_traits>
+
+namespace {
+    constexpr Vector<3> sumOfSquares() {
+        MutableVector<3> sum;
+        for(int i = 1; i <= 3; i++) {
+            sum += Vector<3>(i, i, i) * i;
+        }
+        return sum;
+    }
+    
+    static_assert(sumOfSquares().z() == 1 + 4 + 9, "compound assignment in constant expressions");
+    static_assert(MutableVector<2>().set(1, 5).y() == 5, "building in constant expressions");
+    static_assert(std::is_trivially_copyable<MutableVector<3>>::value, "inline storage");
+    static_assert(sizeof(MutableVector<3>) == sizeof(Vector<3>), "no extra state");
+}
+
+TEST_CASE("mutable vectors can be changed in place", "[vector]") {
+    Vector<3> a(1, 2, 3);
+    Vector<3> b(4, 5, 6);
+    
+    SECTION("compound assignment") {
+        MutableVector<3> v = a;
+        
+        v += b;
+        REQUIRE(v.x() == 5);
+        REQUIRE(v.z() == 9);
+        
+        v -= a * 2;
+        REQUIRE(v.x() == 3);
+        REQUIRE(v.z() == 3);
+        
+        v *= 2;
+        REQUIRE(v.y() == 6);
+        
+        v /= 4;
+        REQUIRE(v.x() == 1.5);
+        
+        // Operands are untouched.
+        REQUIRE(a.x() == 1);
+        REQUIRE(b.x() == 4);
+    }
+    
+    SECTION("accumulation allocates nothing") {
+        MutableVector<3> force;
+        
+        size_t before = allocationCount;
+        for(int i = 0; i < 100; i++) {
+            force += a + b * 0.5;
+        }
+        size_t after = allocationCount;
+        
+        REQUIRE(after == before);
+        
+        REQUIRE(force.x() == Approx(100 * 3));
+        REQUIRE(force.z() == Approx(100 * 6));
+    }
+    
+    SECTION("self reference") {
+        MutableVector<3> v = a;
+        v += v;
+        v -= v * 0.25;
+        
+        REQUIRE(v.x() == 1.5);
+        REQUIRE(v.z() == 4.5);
+    }
+    
+    SECTION("writable components") {
+        MutableVector<4, float> v;
+        v[2] = 7;
+        v.data()[3] = 8;
+        
+        REQUIRE(v.z() == 7);
+        REQUIRE(v.t() == 8);
+        
+#if BRADBURY_CHECKED_ACCESS
+        REQUIRE_THROWS_AS(v[4] = 1, std::out_of_range);
+#endif
+    }
+    
+    SECTION("building") {
+        Vector<3> v = MutableVector<3>().set(0, 1).set(2, 5);
+        
+        REQUIRE(v.x() == 1);
+        REQUIRE(v.y() == 0);
+        REQUIRE(v.z() == 5);
+        
+        Vector<3> w = (MutableVector<3>(a) += b) *= 2;
+        REQUIRE(w.y() == 14);
+    }
+    
+    SECTION("usable as a Vector") {
+        MutableVector<3> v = a;
+        
+        // Binds to a Vector reference with no conversion.
+        const Vector<3> &asVector = v;
+        REQUIRE(&asVector == &v);
+        
+        REQUIRE(v == a);
+        REQUIRE(v.dot(b) == a.dot(b));
+        REQUIRE(a.cross(v).x() == 0);
+        
+        Vector<3> sum = v + b;
+        REQUIRE(sum.x() == 5);
+    }
+}
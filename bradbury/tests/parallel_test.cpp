@@ -0,0 +1,56 @@
+//
+//  parallel_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "parallel.h"
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+// The thread count is global, so every section restores the default.
+TEST_CASE("parallel work is split into fixed chunks", "[parallel]") {
+    size_t previous = parallel::threads();
+    
+    SECTION("every item exactly once") {
+        for(size_t threads : {1, 2, 7}) {
+            parallel::setThreads(threads);
+            
+            std::vector<int> visits(1000, 0);
+            std::vector<size_t> starts(parallel::chunks(1000, 64), 0);
+            parallel::forChunks(1000, 64, [&](size_t chunk, size_t begin, size_t end) {
+                starts[chunk] = begin;
+                for(size_t i = begin; i < end; i++) {
+                    visits[i]++;
+                }
+            });
+            
+            REQUIRE(starts.size() == 16);
+            REQUIRE(starts[15] == 960);
+            for(int v : visits) {
+                REQUIRE(v == 1);
+            }
+        }
+    }
+    
+    SECTION("nothing to do") {
+        int calls = 0;
+        parallel::forChunks(0, 64, [&](size_t, size_t, size_t) { calls++; });
+        REQUIRE(calls == 0);
+    }
+    
+    SECTION("exceptions reach the caller") {
+        parallel::setThreads(4);
+        REQUIRE_THROWS_AS(parallel::forChunks(100, 1, [](size_t chunk, size_t, size_t) {
+            if(chunk == 50) {
+                throw std::runtime_error("chunk 50");
+            }
+        }), std::runtime_error);
+    }
+    
+    parallel::setThreads(0);
+    REQUIRE(parallel::threads() == previous);
+}
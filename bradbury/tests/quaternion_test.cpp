@@ -0,0 +1,192 @@
+//
+//  quaternion_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "matrix.h"
+#include "quaternion.h"
+#include "vector.h"
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("quaternions rotate vectors", "[quaternion]") {
+    const double quarter = M_PI / 2;
+    Quaternion<> q = Quaternion<>::axisAngle(Vector<3>(0, 0, 2), quarter);
+    
+    SECTION("construction") {
+        Quaternion<> identity;
+        REQUIRE(identity == Quaternion<>::identity());
+        REQUIRE(identity.w() == 1);
+        
+        REQUIRE(q.magnitude() == Approx(1));
+        REQUIRE(q.z() == Approx(std::sqrt(0.5)));
+        REQUIRE(q.w() == Approx(std::sqrt(0.5)));
+        
+        Quaternion<> fromVector(Vector<4>(1, 2, 3, 4));
+        Vector<4> back = fromVector.vector();
+        REQUIRE(back == Vector<4>(1, 2, 3, 4));
+    }
+    
+    SECTION("rotation") {
+        Vector<3> rotated = q.rotate(Vector<3>(1, 0, 0));
+        REQUIRE(rotated == Vector<3>(0, 1, 0));
+        
+        Vector<3> axis(1, 2, 3);
+        Vector<3> onAxis = Quaternion<>::axisAngle(axis, 1.3).rotate(axis);
+        REQUIRE(onAxis == axis);
+        
+        Vector<3> v(3, -1, 2);
+        Vector<3> asMatrix = Matrix<4, 4>::rotation(axis, 1.3).transformDirection(v);
+        Vector<3> asQuaternion = Quaternion<>::axisAngle(axis, 1.3).rotate(v);
+        REQUIRE(asQuaternion == asMatrix);
+    }
+    
+    SECTION("products and conjugates") {
+        Quaternion<> half = Quaternion<>::axisAngle(Vector<3>(0, 0, 1), quarter / 2);
+        Quaternion<> doubled = half * half;
+        REQUIRE(doubled == q);
+        
+        Quaternion<> undone = q * q.conjugate();
+        REQUIRE(undone == Quaternion<>::identity());
+        
+        // Products apply the right-hand rotation first.
+        Quaternion<> aboutX = Quaternion<>::axisAngle(Vector<3>(1, 0, 0), quarter);
+        Vector<3> v(0, 1, 0);
+        Vector<3> composed = (q * aboutX).rotate(v);
+        REQUIRE(composed == q.rotate(aboutX.rotate(v)));
+        REQUIRE(composed == Vector<3>(0, 0, 1));
+        
+        Quaternion<> i(1, 0, 0, 0), j(0, 1, 0, 0), k(0, 0, 1, 0);
+        Quaternion<> ij = i * j, ji = j * i;
+        REQUIRE(ij == k);
+        REQUIRE(ji == -k);
+    }
+    
+    SECTION("normalization") {
+        Quaternion<> drifted(0, 0, 2, 2);
+        REQUIRE(drifted.normalize() == q);
+        
+        Quaternion<> zero(0, 0, 0, 0);
+        REQUIRE(zero.normalize() == zero);
+    }
+    
+    SECTION("matrices") {
+        Matrix<3, 3> m = q.matrix();
+        Matrix<3, 3> expected({0, -1, 0,
+                               1,  0, 0,
+                               0,  0, 1});
+        REQUIRE(m == expected);
+        
+        // Every branch of fromMatrix(), including half turns about each axis.
+        std::vector<Quaternion<>> rotations = {
+            Quaternion<>::axisAngle(Vector<3>(1, 2, 3), 0.7),
+            Quaternion<>::axisAngle(Vector<3>(1, 0, 0), M_PI),
+            Quaternion<>::axisAngle(Vector<3>(0, 1, 0), M_PI),
+            Quaternion<>::axisAngle(Vector<3>(0, 0, 1), M_PI),
+            Quaternion<>::axisAngle(Vector<3>(-1.0, 2.0, -0.5), 2.9),
+        };
+        for(Quaternion<> const &r : rotations) {
+            Quaternion<> back = Quaternion<>::fromMatrix(r.matrix());
+            // q and -q are the same rotation.
+            bool same = back == r || back == -r;
+            REQUIRE(same);
+            
+            Vector<3> v(0.5, -2.0, 1.0);
+            Vector<3> byMatrix = r.matrix() * v;
+            REQUIRE(byMatrix == r.rotate(v));
+        }
+    }
+    
+    SECTION("interpolation") {
+        Quaternion<> start;
+        REQUIRE(start.slerp(q, 0) == start);
+        REQUIRE(start.slerp(q, 1) == q);
+        
+        Quaternion<> halfway = Quaternion<>::axisAngle(Vector<3>(0, 0, 1), quarter / 2);
+        REQUIRE(start.slerp(q, 0.5) == halfway);
+        REQUIRE(start.nlerp(q, 0.5) == halfway);
+        
+        // slerp moves at constant angular speed; nlerp does not.
+        Quaternion<> third = Quaternion<>::axisAngle(Vector<3>(0, 0, 1), quarter / 3);
+        REQUIRE(start.slerp(q, 1.0 / 3) == third);
+        REQUIRE(start.nlerp(q, 1.0 / 3) != third);
+        
+        // Takes the shorter way round from either sign.
+        REQUIRE(start.slerp(-q, 0.5) == halfway);
+        REQUIRE(start.nlerp(-q, 0.5) == halfway);
+        
+        // Nearly identical rotations fall back to nlerp.
+        Quaternion<> close = Quaternion<>::axisAngle(Vector<3>(0, 0, 1), 1e-4);
+        REQUIRE(start.slerp(close, 0.5).magnitude() == Approx(1));
+    }
+    
+    SECTION("constexpr") {
+        constexpr Quaternion<> i(1, 0, 0, 0);
+        constexpr Quaternion<> flipped = i * i;
+        static_assert(flipped.w() == -1, "i squared is -1");
+        constexpr Vector<3> v = i.rotate(Vector<3>(0, 1, 0));
+        static_assert(v.y() == -1, "a half turn about x flips y");
+    }
+}
+
+TEST_CASE("quaternions rotate and interpolate in bulk", "[quaternion]") {
+    std::vector<Vector<3>> points;
+    std::vector<Quaternion<>> from, to;
+    for(int i = 0; i < 1000; i++) {
+        points.push_back(Vector<3>(i % 7 - 3, i % 11 - 5, i % 13 - 6));
+        from.push_back(Quaternion<>::axisAngle(Vector<3>(1, i % 5, 2), 0.01 * i));
+        to.push_back(Quaternion<>::axisAngle(Vector<3>(i % 3, 1, -1), -0.02 * i));
+    }
+    
+    SECTION("one rotation") {
+        Quaternion<> q = from[123];
+        std::vector<Vector<3>> out(points.size());
+        rotate(q, points, out);
+        
+        for(size_t i = 0; i < points.size(); i++) {
+            REQUIRE(out[i] == q.rotate(points[i]));
+        }
+        
+        rotate(q, points, points);
+        REQUIRE(points[999] == out[999]);
+    }
+    
+    SECTION("a rotation each") {
+        std::vector<Vector<3>> out(points.size());
+        rotate<double>(from, points, out);
+        
+        for(size_t i = 0; i < points.size(); i++) {
+            REQUIRE(out[i] == from[i].rotate(points[i]));
+        }
+    }
+    
+    SECTION("interpolation") {
+        std::vector<Quaternion<>> out(from.size());
+        slerp(from, to, 0.25, out);
+        for(size_t i = 0; i < from.size(); i++) {
+            REQUIRE(out[i] == from[i].slerp(to[i], 0.25));
+        }
+        
+        nlerp(from, to, 0.25, out);
+        for(size_t i = 0; i < from.size(); i++) {
+            REQUIRE(out[i] == from[i].nlerp(to[i], 0.25));
+        }
+    }
+    
+    SECTION("floats") {
+        Quaternion<float> q = Quaternion<float>::axisAngle(Vector<3, float>(0, 1, 0), 0.5f);
+        std::vector<Vector<3, float>> in(100, Vector<3, float>(1, 2, 3));
+        rotate(q, in, in);
+        REQUIRE(in[50] == q.rotate(Vector<3, float>(1, 2, 3)));
+    }
+    
+    SECTION("lengths must match") {
+        std::vector<Vector<3>> out(points.size() - 1);
+        REQUIRE_THROWS_AS(rotate(from[0], points, out), std::length_error);
+        REQUIRE_THROWS_AS(rotate<double>(from, points, out), std::length_error);
+    }
+}
@@ -0,0 +1,166 @@
+//
+//  ray_packet_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "aabb.h"
+#include "fixtures.h"
+#include "ray.h"
+#include "ray_packet.h"
+#include "triangle.h"
+#include "vector.h"
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace {
+    // Triangles and boxes scattered around the origin, and rays from
+    // farther out aimed roughly at it, so that about half of them hit.
+    template<class T>
+    Triangle<T> randomTriangle() {
+        Vector<3, T> a = sample::point<3>(T(-2), T(2));
+        return Triangle<T>(a, Vector<3, T>(a + sample::point<3>(T(-2), T(2))), Vector<3, T>(a + sample::point<3>(T(-2), T(2))));
+    }
+
+    template<class T>
+    Ray<T> randomRay() {
+        Vector<3, T> origin = sample::point<3>(T(-10), T(10));
+        return Ray<T>(origin, Vector<3, T>(sample::point<3>(T(-2), T(2)) - origin));
+    }
+
+    // The packet's lanes, against what the scalar test gives for each: the
+    // same hits, at about the same distances.
+    template<size_t W, class T>
+    void compare(const ScalarPacket<W, T> &packet, const std::vector<T> &expected, size_t count) {
+        const T infinity = std::numeric_limits<T>::infinity();
+        for(size_t l = 0; l < W; l++) {
+            T want = l < count ? expected[l] : infinity;
+            T got = packet[l];
+            REQUIRE((got == infinity) == (want == infinity));
+            if(want != infinity) {
+                REQUIRE(got == Approx(want));
+            }
+        }
+    }
+
+    template<size_t W, class T>
+    void checkPackets(size_t count) {
+        const T infinity = std::numeric_limits<T>::infinity();
+        for(int trial = 0; trial < 50; trial++) {
+            std::vector<Triangle<T>> triangles;
+            std::vector<AABB<T>> boxes;
+            std::vector<Ray<T>> rays;
+            for(size_t l = 0; l < count; l++) {
+                triangles.push_back(randomTriangle<T>());
+                boxes.push_back(sample::box(T(-2), T(2), T(2)));
+                rays.push_back(randomRay<T>());
+            }
+            T tmax = trial % 2 == 0 ? infinity : T(1);
+
+            // One ray against many.
+            std::vector<T> expected;
+            for(size_t l = 0; l < count; l++) {
+                expected.push_back(triangles[l].intersect(rays[0], 0, tmax));
+            }
+            compare<W, T>(TrianglePacket<W, T>::load(triangles.data(), count).intersect(rays[0], 0, tmax), expected, count);
+
+            expected.clear();
+            for(size_t l = 0; l < count; l++) {
+                expected.push_back(boxes[l].intersect(rays[0], 0, tmax));
+            }
+            compare<W, T>(BoxPacket<W, T>::load(boxes.data(), count).intersect(rays[0], 0, tmax), expected, count);
+
+            // Many rays against one.
+            RayPacket<W, T> packet = RayPacket<W, T>::load(rays.data(), count);
+            expected.clear();
+            for(size_t l = 0; l < count; l++) {
+                expected.push_back(triangles[0].intersect(rays[l], 0, tmax));
+            }
+            compare<W, T>(packet.intersect(triangles[0], 0, tmax), expected, count);
+
+            expected.clear();
+            for(size_t l = 0; l < count; l++) {
+                expected.push_back(boxes[0].intersect(rays[l], 0, tmax));
+            }
+            compare<W, T>(packet.intersect(boxes[0], 0, tmax), expected, count);
+        }
+    }
+}
+
+TEST_CASE("triangles intersect rays", "[triangle]") {
+    const double infinity = std::numeric_limits<double>::infinity();
+    Triangle<> triangle(Vector<3>(0, 0, 0), Vector<3>(1, 0, 0), Vector<3>(0, 1, 0));
+    Vector<3> down(0.0, 0.0, -1.0);
+
+    REQUIRE(triangle.edge1() == Vector<3>(1, 0, 0));
+    REQUIRE(triangle.edge2() == Vector<3>(0, 1, 0));
+    REQUIRE(triangle.normal() == Vector<3>(0, 0, 1));
+    REQUIRE(triangle.bounds().upper() == Vector<3>(1, 1, 0));
+
+    REQUIRE(triangle.intersect(Ray<>(Vector<3>(0.25, 0.25, 2.0), down), 0, infinity) == Approx(2));
+    // From behind, and with a longer direction.
+    REQUIRE(triangle.intersect(Ray<>(Vector<3>(0.25, 0.25, -1.0), Vector<3>(0.0, 0.0, 2.0)), 0, infinity) == Approx(0.5));
+    // Edges and corners.
+    REQUIRE(triangle.intersect(Ray<>(Vector<3>(0.5, 0.5, 1.0), down), 0, infinity) == Approx(1));
+    REQUIRE(triangle.intersect(Ray<>(Vector<3>(0.0, 0.0, 1.0), down), 0, infinity) == Approx(1));
+
+    // Beside it, behind the ray, out of range and in its plane.
+    REQUIRE(triangle.intersect(Ray<>(Vector<3>(0.75, 0.75, 1.0), down), 0, infinity) == infinity);
+    REQUIRE(triangle.intersect(Ray<>(Vector<3>(-0.25, 0.25, 1.0), down), 0, infinity) == infinity);
+    REQUIRE(triangle.intersect(Ray<>(Vector<3>(0.25, 0.25, -1.0), down), 0, infinity) == infinity);
+    REQUIRE(triangle.intersect(Ray<>(Vector<3>(0.25, 0.25, 2.0), down), 0, 1) == infinity);
+    REQUIRE(triangle.intersect(Ray<>(Vector<3>(-1.0, 0.25, 0.0), Vector<3>(1.0, 0.0, 0.0)), 0, infinity) == infinity);
+
+    // Degenerate triangles are never hit.
+    Triangle<> flat(Vector<3>(0, 0, 0), Vector<3>(1, 1, 0), Vector<3>(2, 2, 0));
+    REQUIRE(flat.intersect(Ray<>(Vector<3>(1.0, 1.0, 1.0), down), 0, infinity) == infinity);
+}
+
+TEST_CASE("ray packets intersect like one ray at a time", "[triangle][packet]") {
+    SECTION("full packets") {
+        checkPackets<4, double>(4);
+        checkPackets<8, double>(8);
+        checkPackets<4, float>(4);
+        checkPackets<8, float>(8);
+    }
+
+    SECTION("partial packets miss in their empty lanes") {
+        checkPackets<8, double>(5);
+        checkPackets<4, float>(1);
+    }
+
+    SECTION("each ray has its own range") {
+        Triangle<> triangle(Vector<3>(-1, -1, 0), Vector<3>(1, -1, 0), Vector<3>(0, 1, 0));
+        Ray<> rays[2] = {Ray<>(Vector<3>(0, 0, 2), Vector<3>(0, 0, -1)), Ray<>(Vector<3>(0, 0, 5), Vector<3>(0, 0, -1))};
+        RayPacket<4> packet = RayPacket<4>::load(rays, 2);
+        REQUIRE(packet.lane(1).origin() == rays[1].origin());
+
+        // The triangle is 2 along the first ray and 5 along the second.
+        ScalarPacket<4> tmin(0), tmax(3);
+        tmax.component(0)[1] = 6;
+        ScalarPacket<4> hits = packet.intersect(triangle, tmin, tmax);
+        REQUIRE(hits[0] == Approx(2));
+        REQUIRE(hits[1] == Approx(5));
+
+        tmax.component(0)[0] = 1;
+        hits = packet.intersect(triangle, tmin, tmax);
+        REQUIRE(hits[0] == std::numeric_limits<double>::infinity());
+        REQUIRE(hits[1] == Approx(5));
+
+        tmin.component(0)[1] = 5.5;
+        tmax.component(0)[0] = 3;
+        hits = packet.intersect(triangle, tmin, tmax);
+        REQUIRE(hits[0] == Approx(2));
+        REQUIRE(hits[1] == std::numeric_limits<double>::infinity());
+
+        // The box spans 1 to 3 along the first ray and 4 to 6 along the
+        // second, which starts inside it at 5.5.
+        hits = packet.intersect(AABB<>::around(Vector<3>(0, 0, 0), 1), tmin, tmax);
+        REQUIRE(hits[0] == Approx(1));
+        REQUIRE(hits[1] == Approx(5.5));
+    }
+}
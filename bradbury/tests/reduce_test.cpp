@@ -0,0 +1,131 @@
+//
+//  reduce_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "reduce.h"
+#include "parallel.h"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// Enough points for several chunks, and a count that leaves a remainder in
+// both the last chunk and its lanes.
+TEST_CASE("vector spans reduce in parallel", "[reduce][parallel]") {
+    size_t previous = parallel::threads();
+    const size_t count = 5 * reductionGrain + 7;
+    
+    std::vector<Vector<3, float>> points;
+    std::vector<float> weights;
+    for(size_t i = 0; i < count; i++) {
+        points.push_back(Vector<3, float>(float(rand() % 20000) / 7 - 1000, float(rand() % 20000) / 3, -float(rand() % 20000) / 11));
+        weights.push_back(float(rand() % 100) / 100);
+    }
+    std::span<const Vector<3, float>> span(points);
+    
+    SECTION("sums") {
+        double x = 0, y = 0, z = 0;
+        for(Vector<3, float> const &p : points) {
+            x += p.x();
+            y += p.y();
+            z += p.z();
+        }
+        
+        Vector<3, float> total = sum(span);
+        REQUIRE(total.x() == Approx(x).epsilon(1e-5));
+        REQUIRE(total.y() == Approx(y).epsilon(1e-5));
+        REQUIRE(total.z() == Approx(z).epsilon(1e-5));
+        
+        Vector<3, float> centroid = mean(span);
+        REQUIRE(centroid.y() == Approx(y / count).epsilon(1e-5));
+        
+        double wx = 0;
+        for(size_t i = 0; i < count; i++) {
+            wx += weights[i] * points[i].x();
+        }
+        Vector<3, float> weighted = weightedSum(span, weights);
+        REQUIRE(weighted.x() == Approx(wx).epsilon(1e-4));
+    }
+    
+    SECTION("bounds") {
+        Vector<3, float> lower = points[0], upper = points[0];
+        for(Vector<3, float> const &p : points) {
+            lower = Vector<3, float>(std::min(lower.x(), p.x()), std::min(lower.y(), p.y()), std::min(lower.z(), p.z()));
+            upper = Vector<3, float>(std::max(upper.x(), p.x()), std::max(upper.y(), p.y()), std::max(upper.z(), p.z()));
+        }
+        
+        Bounds<3, float> found = bounds(span);
+        REQUIRE(found.lower == lower);
+        REQUIRE(found.upper == upper);
+        
+        Vector<3, float> smallest = minimum(span), largest = maximum(span);
+        REQUIRE(smallest == lower);
+        REQUIRE(largest == upper);
+    }
+    
+    SECTION("the same bits on any number of threads") {
+        parallel::setThreads(1);
+        Vector<3, float> total = sum(span);
+        Vector<3, float> weighted = weightedSum(span, weights);
+        Vector<3, float> centroid = mean(span);
+        
+        for(size_t threads : {2, 3, 8}) {
+            parallel::setThreads(threads);
+            Vector<3, float> again = sum(span);
+            Vector<3, float> weightedAgain = weightedSum(span, weights);
+            Vector<3, float> centroidAgain = mean(span);
+            REQUIRE(std::memcmp(total.data(), again.data(), sizeof(total)) == 0);
+            REQUIRE(std::memcmp(weighted.data(), weightedAgain.data(), sizeof(weighted)) == 0);
+            REQUIRE(std::memcmp(centroid.data(), centroidAgain.data(), sizeof(centroid)) == 0);
+        }
+    }
+    
+    SECTION("over-aligned and half vectors") {
+        std::vector<Vector<3, float, 16>> aligned(points.begin(), points.end());
+        Vector<3, float> alignedTotal = sum(std::span<const Vector<3, float, 16>>(aligned));
+        Vector<3, float> total = sum(span);
+        REQUIRE(alignedTotal == total);
+        
+        std::vector<Vector<2, half>> halves;
+        for(int i = 0; i < 1000; i++) {
+            halves.push_back(Vector<2, half>(float(i % 10), float(-i % 7)));
+        }
+        Bounds<2, half> halfBounds = bounds(std::span<const Vector<2, half>>(halves));
+        Vector<2, float> halfTotal = sum(std::span<const Vector<2, half>>(halves));
+        Vector<2, half> lower(0.0f, -6.0f), upper(9.0f, 0.0f);
+        REQUIRE(halfBounds.lower == lower);
+        REQUIRE(halfBounds.upper == upper);
+        REQUIRE(halfTotal.x() == 4500);
+    }
+    
+    SECTION("mixed vectors sum in double") {
+        std::vector<Vector<3, mixed>> stored(points.begin(), points.end());
+        Vector<3, double> total = sum(std::span<const Vector<3, mixed>>(stored));
+        double x = 0;
+        for(Vector<3, float> const &p : points) {
+            x += p.x();
+        }
+        REQUIRE(total.x() == Approx(x).epsilon(1e-12));
+        
+        Vector<3, double> centroid = mean(std::span<const Vector<3, mixed>>(stored));
+        REQUIRE(centroid.x() == Approx(x / count).epsilon(1e-12));
+    }
+    
+    SECTION("empty spans") {
+        std::span<const Vector<3>> none;
+        Vector<3> zero = sum(none);
+        REQUIRE(zero == Vector<3>());
+        REQUIRE_THROWS_AS(mean(none), std::length_error);
+        REQUIRE_THROWS_AS(bounds(none), std::length_error);
+        REQUIRE_THROWS_AS(minimum(none), std::length_error);
+        
+        std::vector<double> tooMany(3, 1.0);
+        REQUIRE_THROWS_AS(weightedSum(none, tooMany), std::length_error);
+    }
+    
+    parallel::setThreads(0);
+    REQUIRE(parallel::threads() == previous);
+}
@@ -0,0 +1,253 @@
+//
+//  simd_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "simd.h"
+#include "vector.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+
+// Compares every available level against the scalar kernels for T.
+template<class T>
+void checkKernels(T tolerance) {
+    const simd::Kernels<T> &reference = simd::kernels<T>(simd::Level::scalar);
+
+    std::vector<simd::Level> levels = {simd::Level::sse2, simd::Level::avx2, simd::Level::avx512};
+    for(simd::Level level : levels) {
+        if(level > simd::detected()) {
+            continue;
+        }
+
+        const simd::Kernels<T> &k = simd::kernels<T>(level);
+        INFO("level " << simd::name(level));
+        REQUIRE(k.level == level);
+
+        // Small sizes exercise the padded single-register paths; larger ones
+        // the chunked loops and their tails.
+        for(size_t n = 1; n <= 37; n++) {
+            INFO("n = " << n);
+
+            std::vector<T> a(n), b(n);
+            for(size_t i = 0; i < n; i++) {
+                a[i] = rand() % 10000 / T(100) - 50;
+                b[i] = rand() % 10000 / T(100) - 50;
+            }
+
+            // One extra slot catches writes past the end.
+            std::vector<T> expected(n + 1, 42), actual(n + 1, 42);
+
+            reference.add(a.data(), b.data(), expected.data(), n);
+            k.add(a.data(), b.data(), actual.data(), n);
+            REQUIRE(expected == actual);
+
+            reference.subtract(a.data(), b.data(), expected.data(), n);
+            k.subtract(a.data(), b.data(), actual.data(), n);
+            REQUIRE(expected == actual);
+
+            reference.negate(a.data(), expected.data(), n);
+            k.negate(a.data(), actual.data(), n);
+            REQUIRE(expected == actual);
+
+            reference.scale(a.data(), T(1.5), expected.data(), n);
+            k.scale(a.data(), T(1.5), actual.data(), n);
+            REQUIRE(expected == actual);
+
+            reference.multiply(a.data(), b.data(), expected.data(), n);
+            k.multiply(a.data(), b.data(), actual.data(), n);
+            REQUIRE(expected == actual);
+            
+            // Fused and unfused multiply-adds may round differently.
+            reference.multiplyAdd(a.data(), b.data(), a.data(), expected.data(), n);
+            k.multiplyAdd(a.data(), b.data(), a.data(), actual.data(), n);
+            for(size_t i = 0; i < n; i++) {
+                REQUIRE(std::fabs(expected[i] - actual[i]) < tolerance * (1 + std::fabs(expected[i])));
+            }
+            REQUIRE(actual[n] == 42);
+            
+            reference.axpy(T(1.5), a.data(), b.data(), expected.data(), n);
+            k.axpy(T(1.5), a.data(), b.data(), actual.data(), n);
+            for(size_t i = 0; i < n; i++) {
+                REQUIRE(std::fabs(expected[i] - actual[i]) < tolerance * (1 + std::fabs(expected[i])));
+            }
+            REQUIRE(actual[n] == 42);
+            
+            std::vector<T> squares(n);
+            reference.multiply(a.data(), a.data(), squares.data(), n);
+            reference.inverseSqrt(squares.data(), expected.data(), n);
+            k.inverseSqrt(squares.data(), actual.data(), n);
+            REQUIRE(expected == actual);
+            
+            k.approximateInverseSqrt(squares.data(), actual.data(), n);
+            for(size_t i = 0; i < n; i++) {
+                if(squares[i] != 0) {
+                    REQUIRE(std::fabs(actual[i] - expected[i]) <= simd::approximationError * expected[i]);
+                }
+            }
+            REQUIRE(actual[n] == 42);
+            
+            T expectedDot = reference.dot(a.data(), b.data(), n);
+            T actualDot = k.dot(a.data(), b.data(), n);
+            REQUIRE(std::fabs(expectedDot - actualDot) < tolerance * (1 + std::fabs(expectedDot)));
+            
+            T expectedDistance = reference.squaredDistance(a.data(), b.data(), n);
+            T actualDistance = k.squaredDistance(a.data(), b.data(), n);
+            REQUIRE(std::fabs(expectedDistance - actualDistance) < tolerance * (1 + expectedDistance));
+            
+            double wideDot = 0, wideDistance = 0;
+            for(size_t i = 0; i < n; i++) {
+                wideDot += double(a[i]) * double(b[i]);
+                wideDistance += (double(a[i]) - double(b[i])) * (double(a[i]) - double(b[i]));
+            }
+            REQUIRE(std::fabs(k.widenedDot(a.data(), b.data(), n) - wideDot) < 1e-9 * (1 + std::fabs(wideDot)));
+            REQUIRE(std::fabs(k.widenedSquaredDistance(a.data(), b.data(), n) - wideDistance) < 1e-9 * (1 + wideDistance));
+        }
+
+        T a[4] = {4, 5, 6, 42};
+        T b[4] = {7, 8, 9, 42};
+        T out[4] = {0, 0, 0, 42};
+        k.cross(a, b, out);
+        REQUIRE(out[0] == 5 * 9 - 6 * 8);
+        REQUIRE(out[1] == - 4 * 9 + 6 * 7);
+        REQUIRE(out[2] == 4 * 8 - 5 * 7);
+        REQUIRE(out[3] == 42);
+
+        // In-place use, as Vector assignment does for `v = v + w`.
+        k.add(a, b, a, 3);
+        REQUIRE(a[0] == 11);
+        REQUIRE(a[2] == 15);
+        REQUIRE(a[3] == 42);
+    }
+}
+
+TEST_CASE("every simd level matches the scalar kernels", "[simd]") {
+    SECTION("double") {
+        checkKernels<double>(1e-9);
+    }
+
+    SECTION("float") {
+        checkKernels<float>(1e-3f);
+    }
+}
+
+// Every mantissa, at both exponent parities, and a spread of magnitudes.
+template<class T>
+void checkApproximateInverseSqrt() {
+    std::vector<T> inputs;
+    for(size_t i = 0; i < (1 << 16); i++) {
+        inputs.push_back(1 + 3 * T(i) / (1 << 16));
+    }
+    for(int e = -120; e <= 120; e += 7) {
+        inputs.push_back(std::ldexp(T(1.37), e));
+    }
+    
+    std::vector<simd::Level> levels = {simd::Level::scalar, simd::Level::sse2, simd::Level::avx2, simd::Level::avx512};
+    for(simd::Level level : levels) {
+        if(level > simd::detected()) {
+            continue;
+        }
+        INFO("level " << simd::name(level));
+        
+        std::vector<T> out(inputs.size());
+        simd::kernels<T>(level).approximateInverseSqrt(inputs.data(), out.data(), inputs.size());
+        double worst = 0;
+        for(size_t i = 0; i < inputs.size(); i++) {
+            double exact = 1 / std::sqrt(static_cast<double>(inputs[i]));
+            double error = std::fabs(out[i] - exact) / exact;
+            worst = std::max(worst, error);
+        }
+        REQUIRE(worst <= simd::approximationError);
+    }
+    
+    double worst = 0;
+    for(T x : inputs) {
+        double exact = 1 / std::sqrt(static_cast<double>(x));
+        double error = std::fabs(simd::approximateInverseSqrt(x) - exact) / exact;
+        worst = std::max(worst, error);
+    }
+    REQUIRE(worst <= simd::approximationError);
+    
+    // Out of the estimate's range, the scalar version is exact.
+    T zero = simd::approximateInverseSqrt(T(0));
+    REQUIRE(zero == std::numeric_limits<T>::infinity());
+    T tiny = std::numeric_limits<T>::denorm_min();
+    T tinyInverse = simd::approximateInverseSqrt(tiny);
+    REQUIRE(tinyInverse == 1 / std::sqrt(tiny));
+}
+
+// A float loop that adds 10^6 terms one at a time loses about three digits;
+// the kernels sum pairwise and keep nearly all of them.
+TEST_CASE("long reductions stay accurate", "[simd]") {
+    const size_t n = 1000000;
+    std::vector<float> a(n), b(n);
+    double exactDot = 0, exactDistance = 0;
+    for(size_t i = 0; i < n; i++) {
+        a[i] = 0.1f + float(i % 7) / 10;
+        b[i] = 0.3f - float(i % 5) / 10;
+        exactDot += double(a[i]) * double(b[i]);
+        exactDistance += (double(a[i]) - double(b[i])) * (double(a[i]) - double(b[i]));
+    }
+    
+    std::vector<simd::Level> levels = {simd::Level::scalar, simd::Level::sse2, simd::Level::avx2, simd::Level::avx512};
+    for(simd::Level level : levels) {
+        if(level > simd::detected()) {
+            continue;
+        }
+        INFO("level " << simd::name(level));
+        
+        const simd::Kernels<float> &k = simd::kernels<float>(level);
+        double dotError = std::fabs(k.dot(a.data(), b.data(), n) - exactDot) / std::fabs(exactDot);
+        double distanceError = std::fabs(k.squaredDistance(a.data(), b.data(), n) - exactDistance) / exactDistance;
+        REQUIRE(dotError < 1e-6);
+        REQUIRE(distanceError < 1e-6);
+        
+        // Summed in double, only the rounding of the double sum remains.
+        double widenedError = std::fabs(k.widenedDot(a.data(), b.data(), n) - exactDot) / std::fabs(exactDot);
+        REQUIRE(widenedError < 1e-10);
+    }
+}
+
+TEST_CASE("approximate inverse square roots stay within their bound", "[simd]") {
+    SECTION("double") {
+        checkApproximateInverseSqrt<double>();
+    }
+    
+    SECTION("float") {
+        checkApproximateInverseSqrt<float>();
+    }
+}
+
+TEST_CASE("vectors use the simd kernels", "[simd][vector]") {
+    Vector<3> a(4, 5, 6);
+    Vector<3> b(7, 8, 9);
+
+    Vector<3> cross = a.cross(b);
+    REQUIRE(cross.x() == 5 * 9 - 6 * 8);
+    REQUIRE(cross.y() == - 4 * 9 + 6 * 7);
+    REQUIRE(cross.z() == 4 * 8 - 5 * 7);
+
+    REQUIRE(a.dot(b) == 4 * 7 + 5 * 8 + 6 * 9);
+
+    Vector<2> c(1, 2);
+    Vector<2> d = c + c;
+    REQUIRE(d.x() == 2);
+    REQUIRE(d.y() == 4);
+
+    Vector<4> e(1, 2, 3, 4);
+    Vector<4> f = e * 3;
+    REQUIRE(f.t() == 12);
+
+    Vector<4> g = -e;
+    REQUIRE(g.t() == -4);
+
+    Vector<3, float> h(4, 5, 6);
+    Vector<3, float> i = h + h * 2;
+    REQUIRE(i.z() == 18);
+    REQUIRE(h.cross(Vector<3, float>(7, 8, 9)).z() == 4 * 8 - 5 * 7);
+}
@@ -0,0 +1,119 @@
+//
+//  sparse_vector_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "dyn_vector.h"
+#include "sparse_vector.h"
+#include "vector.h"
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// The fixture lists index 2 twice and an explicit zero, which construction
+// sums and drops.
+TEST_CASE("sparse vectors store only nonzeros", "[sparse_vector]") {
+    std::vector<size_t> indices = {7, 2, 9, 2};
+    std::vector<double> values = {3, 1, 0, 4};
+    SparseVector<> s(10, indices, values);
+    
+    SECTION("construction") {
+        REQUIRE(s.dimension() == 10);
+        REQUIRE(s.nonzeros() == 2);
+        REQUIRE(s.indices()[0] == 2);
+        REQUIRE(s.values()[0] == 5);
+        REQUIRE(s[7] == 3);
+        REQUIRE(s[8] == 0);
+        
+        std::vector<size_t> past = {10};
+        std::vector<double> one = {1};
+        REQUIRE_THROWS_AS(SparseVector<>(10, past, one), std::out_of_range);
+        REQUIRE_THROWS_AS(SparseVector<>(10, past, values), std::length_error);
+    }
+    
+    SECTION("dense conversions") {
+        Vector<4> dense(0, 2, 0, -1);
+        SparseVector<> fromVector(dense);
+        REQUIRE(fromVector.nonzeros() == 2);
+        REQUIRE(static_cast<Vector<4>>(fromVector) == dense);
+        REQUIRE_THROWS_AS(static_cast<Vector<3>>(fromVector), std::length_error);
+        
+        DynVector<> expanded = s.dense();
+        REQUIRE(expanded.dimension() == 10);
+        REQUIRE(SparseVector<>(expanded) == s);
+    }
+    
+    SECTION("products") {
+        DynVector<> ramp(std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+        double sparseDense = s * ramp;
+        REQUIRE(sparseDense == 5 * 2 + 3 * 7);
+        REQUIRE(s.dot(ramp) == ramp * s);
+        
+        std::vector<size_t> otherIndices = {2, 3, 7};
+        std::vector<double> otherValues = {2, 8, -1};
+        SparseVector<> other(10, otherIndices, otherValues);
+        double sparseSparse = s * other;
+        REQUIRE(sparseSparse == 5 * 2 - 3);
+        REQUIRE(s.squaredmagnitude() == 34);
+        REQUIRE(s.magnitude() == Approx(std::sqrt(34)));
+        
+        SparseVector<> sum = s + other;
+        REQUIRE(sum.nonzeros() == 3);
+        REQUIRE(sum[7] == 2);
+        REQUIRE((s - s).nonzeros() == 0);
+        REQUIRE((2 * s)[2] == 10);
+        REQUIRE((s / 2)[7] == 1.5);
+        REQUIRE((-s)[7] == -3);
+        
+        REQUIRE_THROWS_AS(s.dot(SparseVector<>(11)), std::length_error);
+        REQUIRE_THROWS_AS(s.dot(DynVector<>(3)), std::length_error);
+    }
+    
+    SECTION("galloping agrees with merging") {
+        // 20 nonzeros against 5000 gallops; against 40 it merges.
+        const size_t dimension = 100000;
+        std::vector<size_t> denseIndices, fewIndices, someIndices;
+        for(size_t i = 0; i < 5000; i++) {
+            denseIndices.push_back(i * 19 % dimension);
+        }
+        for(size_t i = 0; i < 20; i++) {
+            fewIndices.push_back(i * 4751);
+        }
+        for(size_t i = 0; i < 40; i++) {
+            someIndices.push_back(i * 2375);
+        }
+        SparseVector<> many(dimension, denseIndices, std::vector<double>(denseIndices.size(), 0.5));
+        SparseVector<> few(dimension, fewIndices, std::vector<double>(fewIndices.size(), 2));
+        SparseVector<> some(dimension, someIndices, std::vector<double>(someIndices.size(), 3));
+        
+        DynVector<> manyDense = many.dense();
+        REQUIRE(few.dot(many) == few.dot(manyDense));
+        REQUIRE(many.dot(few) == few.dot(manyDense));
+        REQUIRE(some.dot(few) == few.dot(some.dense()));
+        REQUIRE(few.dot(many) != 0);
+    }
+    
+    SECTION("axpy") {
+        DynVector<> y(10, 1);
+        DynVector<> out = axpy(2, s, y);
+        REQUIRE(out[2] == 11);
+        REQUIRE(out[7] == 7);
+        REQUIRE(out[0] == 1);
+        
+        Vector<10> v = axpy(-1, s, static_cast<Vector<10>>(y));
+        REQUIRE(v[2] == -4);
+        
+        SparseVector<> twice = axpy(1, s, s);
+        REQUIRE(twice == s * 2);
+        
+        std::vector<double> buffer(10, 0);
+        s.axpy(3, buffer);
+        REQUIRE(buffer[7] == 9);
+        REQUIRE_THROWS_AS(s.axpy(1, std::span<double>(buffer.data(), 9)), std::length_error);
+    }
+}
@@ -0,0 +1,93 @@
+//
+//  transform_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "transform.h"
+#include "parallel.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+    template<class T>
+    std::vector<Vector<3, T>> randomPoints(size_t n) {
+        std::vector<Vector<3, T>> points;
+        points.reserve(n);
+        for(size_t i = 0; i < n; i++) {
+            points.push_back(Vector<3, T>(rand() % 2000 - 1000, rand() % 2000 - 1000, rand() % 2000 - 1000));
+        }
+        return points;
+    }
+}
+
+TEST_CASE("points transform in bulk", "[matrix][transform]") {
+    Matrix<4, 4> affine = Matrix<4, 4>::translation(Vector<3>(1, 2, 3)) * Matrix<4, 4>::rotation(Vector<3>(1, 1, 0), 0.5);
+    Matrix<4, 4> projective = Matrix<4, 4>::perspective(1, 1.5, 0.1, 100) * affine;
+    
+    SECTION("affine") {
+        std::vector<Vector<3>> in = randomPoints<double>(1000);
+        std::vector<Vector<3>> out(in.size());
+        transformPoints(affine, in, out);
+        
+        for(size_t i = 0; i < in.size(); i++) {
+            REQUIRE(out[i].distance(affine.transformPoint(in[i])) < 1e-9);
+        }
+    }
+    
+    SECTION("projective") {
+        std::vector<Vector<3>> in = randomPoints<double>(1000);
+        std::vector<Vector<3>> out(in.size());
+        transformPoints(projective, in, out);
+        
+        for(size_t i = 0; i < in.size(); i++) {
+            REQUIRE(out[i].distance(projective.transformPoint(in[i])) < 1e-9);
+        }
+    }
+    
+    SECTION("four components") {
+        std::vector<Vector<4, float>> in;
+        for(int i = 0; i < 100; i++) {
+            in.push_back(Vector<4, float>(i, -i, 2 * i, i % 2));
+        }
+        Matrix<4, 4, float> m = Matrix<4, 4, float>::scaling(Vector<3, float>(2, 3, 4));
+        transformPoints(m, in, in);
+        
+        REQUIRE(in[7].x() == 14);
+        REQUIRE(in[7].y() == -21);
+        REQUIRE(in[7].z() == 56);
+        REQUIRE(in[7].t() == 1);
+    }
+    
+    // Past the streaming threshold and split over several threads, the
+    // results do not change.
+    SECTION("large outputs") {
+        std::vector<Vector<3>> in = randomPoints<double>(500000);
+        std::vector<Vector<3>> threaded(in.size());
+        std::vector<Vector<3>> single(in.size());
+        
+        parallel::setThreads(4);
+        transformPoints(affine, in, threaded);
+        parallel::setThreads(1);
+        transformPoints(affine, in, single);
+        parallel::setThreads(0);
+        
+        bool identical = true;
+        for(size_t i = 0; i < in.size(); i++) {
+            identical = identical && threaded[i].data()[0] == single[i].data()[0] && threaded[i].data()[2] == single[i].data()[2];
+        }
+        REQUIRE(identical);
+        REQUIRE(threaded[123456].distance(affine.transformPoint(in[123456])) < 1e-9);
+        
+        // In place.
+        transformPoints(affine, in, in);
+        REQUIRE(in[499999].distance(threaded[499999]) == 0);
+    }
+    
+    SECTION("lengths must match") {
+        std::vector<Vector<3>> in(3), out(2);
+        REQUIRE_THROWS_AS(transformPoints(affine, in, out), std::length_error);
+    }
+}
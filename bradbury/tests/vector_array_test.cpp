@@ -0,0 +1,189 @@
+//
+//  vector_array_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "vector_array.h"
+#include <cmath>
+#include <vector>
+
+TEST_CASE("vector arrays store components separately", "[vector][array]") {
+    VectorArray<3> a = {Vector<3>(1, 2, 3), Vector<3>(4, 5, 6)};
+    
+    SECTION("layout") {
+        REQUIRE(a.size() == 2);
+        REQUIRE(a.component(0)[1] == 4);
+        REQUIRE(a.component(2)[0] == 3);
+        const double *second = a.component(1) + 1;
+        REQUIRE(second == &a.component(1)[1]);
+    }
+    
+    SECTION("elements behave like vectors") {
+        Vector<3> first = a[0];
+        REQUIRE(first == Vector<3>(1, 2, 3));
+        REQUIRE(a[1].y() == 5);
+        REQUIRE(a[1].get<2>() == 6);
+        
+        double dot = a[0] * a[1];
+        REQUIRE(dot == 4 + 10 + 18);
+        
+        Vector<3> sum = a[0] + a[1] * 2;
+        REQUIRE(sum.z() == 3 + 12);
+        
+        const VectorArray<3> &constant = a;
+        VectorArray<3>::const_reference element = constant[1];
+        REQUIRE(element.x() == 4);
+    }
+    
+    SECTION("elements write through") {
+        a[0] = Vector<3>(7, 8, 9);
+        REQUIRE(a.component(0)[0] == 7);
+        
+        a[1] = a[0] + a[1];
+        REQUIRE(a[1].x() == 11);
+        REQUIRE(a[0].x() == 7);
+        
+        // Assigning one element to another copies, it does not rebind.
+        VectorArray<3>::reference target = a[0];
+        target = a[1];
+        REQUIRE(a[0].z() == 15);
+        REQUIRE(target.index() == 0);
+    }
+    
+    SECTION("growing") {
+        a.push_back(Vector<3>(1, 1, 1) * 3);
+        REQUIRE(a.size() == 3);
+        REQUIRE(a[2].z() == 3);
+        
+        a.resize(5, Vector<3>(-1));
+        REQUIRE(a[4].y() == -1);
+        
+        a.clear();
+        REQUIRE(a.empty());
+    }
+}
+
+// Checks every bulk operation against the same operation on Vectors, for
+// sizes that cover the kernels' chunks and tails.
+template<class T>
+void checkBulkOperations(double tolerance) {
+    for(size_t n : {0, 1, 3, 8, 17, 100}) {
+        INFO("n = " << n);
+        
+        VectorArray<3, T> a, b;
+        std::vector<Vector<3, T>> va, vb;
+        for(size_t i = 0; i < n; i++) {
+            Vector<3, T> u(rand() % 200 - 100, rand() % 200 - 100, rand() % 200 - 100);
+            Vector<3, T> v(rand() % 200 - 100, rand() % 200 - 100, static_cast<int>(i));
+            a.push_back(u);
+            b.push_back(v);
+            va.push_back(u);
+            vb.push_back(v);
+        }
+        
+        VectorArray<3, T> sum;
+        add(a, b, sum);
+        VectorArray<3, T> scaled;
+        scale(a, 1.5, scaled);
+        VectorArray<3, T> normalized;
+        normalize(a, normalized);
+        VectorArray<3, T> fastNormalized;
+        fastnormalize(a, fastNormalized);
+        std::vector<VectorArray<3, T>> fastNormalizedAtLevel;
+        std::vector<simd::Level> levels = {simd::Level::scalar, simd::Level::sse2, simd::Level::avx2, simd::Level::avx512};
+        for(simd::Level level : levels) {
+            fastNormalizedAtLevel.emplace_back();
+            fastnormalize(a, fastNormalizedAtLevel.back(), level);
+        }
+        std::vector<typename VectorArray<3, T>::value_type> dots(n);
+        dot(a, b, std::span<typename VectorArray<3, T>::value_type>(dots));
+        VectorArray<3, T> accumulated = b;
+        axpy(0.5, a, accumulated);
+        
+        REQUIRE(sum.size() == n);
+        REQUIRE(normalized.size() == n);
+        for(size_t i = 0; i < n; i++) {
+            Vector<3, T> expectedSum = va[i] + vb[i];
+            Vector<3, T> actualSum = sum[i];
+            REQUIRE(actualSum == expectedSum);
+            
+            Vector<3, T> expectedScale = va[i] * 1.5;
+            Vector<3, T> actualScale = scaled[i];
+            REQUIRE(actualScale == expectedScale);
+            
+            Vector<3, T> expectedNormal = va[i].normalize();
+            Vector<3, T> actualNormal = normalized[i];
+            REQUIRE(actualNormal.distance(expectedNormal) < tolerance);
+            Vector<3, T> fastNormal = fastNormalized[i];
+            REQUIRE(fastNormal.distance(expectedNormal) < 2 * simd::approximationError);
+            for(const VectorArray<3, T> &forced : fastNormalizedAtLevel) {
+                Vector<3, T> forcedNormal = forced[i];
+                REQUIRE(forcedNormal.distance(expectedNormal) < 2 * simd::approximationError);
+            }
+            
+            double expectedDot = va[i] * vb[i];
+            REQUIRE(std::fabs(dots[i] - expectedDot) < tolerance);
+            
+            Vector<3, T> expectedAxpy = va[i] * 0.5 + vb[i];
+            Vector<3, T> actualAxpy = accumulated[i];
+            REQUIRE(actualAxpy.distance(expectedAxpy) < tolerance);
+        }
+    }
+}
+
+TEST_CASE("vector arrays have bulk operations", "[vector][array]") {
+    SECTION("double") {
+        checkBulkOperations<double>(1e-9);
+    }
+    
+    SECTION("float") {
+        checkBulkOperations<float>(1e-3);
+    }
+    
+    SECTION("zero vectors normalize to themselves") {
+        VectorArray<2> a = {Vector<2>(0, 0), Vector<2>(0, 2)};
+        VectorArray<2> b = a;
+        normalize(a, a);
+        
+        REQUIRE(a[0].x() == 0);
+        REQUIRE(a[0].y() == 0);
+        REQUIRE(a[1].y() == 1);
+        
+        // As do vectors out of the approximation's range, exactly, whatever
+        // kernels run.
+        b.push_back(Vector<2>(3e30, 4e30));
+        for(simd::Level level : {simd::Level::scalar, simd::Level::sse2, simd::Level::avx2, simd::Level::avx512}) {
+            VectorArray<2> c;
+            fastnormalize(b, c, level);
+            REQUIRE(c[0].y() == 0);
+            REQUIRE(c[1].y() == Approx(1));
+            REQUIRE(c[2].x() == Approx(0.6));
+        }
+        fastnormalize(b, b);
+        REQUIRE(b[2].x() == Approx(0.6));
+    }
+    
+    SECTION("other scalar types use plain loops") {
+        VectorArray<3, int32_t> a = {Vector<3, int32_t>(1, 2, 3)};
+        add(a, a, a);
+        axpy(2, a, a);
+        REQUIRE(a[0].z() == 18);
+        
+        VectorArray<3, half> h = {Vector<3, half>(0, 3, 4)};
+        normalize(h, h);
+        REQUIRE(h[0].z() == 0.7998046875f);
+    }
+    
+    SECTION("sizes must match") {
+        VectorArray<3> a(3), b(4);
+        VectorArray<3> out;
+        REQUIRE_THROWS_AS(add(a, b, out), std::length_error);
+        REQUIRE_THROWS_AS(axpy(1, a, b), std::length_error);
+        
+        std::vector<double> dots(2);
+        REQUIRE_THROWS_AS(dot(a, a, std::span<double>(dots)), std::length_error);
+    }
+}
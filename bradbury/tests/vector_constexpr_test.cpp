@@ -0,0 +1,70 @@
+//
+//  vector_constexpr_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "vector.h"
+#include <array>
+
+// Everything in this file is checked by the compiler; the test case below
+// only exists so the file shows up in the test run.
+namespace {
+    constexpr Vector<3> right(1, 0, 0);
+    constexpr Vector<3> up(0, 1, 0);
+    constexpr Vector<3> forward(0, 0, 1);
+    
+    // A lookup table built entirely at compile time.
+    constexpr std::array<Vector<2>, 8> compass() {
+        std::array<Vector<2>, 8> directions;
+        const int dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+        const int dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+        for(size_t i = 0; i < 8; i++) {
+            directions[i] = Vector<2>(dx[i], dy[i]);
+        }
+        return directions;
+    }
+    constexpr std::array<Vector<2>, 8> compassDirections = compass();
+    
+    static_assert(right.x() == 1 && right.y() == 0 && right.z() == 0, "component access");
+    static_assert(Vector<4>(1, 2, 3, 4).t() == 4, "component access");
+    static_assert(Vector<4>(1, 2, 3, 4).w() == 4, "component access");
+    static_assert(Vector<4>({1, 2, 3, 4})[2] == 3, "list construction");
+    static_assert(Vector<4>(1, 2, 3, 4).get<1>() == 2, "compile-time component access");
+    static_assert(Vector<5>(2.5)[4] == 2.5, "value construction");
+    static_assert(Vector<3>().z() == 0, "default construction");
+    static_assert(Vector<3>(1, 2, 3).dimension() == 3, "dimension");
+    
+    static_assert(Vector<3>(right + up).y() == 1, "addition");
+    static_assert(Vector<3>(right - up).y() == -1, "subtraction");
+    static_assert(Vector<3>(-forward).z() == -1, "negation");
+    static_assert(Vector<3>(up * 3).y() == 3, "scaling");
+    static_assert(Vector<3>(3 * up).y() == 3, "scaling");
+    static_assert(Vector<3>(up / 2).y() == 0.5, "division");
+    static_assert(Vector<3>(right * 2 + up - forward / 2).z() == -0.5, "chained expressions");
+    
+    static_assert(Vector<3>(1, 2, 3) * Vector<3>(4, 5, 6) == 32, "dot product");
+    static_assert(Vector<3>(1, 2, 3).dot(Vector<3>(4, 5, 6)) == 32, "dot product");
+    static_assert((right + up) * forward == 0, "dot product of expressions");
+    static_assert(right.cross(up) == forward, "cross product");
+    static_assert(up.cross(right) == -forward, "cross product");
+    static_assert(right != up, "inequality");
+    
+    static_assert(Vector<2>(3, 4).squaredmagnitude() == 25, "squared magnitude");
+    static_assert(Vector<2>(3, 4).magnitude() == 5, "magnitude");
+    static_assert(Vector<3>(1, 2, 3).distance(Vector<3>(1, 5, 7)) == 5, "distance");
+    static_assert(Vector<3>(0, 0, 2).normalize() == forward, "normalize");
+    static_assert(Vector<4>(2, -7, 5, 1).mincomponent() == -7, "min component");
+    static_assert(Vector<4>(2, -7, 5, 1).maxcomponent() == 5, "max component");
+    static_assert(right.lerp(up, 0.5) == Vector<3>(0.5, 0.5, 0.0), "lerp");
+    
+    static_assert(compassDirections[1].x() == 1 && compassDirections[1].y() == 1, "lookup table");
+    static_assert(compassDirections[6] * compassDirections[2] == -1, "lookup table");
+}
+
+TEST_CASE("vectors can be used in constant expressions", "[vector]") {
+    REQUIRE(compassDirections[4].x() == -1);
+    REQUIRE(right.cross(up) == forward);
+}
@@ -0,0 +1,115 @@
+//
+//  vector_packet_test.cpp
+//  bradbury
+//
+//  Created by Ben Stolovitz on 12/14/14.
+//  Copyright (c) 2014 citelao. All rights reserved.
+//
+
+#include "vector_packet.h"
+#include <vector>
+
+TEST_CASE("vector packets work lane by lane", "[vector][packet]") {
+    std::vector<Vector<3, float>> vectors;
+    for(int i = 0; i < 10; i++) {
+        vectors.push_back(Vector<3, float>(i, 2 * i, rand() % 100 - 50));
+    }
+    
+    SECTION("layout") {
+        static_assert(alignof(VectorPacket<3, 8, float>) == 32, "a lane row fills one AVX register");
+        static_assert(sizeof(VectorPacket<3, 8, float>) == 3 * 8 * sizeof(float), "packets are packed");
+        
+        VectorPacket<3, 8, float> p = VectorPacket<3, 8, float>::load(vectors.data());
+        REQUIRE(p.component(1)[3] == 6);
+        const float *nextRow = p.component(0) + 8;
+        REQUIRE(nextRow == p.component(1));
+    }
+    
+    SECTION("load and store") {
+        VectorPacket<3, 8, float> p = VectorPacket<3, 8, float>::load(vectors.data());
+        for(size_t l = 0; l < 8; l++) {
+            REQUIRE(p.lane(l) == vectors[l]);
+        }
+        
+        // A partial packet: the last two vectors.
+        VectorPacket<3, 8, float> tail = VectorPacket<3, 8, float>::load(vectors.data() + 8, 2);
+        REQUIRE(tail.lane(1) == vectors[9]);
+        Vector<3, float> zero;
+        REQUIRE(tail.lane(2) == zero);
+        
+        Vector<3, float> untouched(-1);
+        std::vector<Vector<3, float>> out(3, untouched);
+        tail.store(out.data(), 2);
+        REQUIRE(out[0] == vectors[8]);
+        REQUIRE(out[2] == untouched);
+    }
+    
+    SECTION("gather and scatter") {
+        const uint32_t indices[4] = {9, 0, 4, 4};
+        VectorPacket<3, 4, float> p = VectorPacket<3, 4, float>::gather(vectors.data(), indices);
+        REQUIRE(p.lane(0) == vectors[9]);
+        REQUIRE(p.lane(3) == vectors[4]);
+        
+        const size_t targets[4] = {3, 2, 1, 0};
+        std::vector<Vector<3, float>> out(4);
+        p.scatter(out.data(), targets);
+        REQUIRE(out[3] == vectors[9]);
+        REQUIRE(out[0] == vectors[4]);
+    }
+    
+    SECTION("operations match vectors") {
+        VectorPacket<3, 8, float> a = VectorPacket<3, 8, float>::load(vectors.data());
+        VectorPacket<3, 8, float> b = VectorPacket<3, 8, float>::load(vectors.data() + 2);
+        
+        VectorPacket<3, 8, float> sum = a + b * 2 - (-a) / 2;
+        VectorPacket<3, 8, float> cross = a.cross(b);
+        ScalarPacket<8, float> dot = a.dot(b);
+        VectorPacket<3, 8, float> normal = b.normalize();
+        ScalarPacket<8, float> length = b.magnitude();
+        
+        for(size_t l = 0; l < 8; l++) {
+            Vector<3, float> u = vectors[l];
+            Vector<3, float> v = vectors[l + 2];
+            
+            Vector<3, float> expectedSum = u + v * 2 - (-u) / 2;
+            REQUIRE(sum.lane(l) == expectedSum);
+            REQUIRE(cross.lane(l) == u.cross(v));
+            REQUIRE(dot[l] == u.dot(v));
+            REQUIRE(length[l] == Approx(v.magnitude()));
+            REQUIRE(normal.lane(l).distance(v.normalize()) < 1e-6);
+        }
+    }
+    
+    SECTION("per-lane scaling") {
+        VectorPacket<2, 4> p(Vector<2>(1, 2));
+        ScalarPacket<4> s = ScalarPacket<4>::load(std::vector<Vector<1>>{Vector<1>(1), Vector<1>(2), Vector<1>(3), Vector<1>(4)}.data());
+        VectorPacket<2, 4> scaled = p * s;
+        
+        Vector<2> expected(3, 6);
+        REQUIRE(scaled.lane(2) == expected);
+        REQUIRE(scaled.lane(3).y() == 8);
+    }
+    
+    SECTION("masks") {
+        ScalarPacket<4> s = ScalarPacket<4>::load(std::vector<Vector<1>>{Vector<1>(1), Vector<1>(-2), Vector<1>(3), Vector<1>(-4)}.data());
+        PacketMask<4> positive = s > ScalarPacket<4>(0);
+        
+        REQUIRE(positive.bits() == 0b0101);
+        REQUIRE(positive[0]);
+        REQUIRE(!positive[1]);
+        REQUIRE(positive.any());
+        REQUIRE(!positive.all());
+        REQUIRE((positive | ~positive).all());
+        REQUIRE((positive & ~positive).none());
+        
+        ScalarPacket<4> clamped = ScalarPacket<4>::select(positive, s, ScalarPacket<4>(0));
+        REQUIRE(clamped[1] == 0);
+        REQUIRE(clamped[2] == 3);
+        
+        VectorPacket<3, 8, float> a = VectorPacket<3, 8, float>::load(vectors.data());
+        VectorPacket<3, 8, float> b = a;
+        b.setLane(5, Vector<3, float>(100));
+        PacketMask<8> same = a.equal(b);
+        REQUIRE(same.bits() == 0b11011111);
+    }
+}
@@ -6,9 +6,20 @@
 //  Copyright (c) 2014 citelao. All rights reserved.
 //
 
+#include "fixtures.h"
 #include "vector.h"
+#include <cstring>
+#include <span>
 #include <vector>
+#include <type_traits>
 
+// Accessors that do not exist for a dimension are compile-time errors, so
+// they are tested as concepts.
+template<class V> concept HasY = requires(V v) { v.y(); };
+template<class V> concept HasZ = requires(V v) { v.z(); };
+template<class V> concept HasT = requires(V v) { v.t(); };
+template<class V> concept HasW = requires(V v) { v.w(); };
+template<class V, size_t I> concept HasGet = requires(V v) { v.template get<I>(); };
 
 TEST_CASE("vectors can be created with proper stats", "[vector]") {
     std::vector<double> traditionalStaticBase = {4, 6, 10, 12};
@@ -40,19 +51,19 @@ TEST_CASE("vectors can be created with proper stats", "[vector]") {
         REQUIRE(d3.x() == 1);
         REQUIRE(d4.x() == 1);
         
-        REQUIRE_THROWS(d1.y());
+        static_assert(!HasY<Vector<1>>, "no y component for dimension 1");
         REQUIRE(d2.y() == 2);
         REQUIRE(d3.y() == 2);
         REQUIRE(d4.y() == 2);
         
-        REQUIRE_THROWS(d1.z());
-        REQUIRE_THROWS(d2.z());
+        static_assert(!HasZ<Vector<1>>, "no z component for dimension 1");
+        static_assert(!HasZ<Vector<2>>, "no z component for dimension 2");
         REQUIRE(d3.z() == 3);
         REQUIRE(d4.z() == 3);
         
-        REQUIRE_THROWS(d1.t());
-        REQUIRE_THROWS(d2.t());
-        REQUIRE_THROWS(d3.t());
+        static_assert(!HasT<Vector<1>>, "no t component for dimension 1");
+        static_assert(!HasT<Vector<2>>, "no t component for dimension 2");
+        static_assert(!HasT<Vector<3>>, "no t component for dimension 3");
         REQUIRE(d4.t() == 4);
     }
     
@@ -74,12 +85,14 @@ TEST_CASE("vectors can be created with proper stats", "[vector]") {
         Vector<3> v;
         
         REQUIRE_THROWS_AS((v = {4, 6, 10, 12}), std::length_error);
-        REQUIRE_THROWS_AS((v = Vector<4>(4, 6, 10, 12)), std::length_error);
+        static_assert(!std::is_constructible<Vector<3>, Vector<4>>::value, "no conversion between dimensions");
+        static_assert(!std::is_assignable<Vector<3> &, Vector<4>>::value, "no conversion between dimensions");
         REQUIRE_THROWS_AS((v = traditionalStaticBase), std::length_error);
         
         std::vector<double> tooSmall = {4, 6};
         REQUIRE_THROWS_AS((v = {4, 6}), std::length_error);
-        REQUIRE_THROWS_AS((v = Vector<2>(4, 6)), std::length_error);
+        static_assert(!std::is_constructible<Vector<3>, Vector<2>>::value, "no conversion between dimensions");
+        static_assert(!std::is_assignable<Vector<3> &, Vector<2, float>>::value, "no conversion between dimensions");
         REQUIRE_THROWS_AS((v = tooSmall), std::length_error);
         
         REQUIRE_NOTHROW(v = 4);
@@ -93,7 +106,12 @@ TEST_CASE("vectors can be created with proper stats", "[vector]") {
             REQUIRE(v.t() == v[3]);
             REQUIRE(v.w() == v[3]);
             
+#if BRADBURY_CHECKED_ACCESS
             REQUIRE_THROWS_AS(v[4], std::out_of_range);
+#endif
+            
+            REQUIRE(v.get<0>() == 4);
+            REQUIRE(v.get<3>() == 12);
             
             REQUIRE(v.x() == 4);
             REQUIRE(v.y() == 6);
@@ -103,13 +121,20 @@ TEST_CASE("vectors can be created with proper stats", "[vector]") {
         }
         
         Vector<1> v = {0};
+        REQUIRE(v[0] == 0);
+#if BRADBURY_CHECKED_ACCESS
         REQUIRE_THROWS_AS(v[1], std::out_of_range);
         REQUIRE_THROWS_AS(v[2], std::out_of_range);
         REQUIRE_THROWS_AS(v[3], std::out_of_range);
-        REQUIRE_THROWS_AS(v.y(), std::out_of_range);
-        REQUIRE_THROWS_AS(v.z(), std::out_of_range);
-        REQUIRE_THROWS_AS(v.t(), std::out_of_range);
-        REQUIRE_THROWS_AS(v.w(), std::out_of_range);
+        REQUIRE_THROWS_AS(v[-1], std::out_of_range);
+#endif
+        static_assert(!HasY<Vector<1>>, "no y component for dimension 1");
+        static_assert(!HasZ<Vector<1>>, "no z component for dimension 1");
+        static_assert(!HasT<Vector<1>>, "no t component for dimension 1");
+        static_assert(!HasW<Vector<1>>, "no w component for dimension 1");
+        static_assert(HasGet<Vector<1>, 0>, "get<0> for dimension 1");
+        static_assert(!HasGet<Vector<1>, 1>, "no get<1> for dimension 1");
+        static_assert(HasW<Vector<4>>, "w component for dimension 4");
     }
     
     SECTION("dynamic example access") {
@@ -120,7 +145,9 @@ TEST_CASE("vectors can be created with proper stats", "[vector]") {
             REQUIRE(v.t() == v[3]);
             REQUIRE(v.w() == v[3]);
             
+#if BRADBURY_CHECKED_ACCESS
             REQUIRE_THROWS_AS(v[4], std::out_of_range);
+#endif
             
             REQUIRE(v.x() == dx);
             REQUIRE(v.y() == dy);
@@ -136,6 +163,62 @@ TEST_CASE("vectors can be created with proper stats", "[vector]") {
         REQUIRE(v.y() == 5.2);
         REQUIRE(v.z() == 6.2);
     }
+    
+    SECTION("inline storage") {
+        static_assert(std::is_trivially_copyable<Vector<3>>::value, "Vector must be trivially copyable");
+        static_assert(std::is_trivially_copyable<Vector<4>>::value, "Vector must be trivially copyable");
+        
+        Vector<3> a(1, 2, 3);
+        Vector<3> b(4, 5, 6);
+        
+        size_t before = allocationCount;
+        Vector<3> sum;
+        for(int i = 0; i < 1000; i++) {
+            Vector<3> copy = a;
+            sum = sum + copy - b + (-a);
+        }
+        size_t after = allocationCount;
+        
+        REQUIRE(after == before);
+        REQUIRE(sum.x() == -4000);
+        REQUIRE(sum.y() == -5000);
+        REQUIRE(sum.z() == -6000);
+    }
+    
+    SECTION("raw component layout") {
+        std::vector<Vector<3, float>> vertices = {Vector<3, float>(1, 2, 3), Vector<3, float>(4, 5, 6)};
+        
+        std::span<float> raw = components(vertices);
+        REQUIRE(raw.size() == 6);
+        REQUIRE(raw[4] == 5);
+        REQUIRE((void *)raw.data() == (void *)vertices.data());
+        
+        // Writing through the scalars, as a file read would.
+        const float loaded[6] = {7, 8, 9, 10, 11, 12};
+        std::memcpy(raw.data(), loaded, sizeof(loaded));
+        REQUIRE(vertices[1].y() == 11);
+        
+        const std::vector<Vector<2>> points = {Vector<2>(1, 2)};
+        std::span<const double> constRaw = components(points);
+        REQUIRE(constRaw[1] == 2);
+    }
+    
+    SECTION("aligned storage") {
+        Vector<3, float, 16> a(1, 2, 3);
+        Vector<3, float, 16> b = a * 2 + a;
+        
+        uintptr_t misalignment = reinterpret_cast<uintptr_t>(b.data()) % 16;
+        REQUIRE(misalignment == 0);
+        REQUIRE(b.z() == 9);
+        REQUIRE(a.dot(b) == 3 * (1 + 4 + 9));
+        
+        // Converting between alignments goes through the expression constructor.
+        Vector<3, float> packed = b;
+        REQUIRE(packed.y() == 6);
+        
+        std::vector<Vector<4, float, 16>> quads(3, Vector<4, float, 16>(1, 2, 3, 4));
+        REQUIRE(components(quads).size() == 12);
+    }
 }
 
 TEST_CASE("vectors can do math on each other", "[vector]") {
@@ -228,40 +311,304 @@ TEST_CASE("vectors can do math on each other", "[vector]") {
         
         REQUIRE(dot == 4 * 7 + 5 * 8 + 6 * 9);
         
-        FAIL("need to test dot product in 4 dimensions");
+        double dot4 = Vector<4>(1, 2, 3, 4) * Vector<4>(5, 6, 7, 8);
+        
+        REQUIRE(dot4 == 1 * 5 + 2 * 6 + 3 * 7 + 4 * 8);
     }
     
-//    SECTION("can dynamic dot product") {
-//        double ab = a * b;
-//        double ba = b * a;
-//        
-//        // * is an alias for dot
-//        double bdota = b.dot(a);
-//        
-//        REQUIRE(ab == ba);
-//        REQUIRE(ab == bdota);
-//        REQUIRE(ab == a.x() * b.x() +
-//                    a.y() * b.y() +
-//                    a.z() * b.z());
-//    }
-//    
-//    SECTION("can static cross product") {
-//        Vector cross = Vector(4, 5, 6).cross(Vector(7, 8, 9));
-//        
-//        REQUIRE(cross.x() == 5 * 9 - 6 * 8);
-//        REQUIRE(cross.y() == - 4 * 9 + 6 * 7);
-//        REQUIRE(cross.z() == 4 * 8 - 5 * 7);
-//    }
-//    
-//    SECTION("can dynamic cross product") {
-//        Vector ab = a.cross(b);
-//        Vector ba = b.cross(a);
-//        
-//        REQUIRE(ab == -ba);
-//        REQUIRE(ab.x() == ay * bz - by * az);
-//        REQUIRE(ab.y() == - ax * bz + bx * az);
-//        REQUIRE(ab.z() == ax * by - bx * ay);
-//    }
+    SECTION("can dynamic dot product") {
+        double ab = a * b;
+        double ba = b * a;
+        
+        // * is an alias for dot
+        double bdota = b.dot(a);
+        
+        REQUIRE(ab == ba);
+        REQUIRE(ab == bdota);
+        REQUIRE(ab == a.x() * b.x() +
+                    a.y() * b.y() +
+                    a.z() * b.z());
+        
+        double cd = c * d;
+        REQUIRE(cd == Approx(cx * dx + cy * dy + cz * dz + ct * dt));
+    }
+    
+    SECTION("can static cross product") {
+        Vector<3> cross = Vector<3>(4, 5, 6).cross(Vector<3>(7, 8, 9));
+        
+        REQUIRE(cross.x() == 5 * 9 - 6 * 8);
+        REQUIRE(cross.y() == - 4 * 9 + 6 * 7);
+        REQUIRE(cross.z() == 4 * 8 - 5 * 7);
+    }
+    
+    SECTION("can dynamic cross product") {
+        Vector<3> ab = a.cross(b);
+        Vector<3> ba = b.cross(a);
+        
+        REQUIRE(ab == Vector<3>(-ba));
+        REQUIRE(ab.x() == ay * bz - by * az);
+        REQUIRE(ab.y() == - ax * bz + bx * az);
+        REQUIRE(ab.z() == ax * by - bx * ay);
+    }
+}
+
+TEST_CASE("vectors reduce in any dimension", "[vector]") {
+    SECTION("magnitude") {
+        Vector<2> v(3, 4);
+        
+        REQUIRE(v.squaredmagnitude() == 25);
+        REQUIRE(v.magnitude() == 5);
+        REQUIRE(Vector<4>(1, 1, 1, 1).magnitude() == 2);
+        
+        // Integer vectors still have a real magnitude.
+        double diagonal = Vector<2, int32_t>(1, 1).magnitude();
+        REQUIRE(diagonal == Approx(std::sqrt(2.0)));
+    }
+    
+    SECTION("distance") {
+        Vector<3> a(1, 2, 3);
+        Vector<3> b(4, 6, 3);
+        
+        REQUIRE(a.squareddistance(b) == 25);
+        REQUIRE(a.distance(b) == 5);
+        REQUIRE(b.distance(a) == 5);
+        REQUIRE(a.distance(a) == 0);
+    }
+    
+    SECTION("normalize") {
+        Vector<3> n = Vector<3>(0, 3, 4).normalize();
+        
+        REQUIRE(n.y() == Approx(0.6));
+        REQUIRE(n.z() == Approx(0.8));
+        REQUIRE(n.magnitude() == Approx(1));
+        
+        Vector<3, float> f = Vector<3, float>(2, 0, 0).normalize();
+        REQUIRE(f.x() == 1);
+        
+        Vector<3> zero;
+        REQUIRE(zero.normalize() == zero);
+    }
+    
+    SECTION("approximate magnitude and normalize") {
+        for(int i = 0; i < 1000; i++) {
+            Vector<3, float> v(rand() % 2000 - 1000.0f, rand() % 2000 - 1000.0f, (rand() % 2000 - 1000) / 1000.0f);
+            Vector<3, float> exact = v.normalize(), fast = v.fastnormalize();
+            for(int c = 0; c < 3; c++) {
+                REQUIRE(std::fabs(fast[c] - exact[c]) <= simd::approximationError * std::fabs(exact[c]));
+            }
+            REQUIRE(std::fabs(v.fastmagnitude() - v.magnitude()) <= simd::approximationError * v.magnitude());
+        }
+        
+        // Out of float's range, so exact.
+        Vector<3> huge(1e100, 0.0, 0.0);
+        REQUIRE(huge.fastmagnitude() == Approx(1e100));
+        Vector<3> unit = huge.fastnormalize();
+        REQUIRE(unit.x() == Approx(1));
+        
+        Vector<3> zero;
+        REQUIRE(zero.fastnormalize() == zero);
+        REQUIRE(zero.fastmagnitude() == 0);
+    }
+    
+    SECTION("min and max components") {
+        Vector<5> v = {3.0, -1.0, 4.0, -1.5, 9.0};
+        
+        REQUIRE(v.mincomponent() == -1.5);
+        REQUIRE(v.maxcomponent() == 9);
+        Vector<2, int32_t> i(7, 2);
+        REQUIRE(i.maxcomponent() == 7);
+    }
+    
+    SECTION("lerp") {
+        Vector<2> a(1, 2);
+        Vector<2> b(3, -2);
+        
+        REQUIRE(a.lerp(b, 0) == a);
+        REQUIRE(a.lerp(b, 1) == b);
+        Vector<2> middle(2, 0);
+        REQUIRE(a.lerp(b, 0.5) == middle);
+        REQUIRE(a.lerp(b, 0.25).x() == 1.5);
+    }
+    
+    // Past the unroll limit, so the loops and the dot kernel are used.
+    SECTION("high dimensions") {
+        std::vector<double> components(100);
+        for(size_t i = 0; i < components.size(); i++) {
+            components[i] = i % 2 ? 1.0 : -1.0;
+        }
+        Vector<100> v = components;
+        Vector<100> w = v * 3;
+        
+        REQUIRE(v.squaredmagnitude() == 100);
+        REQUIRE(v.magnitude() == 10);
+        REQUIRE(v.distance(w) == 20);
+        REQUIRE(v.normalize()[7] == Approx(0.1));
+        REQUIRE(w.mincomponent() == -3);
+        REQUIRE(w.maxcomponent() == 3);
+        REQUIRE(v.lerp(w, 0.5)[1] == 2);
+        REQUIRE(v == Vector<100>(w / 3));
+        REQUIRE(v != w);
+        
+        std::vector<float> features(768);
+        for(size_t i = 0; i < features.size(); i++) {
+            features[i] = float(i % 13) / 13;
+        }
+        Vector<768, float> f = features;
+        Vector<768, float> g = f * 2.0f;
+        double squared = 0;
+        for(float x : features) {
+            squared += double(x) * double(x);
+        }
+        REQUIRE(f.squaredmagnitude() == Approx(squared));
+        REQUIRE(f.squareddistance(g) == Approx(squared));
+        REQUIRE(g.distance(f) == Approx(std::sqrt(squared)));
+    }
+}
+
+TEST_CASE("vectors can store other scalar types", "[vector]") {
+    SECTION("sizes") {
+        REQUIRE(sizeof(Vector<3, float>) < sizeof(Vector<3>));
+        REQUIRE(sizeof(Vector<4, half>().x()) == 2);
+    }
+    
+    SECTION("float") {
+        Vector<3, float> a(1, 2, 3);
+        Vector<3, float> b = {4.5, 5.5, 6.5};
+        Vector<3, float> v = a * 2 + b / 2;
+        
+        REQUIRE(v.x() == 1 * 2 + 4.5f / 2);
+        REQUIRE(v.z() == 3 * 2 + 6.5f / 2);
+        REQUIRE(a.dot(b) == 1 * 4.5f + 2 * 5.5f + 3 * 6.5f);
+        bool staysFloat = std::is_same<decltype(a * 0.5), VectorScale<3, Vector<3, float>, float>>::value;
+        REQUIRE(staysFloat);
+    }
+    
+    SECTION("int") {
+        Vector<3, int32_t> a(1, 2, 3);
+        Vector<3, int32_t> b(4, 5, 6);
+        Vector<3, int32_t> v = a * 3 - b;
+        
+        REQUIRE(v.x() == -1);
+        REQUIRE(v.z() == 3);
+        int32_t dot = a * b;
+        REQUIRE(dot == 32);
+        Vector<3, int32_t> quarter = b / 4;
+        REQUIRE(quarter.y() == 1);
+        
+        // Scaling by a double promotes the expression.
+        Vector<3> half = a * 0.5;
+        REQUIRE(half.x() == 0.5);
+    }
+    
+    SECTION("half") {
+        Vector<3, half> a(1.5, 2.5, -3.25);
+        Vector<3, half> b = a * 2;
+        
+        REQUIRE(b.x() == 3);
+        REQUIRE(b.z() == -6.5);
+        float dot = a * Vector<3, half>(2, 2, 2);
+        REQUIRE(dot == 1.5);
+        
+        bool computesInFloat = std::is_same<Vector<3, half>::value_type, float>::value;
+        REQUIRE(computesInFloat);
+    }
+    
+    SECTION("mixed") {
+        // 2^24 + 1 is not a float, so float sums stop counting at 2^24.
+        Vector<4, mixed> a(16777216.0f, 1.0f, 1.0f, 1.0f);
+        Vector<4, mixed> ones(1.0f, 1.0f, 1.0f, 1.0f);
+        double dot = a * ones;
+        REQUIRE(dot == 16777219);
+        REQUIRE(sizeof(Vector<4, mixed>) == sizeof(Vector<4, float>));
+        
+        Vector<4, mixed> doubled = a + ones;
+        REQUIRE(doubled.y() == 2);
+        bool accumulatesInDouble = std::is_same<Vector<4, mixed>::accumulate_type, double>::value;
+        bool computesInFloat = std::is_same<Vector<4, mixed>::value_type, float>::value;
+        REQUIRE(accumulatesInDouble);
+        REQUIRE(computesInFloat);
+        
+        // Long vectors take the widening kernels.
+        std::vector<float> components(1000, 1.0f);
+        components[0] = 16777216.0f;
+        Vector<1000, mixed> big = components;
+        Vector<1000, mixed> unit(1.0f);
+        double bigDot = big * unit;
+        double bigDistance = big.squareddistance(Vector<1000, mixed>(0.0f));
+        REQUIRE(bigDot == 16777216.0 + 999);
+        REQUIRE(bigDistance == 16777216.0 * 16777216.0 + 999);
+        REQUIRE(big.magnitude() == Approx(std::sqrt(bigDistance)));
+        
+        Vector<1000, float> narrow = components;
+        float narrowDot = narrow * Vector<1000, float>(1.0f);
+        REQUIRE(narrowDot != bigDot);
+    }
+    
+    SECTION("converting between scalar types") {
+        Vector<3> d(1.25, 2.5, 3.75);
+        Vector<3, float> f = d;
+        Vector<3, half> h = f;
+        Vector<3, int32_t> i = d;
+        
+        REQUIRE(f.y() == 2.5f);
+        REQUIRE(h.z() == 3.75f);
+        REQUIRE(i.z() == 3);
+        
+        Vector<3> mixed = d + f;
+        REQUIRE(mixed.x() == 2.5);
+    }
+}
+
+TEST_CASE("vector expressions are evaluated lazily", "[vector]") {
+    Vector<3> a(1, 2, 3);
+    Vector<3> b(4, 5, 6);
+    Vector<3> c(7, 8, 9);
+    
+    SECTION("chained expressions") {
+        Vector<3> v = a * 2 + b - c;
+        
+        REQUIRE(v.x() == 1 * 2 + 4 - 7);
+        REQUIRE(v.y() == 2 * 2 + 5 - 8);
+        REQUIRE(v.z() == 3 * 2 + 6 - 9);
+        
+        Vector<3> w = -(a + b) / 2 + 0.5 * c;
+        
+        REQUIRE(w.x() == -(1 + 4) / 2.0 + 0.5 * 7);
+        REQUIRE(w.y() == -(2 + 5) / 2.0 + 0.5 * 8);
+        REQUIRE(w.z() == -(3 + 6) / 2.0 + 0.5 * 9);
+    }
+    
+    SECTION("operands are unchanged") {
+        Vector<3> v = a + b * 3 - c;
+        
+        REQUIRE(a.x() == 1);
+        REQUIRE(b.x() == 4);
+        REQUIRE(c.x() == 7);
+        REQUIRE(v.x() == 1 + 4 * 3 - 7);
+    }
+    
+    SECTION("self assignment") {
+        Vector<3> v = a;
+        v = v + b - v * 2;
+        
+        REQUIRE(v.x() == 1 + 4 - 2);
+        REQUIRE(v.y() == 2 + 5 - 4);
+        REQUIRE(v.z() == 3 + 6 - 6);
+    }
+    
+    SECTION("dot product of expressions") {
+        double dot = (a + b) * c;
+        REQUIRE(dot == 5 * 7 + 7 * 8 + 9 * 9);
+    }
+    
+    SECTION("other dimensions") {
+        Vector<5> v = {1, 2, 3, 4, 5};
+        Vector<5> w = v * 2 - v / 2;
+        
+        for(int i = 0; i < 5; i++) {
+            REQUIRE(w[i] == v[i] * 1.5);
+        }
+    }
 }
 //
 //TEST_CASE("vectors can do math with numbers", "[vector]") {